@@ -0,0 +1,111 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_DREAMER_JOINT_LAYOUT_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_DREAMER_JOINT_LAYOUT_HPP__
+
+#include <stddef.h>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * The M3 chains (limbs) contained within the shared memory status and
+ * command structures.
+ */
+typedef enum {
+    M3_CHAIN_RIGHT_ARM,
+    M3_CHAIN_LEFT_ARM,
+    M3_CHAIN_TORSO,
+    M3_CHAIN_HEAD,
+    M3_CHAIN_RIGHT_HAND,
+    M3_CHAIN_LEFT_HAND,
+    M3_NUM_CHAINS
+} m3_chain_t;
+
+/*!
+ * Where a hand or head joint is located within the M3 shared memory.
+ *
+ * As with the entries of M3JointMap, the state is the M3 value multiplied
+ * by the sign and scale and the command is divided by them, on top of the
+ * unit conversion between M3 (degrees, mNm) and ControlIt! (radians, Nm).
+ */
+struct DreamerJoint
+{
+    const char * name;
+    m3_chain_t chain;
+    int slot;
+    double sign;
+    double scale;
+};
+
+/*!
+ * The hand joints, in the order used by HandControllerDreamer.  The right
+ * hand joints come first, followed by the left gripper.
+ *
+ * Unlike the whole-body joints, which are described by the ROS parameter
+ * "m3_joint_map", the hand and head layouts are fixed at compile time so that
+ * the loops over them can be unrolled and the chain and slot of each joint
+ * folded into a constant offset.  The joint names must match the Dreamer
+ * model included by models/xacro/controlit_dreamer.xacro.
+ */
+constexpr DreamerJoint DREAMER_HAND_JOINTS[] = {
+    {"right_thumb_cmc",          M3_CHAIN_RIGHT_HAND, 0, 1, 1},
+    {"right_thumb_mcp",          M3_CHAIN_RIGHT_HAND, 1, 1, 1},
+    {"right_pointer_finger_mcp", M3_CHAIN_RIGHT_HAND, 2, 1, 1},
+    {"right_middle_finger_mcp",  M3_CHAIN_RIGHT_HAND, 3, 1, 1},
+    {"right_pinky_mcp",          M3_CHAIN_RIGHT_HAND, 4, 1, 1},
+    {"left_gripper",             M3_CHAIN_LEFT_HAND,  0, 1, 1}
+};
+
+/*!
+ * The head joints, in the order used by HeadControllerDreamer.
+ */
+constexpr DreamerJoint DREAMER_HEAD_JOINTS[] = {
+    {"lower_neck_pitch", M3_CHAIN_HEAD, 0, 1, 1},
+    {"upper_neck_yaw",   M3_CHAIN_HEAD, 1, 1, 1},
+    {"upper_neck_roll",  M3_CHAIN_HEAD, 2, 1, 1},
+    {"upper_neck_pitch", M3_CHAIN_HEAD, 3, 1, 1},
+    {"eye_pitch",        M3_CHAIN_HEAD, 4, 1, 1},
+    {"right_eye_yaw",    M3_CHAIN_HEAD, 5, 1, 1},
+    {"left_eye_yaw",     M3_CHAIN_HEAD, 6, 1, 1}
+};
+
+/*!
+ * Returns the number of the first numJoints joints that are in a chain.
+ */
+constexpr size_t countDreamerJoints(const DreamerJoint * joints, size_t numJoints, m3_chain_t chain)
+{
+    return numJoints == 0 ? 0
+        : (joints[0].chain == chain ? 1 : 0) + countDreamerJoints(joints + 1, numJoints - 1, chain);
+}
+
+constexpr size_t NUM_HAND_JOINTS = sizeof(DREAMER_HAND_JOINTS) / sizeof(DREAMER_HAND_JOINTS[0]);
+constexpr size_t NUM_HEAD_JOINTS = sizeof(DREAMER_HEAD_JOINTS) / sizeof(DREAMER_HEAD_JOINTS[0]);
+constexpr size_t NUM_RIGHT_HAND_JOINTS = countDreamerJoints(DREAMER_HAND_JOINTS, NUM_HAND_JOINTS, M3_CHAIN_RIGHT_HAND);
+
+/*!
+ * Give the joint layouts a type so that code can be specialized on them.
+ * Because get() is constexpr, a specialization can look up each joint at
+ * compile time.
+ */
+struct DreamerHandJoints
+{
+    static constexpr size_t size() { return NUM_HAND_JOINTS; }
+    static constexpr DreamerJoint get(size_t ii) { return DREAMER_HAND_JOINTS[ii]; }
+};
+
+struct DreamerHeadJoints
+{
+    static constexpr size_t size() { return NUM_HEAD_JOINTS; }
+    static constexpr DreamerJoint get(size_t ii) { return DREAMER_HEAD_JOINTS[ii]; }
+};
+
+static_assert(NUM_RIGHT_HAND_JOINTS + countDreamerJoints(DREAMER_HAND_JOINTS, NUM_HAND_JOINTS, M3_CHAIN_LEFT_HAND)
+    == NUM_HAND_JOINTS, "The hand joints must be in the right hand or the left gripper");
+static_assert(countDreamerJoints(DREAMER_HAND_JOINTS, NUM_RIGHT_HAND_JOINTS, M3_CHAIN_RIGHT_HAND)
+    == NUM_RIGHT_HAND_JOINTS, "The right hand joints must precede the left gripper");
+static_assert(countDreamerJoints(DREAMER_HEAD_JOINTS, NUM_HEAD_JOINTS, M3_CHAIN_HEAD)
+    == NUM_HEAD_JOINTS, "The head joints must be in the head chain");
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_DREAMER_JOINT_LAYOUT_HPP__
@@ -0,0 +1,258 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_FLIGHT_RECORDER_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_FLIGHT_RECORDER_HPP__
+
+#include <ros/ros.h>
+#include <std_msgs/Empty.h>
+
+#include <controlit/dreamer/M3CopyPlan.hpp>
+
+#include "m3uta/controllers/torque_shm_uta_sds.h"
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace controlit {
+namespace dreamer {
+
+#define FLIGHT_RECORDER_MAGIC "DRMRFREC"
+#define FLIGHT_RECORDER_VERSION 1
+
+/*!
+ * One servo cycle's worth of data exchanged with the M3 server.
+ */
+struct FlightRecorderFrame
+{
+    /*!
+     * The servo cycle in which the frame was recorded.
+     */
+    uint64_t cycle;
+
+    /*!
+     * When the frame was recorded in nanoseconds, as measured by the
+     * robot interface's timer.
+     */
+    int64_t timestamp;
+
+    /*!
+     * The status read from and the command written to shared memory.  Only
+     * the bytes in the robot interface's copy plans are recorded; the rest
+     * are zero.
+     */
+    M3UTATorqueShmSdsStatus status;
+    M3UTATorqueShmSdsCommand command;
+};
+
+/*!
+ * The header at the start of a flight recorder file.  The frames follow
+ * the header.  The file is a circular buffer of capacity frames; frame
+ * numFrames % capacity is the next one to be overwritten.
+ */
+struct FlightRecorderFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t frameSize;
+    uint64_t capacity;
+    uint64_t numFrames;
+    uint64_t droppedFrames;
+};
+
+/*!
+ * Records the raw status and command of every servo cycle.
+ *
+ * The servo thread copies each frame into a lock-free ring buffer that
+ * holds the last few seconds of frames.  Only the status and command bytes
+ * that the robot interface exchanges with the M3 server, as given by its
+ * copy plans, are copied, and the ring buffer is locked into memory.  A non-real-time thread drains the
+ * ring buffer into a memory-mapped, size-capped file.  When triggered by a
+ * fault, SIGUSR1, or a message on topic controlit/dreamer/flight_recorder/trigger,
+ * the ring buffer is frozen and its contents are dumped to a separate
+ * file in chronological order.
+ */
+class FlightRecorder
+{
+public:
+    /*!
+     * The constructor.
+     */
+    FlightRecorder();
+
+    /*!
+     * The destructor.
+     */
+    ~FlightRecorder();
+
+    /*!
+     * Initializes this class and starts the drain thread.
+     *
+     * \param[in] nh The ROS node handle to use during initialization.
+     * \param[in] servoFrequency The servo frequency in Hz.  Used to size the ring buffer.
+     * \param[in] statusPlan The status bytes to record.
+     * \param[in] commandPlans The command bytes to record.
+     * \return Whether the initialization was successful.
+     */
+    bool init(ros::NodeHandle & nh, double servoFrequency, const M3CopyPlan & statusPlan,
+        const std::vector<const M3CopyPlan *> & commandPlans);
+
+    /*!
+     * Stops the drain thread and closes the file.
+     */
+    void stop();
+
+    /*!
+     * Records a frame.  This is called by the servo thread.
+     *
+     * \param[in] cycle The current servo cycle.
+     * \param[in] timestamp The current time in nanoseconds.
+     * \param[in] status The status read from shared memory.
+     * \param[in] command The command written to shared memory.
+     */
+    void record(uint64_t cycle, int64_t timestamp, const M3UTATorqueShmSdsStatus & status,
+        const M3UTATorqueShmSdsCommand & command);
+
+    /*!
+     * Requests that the ring buffer be dumped.  This is safe to call from
+     * the servo thread.
+     */
+    void trigger();
+
+    /*!
+     * Returns whether recording is enabled.
+     */
+    bool isEnabled() const { return enabled; }
+
+private:
+
+    /*!
+     * A slot in the ring buffer.  The sequence number is the index of the
+     * frame plus one, or zero while the frame is being written.
+     */
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        FlightRecorderFrame frame;
+    };
+
+    /*!
+     * Copies a frame out of the ring buffer.
+     *
+     * \param[in] index The index of the frame.
+     * \param[out] frame Where to copy the frame.
+     * \return Whether the frame was still in the ring buffer and was not
+     * overwritten during the copy.
+     */
+    bool readSlot(uint64_t index, FlightRecorderFrame & frame) const;
+
+    /*!
+     * Creates and maps the continuous recording file.
+     */
+    bool openFile(const std::string & path, size_t maxBytes);
+
+    /*!
+     * The body of the drain thread.
+     */
+    void drainLoop();
+
+    /*!
+     * Copies the frames recorded since the last call into the file.
+     */
+    void drainToFile();
+
+    /*!
+     * Freezes the ring buffer and writes its contents to a new file.
+     */
+    void dumpRing();
+
+    /*!
+     * The callback method for the trigger topic.
+     */
+    void triggerCallback(const boost::shared_ptr<std_msgs::Empty const> & msgPtr);
+
+    /*!
+     * Whether recording is enabled.
+     */
+    bool enabled;
+
+    /*!
+     * The ring buffer.
+     */
+    std::unique_ptr<Slot[]> slots;
+    uint64_t capacity;
+
+    /*!
+     * The status and command bytes to record.  These are copies of the
+     * robot interface's plans.
+     */
+    M3CopyPlan statusCopyPlan;
+    std::vector<M3CopyPlan> commandCopyPlans;
+
+    /*!
+     * Whether the ring buffer was locked into memory.
+     */
+    bool ringLocked;
+
+    /*!
+     * The index of the next frame to record.  Only modified by the servo thread.
+     */
+    std::atomic<uint64_t> writeIndex;
+
+    /*!
+     * The index of the next frame to drain to the file.  Only accessed by
+     * the drain thread.
+     */
+    uint64_t readIndex;
+
+    /*!
+     * Whether recording is paused while the ring buffer is dumped.
+     */
+    std::atomic<bool> frozen;
+
+    /*!
+     * Whether a dump was requested.
+     */
+    std::atomic<bool> triggerRequested;
+
+    /*!
+     * The continuous recording file.  fileHeader is null if the file is disabled.
+     */
+    int fileDescriptor;
+    size_t fileSize;
+    FlightRecorderFileHeader * fileHeader;
+    FlightRecorderFrame * fileFrames;
+
+    /*!
+     * The prefix of the names of the files created by dumpRing().
+     */
+    std::string dumpPrefix;
+
+    /*!
+     * A frame buffer used by dumpRing().
+     */
+    std::unique_ptr<FlightRecorderFrame> dumpFrame;
+
+    /*!
+     * The number of frames that could not be drained to the file because
+     * the drain thread fell behind.
+     */
+    uint64_t droppedFrames;
+
+    /*!
+     * The drain thread.
+     */
+    std::thread drainThread;
+    std::atomic<bool> drainThreadRunning;
+
+    /*!
+     * The subscriber to the trigger topic.
+     */
+    ros::Subscriber triggerSubscriber;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_FLIGHT_RECORDER_HPP__
@@ -6,10 +6,15 @@
 #include <std_msgs/Int32.h>
 #include <std_msgs/Float64.h>
 #include <std_msgs/Bool.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <sensor_msgs/JointState.h>
 
 #include <controlit/addons/eigen/LinearAlgebra.hpp>
 #include <controlit/addons/ros/RealTimePublisherHeader.hpp>
+#include <controlit/dreamer/DreamerJointLayout.hpp>
+#include <controlit/dreamer/Mailbox.hpp>
+
+#include <mutex>
 
 
 using controlit::addons::eigen::Vector;
@@ -19,13 +24,59 @@ using controlit::addons::eigen::Matrix3d;
 namespace controlit {
 namespace dreamer {
 
+/*!
+ * The parameters of HandControllerDreamer that are set via ROS topics.
+ */
+struct HandControllerParams
+{
+    int rightHandControlMode;
+    bool powerGraspRight;
+    bool powerGraspLeft;
+    bool includeRightPointerFinger; // whether to include the right pointer finger in the power grasp
+    bool includeRightMiddleFinger;  // whether to include the right middle finger in the power grasp
+    bool includeRightPinkyFinger;   // whether to include the right pinky finger in the power grasp
+    double thumbKp;
+    double thumbKd;
+    double thumbGoalPos;
+};
+
 /*!
  * Implements controllers for both end effectors on Dreamer. This consists of a
  * right hand and a left gripper.
+ *
+ * The parameters are set by the ROS callback thread and used by the thread
+ * that calls getCommand().  Each callback updates a copy of the parameters
+ * and publishes the whole copy through a lock-free mailbox, which
+ * getCommand() checks once per cycle.  getCommand() thus always sees a
+ * consistent set of parameters.
+ *
+ * Besides the individual topics, topic "controlit/hands/params" sets all
+ * parameters at once with a std_msgs/Float64MultiArray whose elements are:
+ *
+ *   0: right hand control mode (0 = power grasp, 1 = position)
+ *   1: right_thumb_cmc goal position
+ *   2: right_thumb_cmc Kp
+ *   3: right_thumb_cmc Kd
+ *   4: right hand power grasp (0 or 1)
+ *   5: left gripper power grasp (0 or 1)
+ *   6: include the right pointer finger in the power grasp (0 or 1)
+ *   7: include the right middle finger in the power grasp (0 or 1)
+ *   8: include the right pinky finger in the power grasp (0 or 1)
  */
 class HandControllerDreamer
 {
 public:
+    /*!
+     * The number of hand joints, i.e., the size of the state and command.
+     */
+    static const int NUM_DOFS = NUM_HAND_JOINTS;
+
+    /*!
+     * A fixed-size vector of hand joint values.  Being fixed-size, it lives
+     * inside its owner and never touches the heap.
+     */
+    typedef Eigen::Matrix<double, NUM_DOFS, 1> JointVector;
+
     /*!
      * The constructor.
      */
@@ -47,8 +98,8 @@ public:
     /*!
      * Updates the state of the hand joints.
      *
-     * \param[in] position The current position of the hand joints.
-     * The joint order is:
+     * \param[in] position The current position of the hand joints, in
+     * the order of DREAMER_HAND_JOINTS:
      *
      *   0: right_thumb_cmc
      *   1: right_thumb_mcp
@@ -59,13 +110,16 @@ public:
      * 
      * \param[in] velocity The current velocity of the hand joints.
      */
-    void updateState(Vector position, Vector velocity);
+    void updateState(JointVector const & position, JointVector const & velocity);
 
     /*!
      * Obtains the command based on the current state and current goal
      * positions.
+     *
+     * \param[out] command Where to save the command, in the same joint order
+     * as the state.
      */
-    void getCommand(Vector & command);
+    void getCommand(JointVector & command);
 
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 private:
@@ -102,23 +156,43 @@ private:
     void includeRightMiddleFingerCallback(const boost::shared_ptr<std_msgs::Bool const> & msgPtr);
     void includeRightPointerFingerCallback(const boost::shared_ptr<std_msgs::Bool const> & msgPtr);
 
-    int rightHandControlMode;
-    bool powerGraspRight;
-    bool powerGraspLeft;
+    /*!
+     * The callback method for setting all parameters at once.
+     */
+    void paramsCallback(const boost::shared_ptr<std_msgs::Float64MultiArray const> & msgPtr);
+
+    /*!
+     * Applies a change to the parameters and passes them to getCommand().
+     * This is called by the ROS callback thread.
+     *
+     * \param[in] update Modifies the parameters.
+     */
+    template<typename Update>
+    void updateParams(Update update)
+    {
+        std::lock_guard<std::mutex> lock(pendingParamsMutex);
+        update(pendingParams);
+        paramsMailbox.write(pendingParams);
+    }
+
+    // The parameters used by getCommand()
+    HandControllerParams params;
+
+    // The parameters as updated by the ROS callbacks, and the mailbox through
+    // which they are passed to getCommand().  The mutex serializes the callbacks
+    // in case they run in more than one thread, so the mailbox has a single writer.
+    HandControllerParams pendingParams;
+    std::mutex pendingParamsMutex;
+    Mailbox<HandControllerParams> paramsMailbox;
+
     bool closingThumbFinger;
     bool closingRightFingers;
-    bool includeRightPointerFinger; // whether to include the right pointer finger in the power grasp
-    bool includeRightMiddleFinger;  // whether to include the right middle finger in the power grasp
-    bool includeRightPinkyFinger;   // whether to include the right pinky finger in the power grasp
 
     // Current state information
-    Vector currPosition;
-    Vector currVelocity;
+    JointVector currPosition;
+    JointVector currVelocity;
 
     // Controller parameters
-    double thumbKp;
-    double thumbKd;
-    double thumbGoalPos;
     double thumbInitPos;
 
     // ROS Subscribers
@@ -131,6 +205,7 @@ private:
     ros::Subscriber includeRightPinkyFingerSubscriber;
     ros::Subscriber includeRightMiddleFingerSubscriber;
     ros::Subscriber includeRightPointerFingerSubscriber;
+    ros::Subscriber paramsSubscriber;
 
     // ROS Publishers
     controlit::addons::ros::RealtimePublisherHeader<sensor_msgs::JointState> rhCommandPublisher;
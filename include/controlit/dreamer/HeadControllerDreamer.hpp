@@ -4,10 +4,16 @@
 #include <ros/ros.h>
 // #include <std_msgs/Bool.h>
 #include <controlit/addons/eigen/LinearAlgebra.hpp>
+#include <controlit/addons/ros/RealTimePublisher.hpp>
 #include <controlit/addons/ros/RealTimePublisherHeader.hpp>
+#include <controlit/dreamer/DreamerJointLayout.hpp>
+#include <controlit/dreamer/HeadSerialLink.hpp>
+#include <controlit/dreamer/HeadSerialProtocol.hpp>
+#include <controlit/dreamer/LatencyHistogram.hpp>
+#include <controlit/dreamer/Mailbox.hpp>
 #include <std_msgs/Float64MultiArray.h>
 
-#include <SerialStream.h>
+#include <chrono>
 
 using controlit::addons::eigen::Vector;
 using controlit::addons::eigen::Matrix;
@@ -16,15 +22,92 @@ using controlit::addons::eigen::Matrix3d;
 namespace controlit {
 namespace dreamer {
 
-#define SERIAL_BUFFER_SIZE 18
-#define SERIAL_START_BYTE 0x55
+// The number of outstanding commands whose send times are remembered for
+// measuring the serial round-trip latency.
+#define HEAD_SEQ_WINDOW 64
+
+static_assert(NUM_HEAD_JOINTS == HEAD_PROTOCOL_NUM_DOFS, "The head serial protocol must carry every head joint");
+
+/*!
+ * How the head commands reach the head.
+ */
+enum HeadBackend
+{
+    HEAD_BACKEND_SERIAL,  // position errors over the serial port
+    HEAD_BACKEND_SHM      // position commands through the M3 shared memory command
+};
+
+/*!
+ * A head command received from ROS, either goal positions or position
+ * errors, and when it was received.
+ */
+struct HeadCommandSample
+{
+    double value[HEAD_PROTOCOL_NUM_DOFS];
+    std::chrono::steady_clock::time_point time;
+};
 
 /*!
  * Implements controllers for Dreamer's head joints.
+ *
+ * The head is commanded either with goal positions on topic
+ * "controlit/head/position_cmd" or with position errors on topic
+ * "controlit/head/error_cmd", whichever was received last.  Goal positions
+ * close the position loop locally: each cycle, the setpoint is interpolated
+ * linearly from where it was when the goal arrived to the goal, over the
+ * time since the previous goal (at most head_goal_max_interpolation_time),
+ * and the error is the setpoint minus the head position passed to
+ * updateState().  The setpoint is published on topic
+ * "controlit/head/joint_commands" and returned by getCommand().  When
+ * following position errors, getCommand() returns the head position when
+ * the error arrived plus the error, and holds that target until the next
+ * command arrives.
+ *
+ * With the serial backend, the position errors are sent to the head by this
+ * class.  With the shared memory backend, this class does no I/O and the
+ * robot interface sends the command returned by getCommand() to the M3
+ * server as the head's desired position.
+ *
+ * To compare the backends, the head's response latency and tracking error
+ * are published on topic "controlit/head/tracking_stats".  The response
+ * latency is the time from receiving a goal until the head has moved
+ * head_response_threshold radians toward it.  The elements are the backend
+ * (0 = serial, 1 = shared memory), the number of goals, the number of
+ * response latency measurements and their median, 99th percentile, and
+ * maximum in seconds, and the RMS and maximum difference between the
+ * setpoint and the head position in radians since the last message.
+ *
+ * The position errors are sent to the head's microcontroller over a
+ * non-blocking serial link using the protocol version given by
+ * head_serial_protocol_version (see HeadSerialProtocol).  A packet is
+ * sent when the errors change and otherwise at head_serial_resend_rate.
+ *
+ * With protocol version 2, the head acknowledges each command and reports
+ * its encoder positions.  The acknowledgements measure the serial
+ * round-trip latency and the encoder positions are published on topic
+ * "controlit/head/joint_states".  With version 1, that topic carries the
+ * head state passed to updateState().
+ *
+ * The link statistics are published on topic "controlit/head/serial_stats".
+ * The elements are the fields of HeadSerialLinkStats followed by the number
+ * of acknowledgements, rejected commands, acknowledgements of unknown
+ * commands, state packets, CRC errors, and framing errors, and the median,
+ * 99th percentile, and maximum round-trip latency in seconds.
  */
 class HeadControllerDreamer
 {
 public:
+    /*!
+     * The number of head joints, i.e., the size of the state and command.
+     */
+    static const int NUM_DOFS = NUM_HEAD_JOINTS;
+
+    /*!
+     * A fixed-size vector of head joint values.  Being fixed-size, it lives
+     * inside its owner and never touches the heap.
+     */
+    typedef Eigen::Matrix<double, NUM_DOFS, 1> JointVector;
+
     /*!
      * The constructor.
      */
@@ -39,15 +122,16 @@ public:
      * Initializes this class.
      *
      * \param[in] nh The ROS node handle to use during initialization.
+     * \param[in] backend How the head commands reach the head.
      * \return Whether the initialization was successful.
      */
-    bool init(ros::NodeHandle & nh);
+    bool init(ros::NodeHandle & nh, HeadBackend backend = HEAD_BACKEND_SERIAL);
 
     /*!
      * Updates the state of the head joints.
      *
-     * \param[in] position The current position of the head joints.
-     * The joint order is:
+     * \param[in] position The current position of the head joints, in
+     * the order of DREAMER_HEAD_JOINTS:
      *
      *   0: lower_neck_pitch
      *   1: upper_neck_yaw
@@ -59,13 +143,22 @@ public:
      *
      * \param[in] velocity The current velocity of the head joints.
      */
-    void updateState(Vector position, Vector velocity);
+    void updateState(JointVector const & position, JointVector const & velocity);
 
     /*!
      * Obtains the command based on the current state and current goal
-     * positions.
+     * positions, and sends the position errors to the head.
+     *
+     * \param[out] command Where to save the desired head joint positions, in
+     * the same joint order as the state.
      */
-    void getCommand(Vector & command);
+    void getCommand(JointVector & command);
+
+    /*!
+     * Whether updateState() was called at least once, meaning the command
+     * returned by getCommand() is relative to the actual head position.
+     */
+    bool hasState() const { return stateReceived; }
 
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 private:
@@ -81,25 +174,71 @@ private:
     void positionErrorCallback(const boost::shared_ptr<std_msgs::Float64MultiArray const> & msgPtr);
 
     /*!
-     * Saves a float as an array of bytes.
+     * Obtains the latest head command from ROS and, when following goal
+     * positions, updates the interpolated setpoint and position errors.
+     *
+     * \param[in] now The current time.
+     */
+    void updateSetpoint(std::chrono::steady_clock::time_point now);
+
+    /*!
+     * Parses the packets received from the head.
      *
-     * \param buff The buffer to store the bytes in.
-     * \param val The value to save.
+     * \param[in] now The current time.
      */
-    void saveFloat(char * buff, float val);
+    void receivePackets(std::chrono::steady_clock::time_point now);
+
+    /*!
+     * Publishes the head joint state.
+     *
+     * \param[in] position The joint positions.
+     * \param[in] velocity The joint velocities.
+     */
+    void publishJointState(JointVector const & position, JointVector const & velocity);
+
+    /*!
+     * Publishes the serial link statistics.
+     */
+    void publishSerialStats();
+
+    /*!
+     * Publishes the response latency and tracking error statistics.
+     */
+    void publishTrackingStats();
+
+    // How the head commands reach the head
+    HeadBackend backend;
 
     // Local variables for holding the current position and velocity state.
-    Vector currPosition;
-    Vector currVelocity;
+    JointVector currPosition;
+    JointVector currVelocity;
+    bool stateReceived;
 
     // ROS Subscribers
     ros::Subscriber headPositionCommandSubscriber;
     ros::Subscriber headPositionErrorSubscriber;
 
-    // The command
-    Vector commandPos;
+    // The commands received from ROS, passed from the ROS callback thread
+    Mailbox<HeadCommandSample> goalMailbox;
+    Mailbox<HeadCommandSample> errorMailbox;
+    HeadCommandSample commandSample;
+
+    // Whether the position errors are computed locally from goal positions
+    bool followingGoal;
+
+    // The interpolation from the setpoint when the current goal arrived to the goal
+    JointVector segmentStart;
+    JointVector segmentGoal;
+    std::chrono::steady_clock::time_point segmentStartTime;
+    std::chrono::steady_clock::time_point lastGoalTime;
+    double segmentDuration;
+    double maxInterpolationTime;
+
+    // The command, i.e., the interpolated setpoint or the target latched when
+    // the latest position error arrived
+    JointVector commandPos;
     // Vector commandVel;
-    Vector errorPos;
+    JointVector errorPos;
 
     // ROS publishers
     controlit::addons::ros::RealtimePublisherHeader<sensor_msgs::JointState>
@@ -108,10 +247,68 @@ private:
     controlit::addons::ros::RealtimePublisherHeader<sensor_msgs::JointState>
         jointCommandPublisher;
 
-    LibSerial::SerialStream serialPort;
+    controlit::addons::ros::RealtimePublisher<std_msgs::Float64MultiArray>
+        serialStatsPublisher;
+
+    // The serial link to the head and the protocol spoken over it
+    HeadSerialLink serialLink;
+    HeadSerialProtocol protocol;
+    int protocolVersion;
+
+    char serialOutputBuff[HEAD_PROTOCOL_MAX_FRAME_SIZE];
+    char serialInputBuff[256];
+
+    // The position errors being sent and the last ones that were sent
+    float errors[HEAD_PROTOCOL_NUM_DOFS];
+    float lastSentErrors[HEAD_PROTOCOL_NUM_DOFS];
+
+    // The sequence number of the last command and when it was sent
+    uint16_t seq;
+    std::chrono::steady_clock::time_point lastSendTime;
+
+    // The send times of the most recent commands, indexed by sequence number
+    std::chrono::steady_clock::time_point sendTimes[HEAD_SEQ_WINDOW];
+    uint16_t sendSeqs[HEAD_SEQ_WINDOW];
+    bool sendValid[HEAD_SEQ_WINDOW];
+
+    // The serial round-trip latency, from handing a command to the link to receiving its acknowledgement
+    LatencyHistogram rttHistogram;
+
+    // Receive statistics
+    unsigned long long numAcks;
+    unsigned long long numRejectedAcks;
+    unsigned long long numUnmatchedAcks;
+    unsigned long long numStates;
+
+    // The head state measured by its encoders and when it was received
+    JointVector measuredPosition;
+    JointVector measuredVelocity;
+    std::chrono::steady_clock::time_point lastStateTime;
+    bool hasMeasuredState;
+
+    // The period at which an unchanged packet is sent again, zero to only send changes
+    std::chrono::steady_clock::duration resendPeriod;
+
+    // The response to the latest goal, i.e., where the head was when the goal
+    // arrived, the unit vector toward the goal, and when the goal arrived
+    bool awaitingResponse;
+    JointVector responseStart;
+    JointVector responseDirection;
+    std::chrono::steady_clock::time_point responseGoalTime;
+    double responseThreshold;
+    LatencyHistogram responseHistogram;
+
+    // The number of goals received and the tracking error since the statistics were last published
+    unsigned long long numGoals;
+    double trackingErrorSumSq;
+    double trackingErrorMax;
+    unsigned long long numTrackingSamples;
+
+    controlit::addons::ros::RealtimePublisher<std_msgs::Float64MultiArray>
+        trackingStatsPublisher;
 
-    char serialOutputBuff[SERIAL_BUFFER_SIZE];
-    char checksum;
+    // When the statistics were last published
+    std::chrono::steady_clock::time_point lastStatsTime;
 };
 
 } // namespace dreamer
@@ -0,0 +1,189 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_HEAD_SERIAL_LINK_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_HEAD_SERIAL_LINK_HPP__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * The transmit statistics of a HeadSerialLink.
+ */
+struct HeadSerialLinkStats
+{
+    /*!
+     * The number of packets passed to send().
+     */
+    unsigned long long numPackets;
+
+    /*!
+     * The number of packets completely written to the serial port.
+     */
+    unsigned long long numSent;
+
+    /*!
+     * The number of packets that were replaced by a newer packet before
+     * they could be written because the port was busy.
+     */
+    unsigned long long numCoalesced;
+
+    /*!
+     * The number of packets that were discarded because write() failed.
+     */
+    unsigned long long numDropped;
+
+    /*!
+     * The number of bytes in the driver's transmit queue when it was last
+     * checked, and the maximum seen so far.
+     */
+    int txQueueDepth;
+    int maxTxQueueDepth;
+};
+
+/*!
+ * A non-blocking serial link to the head's microcontroller.
+ *
+ * The port is opened in raw mode with O_NONBLOCK so that a slow or
+ * disconnected link never stalls the calling thread.  At most one packet
+ * is in flight: while the driver's transmit queue still holds a full
+ * packet, or while a packet was only partially written, newer packets
+ * replace the one waiting to be sent.  The link thus transmits no faster
+ * than the wire allows and always sends the latest packet.
+ */
+class HeadSerialLink
+{
+public:
+    /*!
+     * The number of fields in the array produced by statsToArray().
+     */
+    static const size_t NUM_STATS_FIELDS = 6;
+
+    /*!
+     * The constructor.
+     */
+    HeadSerialLink();
+
+    /*!
+     * The destructor.  Closes the port.
+     */
+    ~HeadSerialLink();
+
+    /*!
+     * Opens and configures the serial port for 8 data bits and one stop bit.
+     *
+     * \param[in] port The path of the serial device, e.g., "/dev/ttyS0".
+     * \param[in] baud The baud rate, e.g., 115200.
+     * \param[in] parity "odd", "even", or "none".
+     * \return Whether the port was opened.
+     */
+    bool open(std::string const & port, int baud, std::string const & parity);
+
+    /*!
+     * Closes the serial port.
+     */
+    void close();
+
+    /*!
+     * Whether the serial port is open.
+     */
+    bool isOpen() const { return fd >= 0; }
+
+    /*!
+     * Transmits a packet, or keeps it until the port can accept it if the
+     * port is busy.  A kept packet that has not been written yet is replaced.
+     *
+     * \param[in] packet The packet to transmit.
+     * \param[in] size The size of the packet in bytes.
+     */
+    void send(const char * packet, size_t size);
+
+    /*!
+     * Continues writing a partially written packet and then the kept
+     * packet, if any.  This is called by send() and may be called
+     * periodically to flush the link between packets.
+     */
+    void service();
+
+    /*!
+     * Reads the bytes received so far without blocking.
+     *
+     * \param[out] buffer Where to save the bytes.
+     * \param[in] size The capacity of buffer.
+     * \return The number of bytes read.
+     */
+    size_t receive(char * buffer, size_t size);
+
+    /*!
+     * Returns the time it takes to transmit a packet of the given size over
+     * the wire, in seconds.
+     */
+    double getWireTime(size_t size) const;
+
+    /*!
+     * Returns the transmit statistics.
+     */
+    HeadSerialLinkStats const & getStats() const { return stats; }
+
+    /*!
+     * Saves transmit statistics in an array in the same order as the fields
+     * of HeadSerialLinkStats.
+     */
+    static void statsToArray(HeadSerialLinkStats const & stats, std::vector<double> & array);
+
+private:
+
+    /*!
+     * Updates the transmit queue depth.
+     *
+     * \return The number of bytes in the driver's transmit queue.
+     */
+    int updateTxQueueDepth();
+
+    /*!
+     * Writes as much of the packet in flight as the port accepts.
+     *
+     * \return Whether the packet in flight has been written completely.
+     */
+    bool writeInFlight();
+
+    /*!
+     * The file descriptor of the serial port, or -1 if it is closed.
+     */
+    int fd;
+
+    /*!
+     * The number of bits on the wire per byte, including the start,
+     * parity, and stop bits.
+     */
+    int bitsPerByte;
+
+    /*!
+     * The baud rate.
+     */
+    int baud;
+
+    /*!
+     * The packet being written and how many of its bytes were written.
+     */
+    std::vector<char> inFlight;
+    size_t inFlightOffset;
+
+    /*!
+     * The packet waiting for the port to become available.
+     */
+    std::vector<char> pending;
+    bool hasPending;
+
+    /*!
+     * The transmit statistics.
+     */
+    HeadSerialLinkStats stats;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_HEAD_SERIAL_LINK_HPP__
@@ -0,0 +1,151 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_HEAD_SERIAL_PROTOCOL_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_HEAD_SERIAL_PROTOCOL_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace controlit {
+namespace dreamer {
+
+#define HEAD_PROTOCOL_START_BYTE 0x55
+#define HEAD_PROTOCOL_VERSION 2
+#define HEAD_PROTOCOL_NUM_DOFS 7
+
+// The legacy (version 1) packet: the start byte, four floats, and an XOR checksum.
+#define HEAD_PROTOCOL_V1_PACKET_SIZE 18
+
+// A version 2 frame is the start byte, version, type, and payload length,
+// followed by the payload and a big-endian CRC-16/CCITT of all bytes after
+// the start byte.
+#define HEAD_PROTOCOL_HEADER_SIZE 4
+#define HEAD_PROTOCOL_CRC_SIZE 2
+#define HEAD_PROTOCOL_MAX_PAYLOAD_SIZE 64
+#define HEAD_PROTOCOL_MAX_FRAME_SIZE (HEAD_PROTOCOL_HEADER_SIZE + HEAD_PROTOCOL_MAX_PAYLOAD_SIZE + HEAD_PROTOCOL_CRC_SIZE)
+
+/*!
+ * The types of version 2 frames.  Commands are sent to the head and the
+ * rest are received from it.
+ */
+enum HeadPacketType
+{
+    HEAD_PACKET_COMMAND = 0x01,  // uint16 seq, 7 x float32 position errors (radians)
+    HEAD_PACKET_ACK     = 0x81,  // uint16 seq of the command, uint8 status (0 = applied)
+    HEAD_PACKET_STATE   = 0x82   // uint16 seq of the last applied command, 7 x float32 encoder positions (radians)
+};
+
+/*!
+ * A packet received from the head.
+ */
+struct HeadRxPacket
+{
+    /*!
+     * HEAD_PACKET_ACK or HEAD_PACKET_STATE.
+     */
+    uint8_t type;
+
+    /*!
+     * The sequence number of the command the packet refers to.
+     */
+    uint16_t seq;
+
+    /*!
+     * The status of an acknowledgement.
+     */
+    uint8_t status;
+
+    /*!
+     * The encoder positions of a state packet, in the joint order of
+     * HeadControllerDreamer.
+     */
+    float position[HEAD_PROTOCOL_NUM_DOFS];
+};
+
+/*!
+ * Encodes and decodes the packets exchanged with the head's
+ * microcontroller.  All multi-byte values are little-endian except
+ * for the CRC.
+ *
+ * Version 1 is the original format, which carries the first four position
+ * errors and no sequence number, and for which the head sends nothing back.
+ * Version 2 carries all seven position errors and a sequence number.  The
+ * head acknowledges each command it applies and periodically reports its
+ * encoder positions.
+ */
+class HeadSerialProtocol
+{
+public:
+    /*!
+     * The constructor.
+     */
+    HeadSerialProtocol();
+
+    /*!
+     * Encodes a version 1 command.
+     *
+     * \param[in] errors The HEAD_PROTOCOL_NUM_DOFS position errors, of which the first four are sent.
+     * \param[out] buffer Where to save the packet.  It must hold HEAD_PROTOCOL_V1_PACKET_SIZE bytes.
+     * \return The size of the packet.
+     */
+    static size_t encodeCommandV1(const float * errors, char * buffer);
+
+    /*!
+     * Encodes a version 2 command.
+     *
+     * \param[in] seq The sequence number.
+     * \param[in] errors The HEAD_PROTOCOL_NUM_DOFS position errors.
+     * \param[out] buffer Where to save the frame.  It must hold HEAD_PROTOCOL_MAX_FRAME_SIZE bytes.
+     * \return The size of the frame.
+     */
+    static size_t encodeCommand(uint16_t seq, const float * errors, char * buffer);
+
+    /*!
+     * Computes the CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF) of a buffer.
+     */
+    static uint16_t crc16(const uint8_t * data, size_t size, uint16_t crc = 0xFFFF);
+
+    /*!
+     * Feeds a received byte to the frame parser.
+     *
+     * \param[in] byte The received byte.
+     * \param[out] packet Where to save the packet if a valid frame was completed.
+     * \return Whether a valid frame was completed.
+     */
+    bool parse(uint8_t byte, HeadRxPacket & packet);
+
+    /*!
+     * Returns the number of frames with a wrong CRC.
+     */
+    unsigned long long getNumCRCErrors() const { return numCRCErrors; }
+
+    /*!
+     * Returns the number of frames with an unknown version or type, or an
+     * unexpected length, and the number of bytes outside of any frame.
+     */
+    unsigned long long getNumFramingErrors() const { return numFramingErrors; }
+
+private:
+
+    /*!
+     * Decodes the payload of a frame that passed the CRC check.
+     *
+     * \return Whether the frame is a known type with the expected length.
+     */
+    bool decode(HeadRxPacket & packet) const;
+
+    /*!
+     * The frame being received and the number of bytes received so far.
+     */
+    uint8_t frame[HEAD_PROTOCOL_MAX_FRAME_SIZE];
+    size_t frameSize;
+
+    /*!
+     * Error counters.
+     */
+    unsigned long long numCRCErrors;
+    unsigned long long numFramingErrors;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_HEAD_SERIAL_PROTOCOL_HPP__
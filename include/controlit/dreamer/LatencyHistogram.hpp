@@ -0,0 +1,117 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_LATENCY_HISTOGRAM_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_LATENCY_HISTOGRAM_HPP__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * A histogram of durations with fixed-width buckets.
+ *
+ * All memory is allocated by init(), meaning record() and the percentile
+ * queries can be called from a real-time thread.  Values beyond the last
+ * bucket are counted in an overflow bucket; the exact maximum is tracked
+ * separately.
+ */
+class LatencyHistogram
+{
+public:
+    /*!
+     * The constructor.
+     */
+    LatencyHistogram();
+
+    /*!
+     * Initializes this histogram.
+     *
+     * \param[in] bucketWidth The width of each bucket in seconds.
+     * \param[in] numBuckets The number of buckets.  Values greater than
+     * bucketWidth * numBuckets fall into the overflow bucket.
+     * \return Whether the parameters are valid.
+     */
+    bool init(double bucketWidth, size_t numBuckets);
+
+    /*!
+     * Adds a value to this histogram.
+     *
+     * \param[in] value The value in seconds.
+     */
+    void record(double value);
+
+    /*!
+     * Removes all values from this histogram.
+     */
+    void reset();
+
+    /*!
+     * Adds the values recorded by another histogram to this one.  Both must
+     * have been initialized with the same bucket width and number of buckets.
+     *
+     * \param[in] other The histogram whose values to add.
+     */
+    void add(const LatencyHistogram & other);
+
+    /*!
+     * Returns the value below which the given fraction of the recorded
+     * values fall.  The result is the upper edge of the bucket containing
+     * the percentile, or the maximum if it is in the overflow bucket.
+     *
+     * \param[in] fraction The percentile as a fraction, e.g., 0.99.
+     * \return The percentile in seconds, or zero if no values were recorded.
+     */
+    double getPercentile(double fraction) const;
+
+    /*!
+     * Returns the largest recorded value in seconds.
+     */
+    double getMax() const { return maxValue; }
+
+    /*!
+     * Returns the smallest recorded value in seconds, or zero if no values
+     * were recorded.
+     */
+    double getMin() const { return count == 0 ? 0 : minValue; }
+
+    /*!
+     * Returns the number of recorded values.
+     */
+    unsigned long long getCount() const { return count; }
+
+    /*!
+     * Returns the number of recorded values that fell into the overflow bucket.
+     */
+    unsigned long long getOverflowCount() const { return overflowCount; }
+
+    /*!
+     * Returns a string representation of this class.
+     */
+    std::string toString(std::string const & prefix = "") const;
+
+private:
+
+    /*!
+     * The width of each bucket in seconds.
+     */
+    double bucketWidth;
+
+    /*!
+     * The number of values in each bucket.
+     */
+    std::vector<unsigned long long> buckets;
+
+    /*!
+     * Statistics.
+     */
+    unsigned long long count;
+    unsigned long long overflowCount;
+    double maxValue;
+    double minValue;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_LATENCY_HISTOGRAM_HPP__
@@ -0,0 +1,88 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_M3_COPY_PLAN_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_M3_COPY_PLAN_HPP__
+
+#include <cstddef>
+#include <vector>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * A list of byte ranges within a structure that need to be copied.
+ *
+ * This is used to copy only the parts of M3UTATorqueShmSdsStatus and
+ * M3UTATorqueShmSdsCommand that are actually used, rather than the entire
+ * structures.  Regions are added during initialization and then merged so
+ * that adjacent and overlapping regions are copied with a single memcpy.
+ */
+class M3CopyPlan
+{
+public:
+    /*!
+     * The constructor.
+     */
+    M3CopyPlan();
+
+    /*!
+     * Removes all regions from this plan.
+     */
+    void clear();
+
+    /*!
+     * Adds a region to this plan.
+     *
+     * \param[in] base The start of the structure the region is in.
+     * \param[in] start The start of the region.
+     * \param[in] size The number of bytes in the region.
+     */
+    void addRegion(const void * base, const void * start, size_t size);
+
+    /*!
+     * Sorts and merges the regions.  Must be called after the last
+     * region is added and before copy() is called.
+     */
+    void finalize();
+
+    /*!
+     * Copies the regions from one structure to another.
+     *
+     * \param[out] dest The start of the destination structure.
+     * \param[in] src The start of the source structure.
+     */
+    void copy(void * dest, const void * src) const;
+
+    /*!
+     * Returns the number of bytes copied by copy().
+     */
+    size_t getNumBytes() const { return numBytes; }
+
+    /*!
+     * Returns the number of regions in this plan.
+     */
+    size_t getNumRegions() const { return regions.size(); }
+
+private:
+
+    struct Region
+    {
+        size_t offset;
+        size_t size;
+
+        bool operator<(const Region & other) const { return offset < other.offset; }
+    };
+
+    /*!
+     * The regions to copy.
+     */
+    std::vector<Region> regions;
+
+    /*!
+     * The total number of bytes within the regions.
+     */
+    size_t numBytes;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_M3_COPY_PLAN_HPP__
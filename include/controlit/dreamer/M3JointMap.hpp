@@ -0,0 +1,383 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_M3_JOINT_MAP_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_M3_JOINT_MAP_HPP__
+
+#include <ros/ros.h>
+#include <controlit/RTControlModel.hpp>
+#include <controlit/addons/eigen/LinearAlgebra.hpp>
+#include <controlit/dreamer/DreamerJointLayout.hpp>
+#include <controlit/dreamer/M3CopyPlan.hpp>
+
+#include "m3uta/controllers/torque_shm_uta_sds.h"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using controlit::addons::eigen::Vector;
+
+namespace controlit {
+namespace dreamer {
+
+// M3 reports positions in degrees and torques in mNm.
+#define DEG_TO_RAD_SCALE (3.14159265359 / 180)
+#define RAD_TO_DEG_SCALE (180 / 3.14159265359)
+#define MNM_TO_NM_SCALE 1.0e-3
+#define NM_TO_MNM_SCALE 1.0e3
+
+/*!
+ * Maps ControlIt! joints to their locations within the M3 shared memory.
+ *
+ * The mapping is loaded once during initialization from ROS parameter
+ * "m3_joint_map" (see launch/dreamer_param_base.xml).  If the parameter is
+ * not present, Dreamer's default mapping is used.  Each entry specifies the
+ * M3 chain and slot of a joint along with an optional sign, scale, and
+ * position offset.  A joint's state is its M3 state multiplied by the sign
+ * and scale, and its command is divided by them, so that commanding the
+ * state that was read reproduces the M3 value.  The unit conversions
+ * between M3 (degrees, mNm) and ControlIt! (radians, Nm) are folded into the
+ * per-joint scale factors so that read() and write() reduce to a single loop
+ * over a flat table.
+ */
+class M3JointMap
+{
+public:
+    /*!
+     * The constructor.
+     */
+    M3JointMap();
+
+    /*!
+     * Initializes this joint map.
+     *
+     * \param[in] nh The ROS node handle to use during initialization.
+     * \param[in] status The status structure that gather() reads from.
+     * \param[in] command The command structure that scatter() writes to.
+     * \return Whether the initialization was successful.
+     */
+    bool init(ros::NodeHandle & nh, M3UTATorqueShmSdsStatus & status,
+        M3UTATorqueShmSdsCommand & command);
+
+    /*!
+     * Initializes this joint map with Dreamer's default joint map.  Unlike
+     * init(), this does not require ROS.
+     *
+     * \param[in] status The status structure that gather() reads from.
+     * \param[in] command The command structure that scatter() writes to.
+     * \return Whether the initialization was successful.
+     */
+    bool initDefault(M3UTATorqueShmSdsStatus & status, M3UTATorqueShmSdsCommand & command);
+
+    /*!
+     * Verifies that the joint map has one state entry per real joint of the
+     * robot model and one command entry per actuated joint.  read() and
+     * write() index the RobotState and Command by joint map entry, so a
+     * mismatch would access them out of bounds.
+     *
+     * \param[in] model The robot model.
+     * \return Whether the joint map matches the model.
+     */
+    bool checkModel(RTControlModel * model) const;
+
+    /*!
+     * Copies the joint states out of the status structure, converting
+     * them into ControlIt! units and joint order.
+     *
+     * \param[out] position The joint positions in radians.
+     * \param[out] velocity The joint velocities in radians per second.
+     * \param[out] effort The joint torques in Nm.
+     */
+    void gather(Vector & position, Vector & velocity, Vector & effort) const;
+
+    /*!
+     * Copies the effort command into the command structure, converting
+     * it into M3 units and joint order.
+     *
+     * \param[in] effort The effort command in Nm.
+     * \return A bit mask of the chains whose commands changed.  Bit n
+     * corresponds to the chain whose m3_chain_t value is n.
+     */
+    unsigned int scatter(const Vector & effort) const;
+
+    /*!
+     * The inverse of scatter().  Copies the effort command out of the
+     * command structure, converting it into ControlIt! units and joint order.
+     *
+     * \param[out] effort The effort command in Nm.
+     */
+    void gatherCommand(Vector & effort) const;
+
+    /*!
+     * Adds the parts of the status structure that are read by gather()
+     * to a copy plan.
+     *
+     * \param[out] plan The copy plan to add the regions to.
+     * \param[in] status The status structure that was passed to init().
+     */
+    void addStateRegions(M3CopyPlan & plan, const M3UTATorqueShmSdsStatus & status) const;
+
+    /*!
+     * Adds the parts of the command structure that are written by scatter()
+     * for a particular chain to a copy plan.
+     *
+     * \param[out] plan The copy plan to add the regions to.
+     * \param[in] command The command structure that was passed to init().
+     * \param[in] chain The chain whose regions to add.
+     */
+    void addCommandRegions(M3CopyPlan & plan, const M3UTATorqueShmSdsCommand & command,
+        m3_chain_t chain) const;
+
+    /*!
+     * Returns the number of joints whose state is read from shared memory.
+     */
+    size_t getNumStateJoints() const { return stateMap.size(); }
+
+    /*!
+     * Returns the number of joints whose command is written to shared memory.
+     */
+    size_t getNumCommandJoints() const { return commandMap.size(); }
+
+    /*!
+     * Returns a string representation of this class.
+     */
+    std::string toString(std::string const & prefix = "") const;
+
+private:
+
+    /*!
+     * Where in the status structure a joint's state is located.
+     */
+    struct StateEntry
+    {
+        std::string name;
+        m3_chain_t chain;
+        int slot;
+        const mReal * theta;
+        const mReal * thetadot;
+        const mReal * torque;
+        double positionScale;
+        double velocityScale;
+        double effortScale;
+        double positionOffset;
+    };
+
+    /*!
+     * Where in the command structure a joint's command is located.
+     */
+    struct CommandEntry
+    {
+        std::string name;
+        m3_chain_t chain;
+        int slot;
+        mReal * tqDesired;
+        double effortScale;
+    };
+
+    /*!
+     * A joint map entry as specified in the configuration.
+     */
+    struct EntrySpec
+    {
+        std::string name;
+        m3_chain_t chain;
+        int slot;
+        double sign;
+        double scale;
+        double offset;
+    };
+
+    /*!
+     * Parses one list of joint map entries.
+     *
+     * \param[in] list The list of entries obtained from the ROS parameter server.
+     * \param[in] listName The name of the list, used in error messages.
+     * \param[out] entries The entries that were parsed.
+     * \return Whether the list was successfully parsed.
+     */
+    bool parseEntries(XmlRpc::XmlRpcValue & list, const std::string & listName,
+        std::vector<EntrySpec> & entries);
+
+    /*!
+     * Obtains Dreamer's default joint map.  This controls the torso pitch
+     * joints and both arms.
+     */
+    void getDefaultSpecs(std::vector<EntrySpec> & stateSpecs,
+        std::vector<EntrySpec> & commandSpecs);
+
+    /*!
+     * Replaces the state and command maps with the given specifications.
+     */
+    bool initEntries(const std::vector<EntrySpec> & stateSpecs,
+        const std::vector<EntrySpec> & commandSpecs, M3UTATorqueShmSdsStatus & status,
+        M3UTATorqueShmSdsCommand & command);
+
+    /*!
+     * Adds an entry to the state map.
+     */
+    bool addStateEntry(M3UTATorqueShmSdsStatus & status, const EntrySpec & spec);
+
+    /*!
+     * Adds an entry to the command map.
+     */
+    bool addCommandEntry(M3UTATorqueShmSdsCommand & command, const EntrySpec & spec);
+
+    /*!
+     * Verifies that the mapped joints exist in the URDF and are not fixed.
+     */
+    void checkURDF() const;
+
+    /*!
+     * The state map, one entry per ControlIt! joint in ControlIt! joint order.
+     */
+    std::vector<StateEntry> stateMap;
+
+    /*!
+     * The command map, one entry per element of the ControlIt! effort command.
+     */
+    std::vector<CommandEntry> commandMap;
+};
+
+/*!
+ * Converts a chain name (e.g., "left_arm") to its m3_chain_t value.
+ *
+ * \param[in] name The name of the chain.
+ * \param[out] chain The chain.
+ * \return Whether the name is valid.
+ */
+bool m3ChainFromName(const std::string & name, m3_chain_t & chain);
+
+/*!
+ * Returns the name of a chain.
+ */
+const char * m3ChainName(m3_chain_t chain);
+
+/*!
+ * Returns the status of a particular chain within the status structure.
+ * This is inline so that it folds away when the chain is a constant.
+ */
+inline M3TorqueShmSdsBaseStatus & m3LimbStatus(M3UTATorqueShmSdsStatus & status, m3_chain_t chain)
+{
+    switch (chain)
+    {
+        case M3_CHAIN_RIGHT_ARM:  return status.right_arm;
+        case M3_CHAIN_LEFT_ARM:   return status.left_arm;
+        case M3_CHAIN_TORSO:      return status.torso;
+        case M3_CHAIN_HEAD:       return status.head;
+        case M3_CHAIN_RIGHT_HAND: return status.right_hand;
+        default:                  return status.left_hand;
+    }
+}
+
+/*!
+ * Returns the command of a particular chain within the command structure.
+ * This is inline so that it folds away when the chain is a constant.
+ */
+inline M3TorqueShmSdsBaseCommand & m3LimbCommand(M3UTATorqueShmSdsCommand & command, m3_chain_t chain)
+{
+    switch (chain)
+    {
+        case M3_CHAIN_RIGHT_ARM:  return command.right_arm;
+        case M3_CHAIN_LEFT_ARM:   return command.left_arm;
+        case M3_CHAIN_TORSO:      return command.torso;
+        case M3_CHAIN_HEAD:       return command.head;
+        case M3_CHAIN_RIGHT_HAND: return command.right_hand;
+        default:                  return command.left_hand;
+    }
+}
+
+// Ends the recursion of m3GatherJoints().
+template<typename Joints, size_t Index = 0>
+inline typename std::enable_if<(Index == Joints::size())>::type
+m3GatherJoints(M3UTATorqueShmSdsStatus &, double *, double *)
+{
+}
+
+/*!
+ * Copies the state of the joints of a fixed layout, such as
+ * DreamerHandJoints, out of the status structure, converting them into
+ * ControlIt! units.  The recursion over the joints is expanded at compile
+ * time and each joint's chain and slot are constants, so the copy reduces
+ * to loads from fixed offsets.
+ *
+ * \param[in] status The status structure.
+ * \param[out] position The joint positions in radians.
+ * \param[out] velocity The joint velocities in radians per second.
+ */
+template<typename Joints, size_t Index = 0>
+inline typename std::enable_if<(Index < Joints::size())>::type
+m3GatherJoints(M3UTATorqueShmSdsStatus & status, double * position, double * velocity)
+{
+    constexpr DreamerJoint joint = Joints::get(Index);
+    M3TorqueShmSdsBaseStatus const & limb = m3LimbStatus(status, joint.chain);
+    position[Index] = joint.sign * joint.scale * DEG_TO_RAD_SCALE * limb.theta[joint.slot];
+    velocity[Index] = joint.sign * joint.scale * DEG_TO_RAD_SCALE * limb.thetadot[joint.slot];
+    m3GatherJoints<Joints, Index + 1>(status, position, velocity);
+}
+
+// Ends the recursion of m3ScatterEfforts().
+template<typename Joints, size_t Index = 0>
+inline typename std::enable_if<(Index == Joints::size()), unsigned int>::type
+m3ScatterEfforts(M3UTATorqueShmSdsCommand &, const double *)
+{
+    return 0;
+}
+
+/*!
+ * Copies an effort command for the joints of a fixed layout into the
+ * command structure, converting it into M3 units.  Like m3GatherJoints(),
+ * this is expanded at compile time.
+ *
+ * \param[in] command The command structure.
+ * \param[in] effort The effort command in Nm.
+ * \return A bit mask of the chains whose commands changed, as returned by
+ * M3JointMap::scatter().
+ */
+template<typename Joints, size_t Index = 0>
+inline typename std::enable_if<(Index < Joints::size()), unsigned int>::type
+m3ScatterEfforts(M3UTATorqueShmSdsCommand & command, const double * effort)
+{
+    constexpr DreamerJoint joint = Joints::get(Index);
+    mReal & dest = m3LimbCommand(command, joint.chain).tq_desired[joint.slot];
+    mReal const value = NM_TO_MNM_SCALE * effort[Index] / (joint.sign * joint.scale);
+    unsigned int const dirtyMask = static_cast<unsigned int>(dest != value) << joint.chain;
+    dest = value;
+    return dirtyMask | m3ScatterEfforts<Joints, Index + 1>(command, effort);
+}
+
+// Ends the recursion of m3ScatterPositions().
+template<typename Joints, size_t Index = 0>
+inline typename std::enable_if<(Index == Joints::size()), unsigned int>::type
+m3ScatterPositions(M3UTATorqueShmSdsCommand &, const double *, double)
+{
+    return 0;
+}
+
+/*!
+ * Copies a position command for the joints of a fixed layout into the
+ * command structure, converting it into M3 units, and sets their slew rate.
+ * Like m3GatherJoints(), this is expanded at compile time.
+ *
+ * \param[in] command The command structure.
+ * \param[in] position The position command in radians.
+ * \param[in] slewRate The slew rate in M3 units.
+ * \return A bit mask of the chains whose commands changed, as returned by
+ * M3JointMap::scatter().
+ */
+template<typename Joints, size_t Index = 0>
+inline typename std::enable_if<(Index < Joints::size()), unsigned int>::type
+m3ScatterPositions(M3UTATorqueShmSdsCommand & command, const double * position, double slewRate)
+{
+    constexpr DreamerJoint joint = Joints::get(Index);
+    M3TorqueShmSdsBaseCommand & limb = m3LimbCommand(command, joint.chain);
+    mReal const value = RAD_TO_DEG_SCALE * position[Index] / (joint.sign * joint.scale);
+    mReal const rate = slewRate;
+    unsigned int const dirtyMask = static_cast<unsigned int>(limb.q_desired[joint.slot] != value
+        || limb.slew_rate_q_desired[joint.slot] != rate) << joint.chain;
+    limb.q_desired[joint.slot] = value;
+    limb.slew_rate_q_desired[joint.slot] = rate;
+    return dirtyMask | m3ScatterPositions<Joints, Index + 1>(command, position, slewRate);
+}
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_M3_JOINT_MAP_HPP__
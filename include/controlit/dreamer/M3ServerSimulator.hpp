@@ -0,0 +1,166 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_M3_SERVER_SIMULATOR_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_M3_SERVER_SIMULATOR_HPP__
+
+#include <controlit/dreamer/M3JointMap.hpp>
+#include <controlit/dreamer/SeqLock.hpp>
+#include <controlit/dreamer/SHMTransport.hpp>
+
+#include "m3uta/controllers/torque_shm_uta_sds.h"
+
+#include <memory>
+#include <string>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * Simulates the M3 server's side of the shared memory interface so that
+ * RobotInterfaceDreamer can be run closed-loop without the robot.
+ *
+ * Every joint of every chain is modeled as an independent rotational
+ * inertia with viscous damping driven by tq_desired.  The exception are
+ * head joints with a positive slew_rate_q_desired, which move toward
+ * q_desired at that rate like position-controlled joints.  The resulting theta,
+ * thetadot, and torque are published at a fixed rate.  Like the M3 server,
+ * the command's seqno is reflected in the status and the joints are
+ * disabled when the command's timestamp stops changing.
+ */
+class M3ServerSimulator
+{
+public:
+    /*!
+     * The constructor.
+     */
+    M3ServerSimulator();
+
+    /*!
+     * The destructor.
+     */
+    ~M3ServerSimulator();
+
+    /*!
+     * Initializes this simulator.  This creates the shared memory segment
+     * and its locks.
+     *
+     * \param[in] transportType The shared memory transport, either "rtai" or "posix".
+     * \param[in] useSeqLock Whether to exchange data using sequence locks
+     * instead of the transport's locks.
+     * \param[in] freq The rate at which to update the status in Hz.
+     * \param[in] inertia The inertia of each joint in kg*m^2.
+     * \param[in] damping The viscous damping of each joint in Nm*s/rad.
+     * \return Whether the initialization was successful.
+     */
+    bool init(const std::string & transportType, bool useSeqLock, double freq,
+        double inertia, double damping);
+
+    /*!
+     * Runs the simulation until stop() is called.
+     */
+    void run();
+
+    /*!
+     * Causes run() to return.  This is safe to call from a signal handler.
+     */
+    void stop();
+
+    /*!
+     * Returns a string representation of this class.
+     */
+    std::string toString(std::string const & prefix = "") const;
+
+private:
+
+    /*!
+     * Copies the latest command out of shared memory.
+     */
+    void readCommand();
+
+    /*!
+     * Integrates the joint dynamics of one chain over one period.
+     */
+    void stepChain(m3_chain_t chain);
+
+    /*!
+     * Copies the status into shared memory.
+     */
+    void writeStatus();
+
+    /*!
+     * The shared memory transport.
+     */
+    std::unique_ptr<SHMTransport> transport;
+
+    /*!
+     * A pointer to the shared memory.
+     */
+    M3Sds * sharedMemoryPtr;
+
+    /*!
+     * Whether to use sequence locks instead of the transport's locks.
+     */
+    bool useSeqLock;
+
+    /*!
+     * The sequence locks protecting the status and command blocks.
+     */
+    SeqLock statusSeqLock;
+    SeqLock commandSeqLock;
+
+    /*!
+     * The simulation period in seconds.
+     */
+    double period;
+
+    /*!
+     * The joint model parameters.
+     */
+    double inertia;
+    double damping;
+
+    /*!
+     * Whether the simulation should continue running.
+     */
+    volatile bool continueRunning;
+
+    /*!
+     * Whether the joints are enabled, i.e., the controller is sending
+     * fresh commands.
+     */
+    bool enabled;
+
+    /*!
+     * The number of cycles since the command timestamp last changed.
+     */
+    int staleCommandCycles;
+
+    /*!
+     * The timestamp of the previous command.
+     */
+    long long prevCommandTimestamp;
+
+    /*!
+     * The simulated joint positions and velocities in radians and radians per
+     * second.  These are kept in double precision separately from the
+     * status, which may use single precision.
+     */
+    double position[M3_NUM_CHAINS][MAX_NDOF];
+    double velocity[M3_NUM_CHAINS][MAX_NDOF];
+
+    /*!
+     * The status and command.
+     */
+    M3UTATorqueShmSdsStatus status;
+    M3UTATorqueShmSdsCommand command;
+
+    /*!
+     * Statistics.
+     */
+    unsigned long long cycleCount;
+    unsigned long long overrunCount;
+    unsigned long long commandReadFailures;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_M3_SERVER_SIMULATOR_HPP__
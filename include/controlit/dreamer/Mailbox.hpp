@@ -0,0 +1,110 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_MAILBOX_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_MAILBOX_HPP__
+
+#include <atomic>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * A lock-free, single-slot mailbox for passing the latest value of type T
+ * from one producer thread to one consumer thread.
+ *
+ * It is implemented as a triple buffer.  The producer and consumer each own
+ * one slot and exchange it with a shared middle slot using a single atomic
+ * operation, meaning neither side ever blocks or makes a system call.  Values
+ * that are not read before the next write are overwritten.  T must be
+ * copy-assignable without allocating memory.
+ */
+template<typename T>
+class Mailbox
+{
+public:
+    /*!
+     * The constructor.
+     */
+    Mailbox() :
+        backIndex(0),
+        middleIndex(1),
+        frontIndex(2)
+    {
+    }
+
+    /*!
+     * Initializes every slot of this mailbox.  This must be called before
+     * the producer and consumer threads start.
+     *
+     * \param[in] value The initial value.
+     */
+    void init(const T & value)
+    {
+        for (int ii = 0; ii < 3; ii++)
+            slots[ii] = value;
+
+        middleIndex.store(1, std::memory_order_release);
+    }
+
+    /*!
+     * Saves a value in this mailbox.  Only called by the producer.
+     *
+     * \param[in] value The value to save.
+     */
+    void write(const T & value)
+    {
+        slots[backIndex] = value;
+
+        // Publish the slot and take back whichever slot was in the middle.
+        unsigned int const prev = middleIndex.exchange(backIndex | FRESH_BIT, std::memory_order_acq_rel);
+        backIndex = prev & INDEX_MASK;
+    }
+
+    /*!
+     * Obtains the latest value from this mailbox.  Only called by the consumer.
+     *
+     * \param[out] value Where to save the value.  It is not modified if
+     * there is no new value.
+     * \return Whether a new value was received since the last call.
+     */
+    bool read(T & value)
+    {
+        if (!(middleIndex.load(std::memory_order_relaxed) & FRESH_BIT))
+            return false;
+
+        unsigned int const prev = middleIndex.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = prev & INDEX_MASK;
+
+        value = slots[frontIndex];
+        return true;
+    }
+
+private:
+
+    static const unsigned int INDEX_MASK = 0x3;
+    static const unsigned int FRESH_BIT = 0x4;
+
+    /*!
+     * The three slots.
+     */
+    T slots[3];
+
+    /*!
+     * The slot being written by the producer.
+     */
+    alignas(64) unsigned int backIndex;
+
+    /*!
+     * The shared slot.  FRESH_BIT is set when it contains a value that
+     * the consumer has not yet read.
+     */
+    alignas(64) std::atomic<unsigned int> middleIndex;
+
+    /*!
+     * The slot being read by the consumer.
+     */
+    alignas(64) unsigned int frontIndex;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_MAILBOX_HPP__
@@ -17,6 +17,12 @@ namespace dreamer {
 
 /*!
  * Supplies odometry information based on shared memory.
+ *
+ * Dreamer is fixed to the world, so the base state is always zero.  In
+ * fixed-base mode (ROS parameter "fixed_base", the default), the base state
+ * is only written when the RobotState passed to getOdometry() does not
+ * already hold it, e.g., the first time or after the RobotState was
+ * reinitialized.  Otherwise, getOdometry() only compares the base state.
  */
 class OdometryStateReceiverDreamer : public OdometryStateReceiver
 {
@@ -51,6 +57,24 @@ public:
 
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 private:
+
+    /*!
+     * Whether a RobotState already holds the base state.
+     */
+    bool hasBaseState(const controlit::RobotState & robotState) const;
+
+    /*!
+     * Whether the base is fixed to the world.
+     */
+    bool fixedBase;
+
+    /*!
+     * The base state.  These are pre-allocated to avoid creating
+     * temporaries in the servo loop.
+     */
+    Vector3d basePosition;
+    Eigen::Quaterniond baseOrientation;
+    Vector baseVelocity;
 };
 
 } // namespace dreamer
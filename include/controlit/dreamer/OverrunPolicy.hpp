@@ -0,0 +1,148 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_OVERRUN_POLICY_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_OVERRUN_POLICY_HPP__
+
+#include <ros/ros.h>
+
+#include <atomic>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * Flags that describe what happened during a servo cycle.
+ */
+enum ServoCycleFlags
+{
+    SERVO_CYCLE_MISSED_PERIOD = 1 << 0,  // the cycle started a full period or more late
+    SERVO_CYCLE_LOW_SLACK     = 1 << 1,  // non-critical work was skipped
+    SERVO_CYCLE_HELD          = 1 << 2,  // servoUpdate() was skipped and the last command held
+    SERVO_CYCLE_RATE_FALLBACK = 1 << 3   // the servo period was increased
+};
+
+/*!
+ * Decides how a servo clock degrades when servoUpdate() does not fit in
+ * its period.  There are three steps:
+ *
+ *   1. If the slack predicted for the current cycle is below a threshold,
+ *      isSlackLow() returns true during the cycle.  The robot interface
+ *      then skips non-critical work like publishing statistics, the latency
+ *      probes, and exchanging data with the hand and head controllers.
+ *   2. If a cycle starts a full period or more late, servoUpdate() is
+ *      skipped and the M3 server keeps applying the last torque command.
+ *      This stops the servo clock from running back-to-back cycles to
+ *      catch up.
+ *   3. After a number of consecutive cycles in which servoUpdate() ran and
+ *      overran, the servo period is increased by a factor, as long as the
+ *      frequency stays above a minimum.
+ *
+ * beginCycle() and endCycle() are called by the servo thread and neither
+ * allocate memory nor make system calls.  When the policy is disabled,
+ * they only report missed periods.
+ */
+class OverrunPolicy
+{
+public:
+    /*!
+     * The constructor.
+     */
+    OverrunPolicy();
+
+    /*!
+     * Initializes this class.  This must be called before the servo thread starts.
+     *
+     * \param[in] nh The node handle from which to obtain the parameters.
+     * \param[in] period The nominal servo period in seconds.
+     */
+    void init(ros::NodeHandle & nh, double period);
+
+    /*!
+     * Called at the start of each cycle, before servoUpdate().
+     *
+     * \param[in] lateness How late the cycle started in seconds.
+     * \return A combination of SERVO_CYCLE_MISSED_PERIOD, SERVO_CYCLE_LOW_SLACK,
+     * and SERVO_CYCLE_HELD.  If SERVO_CYCLE_HELD is set, the servo clock must
+     * not call servoUpdate().
+     */
+    unsigned int beginCycle(double lateness);
+
+    /*!
+     * Called at the end of each cycle.
+     *
+     * \param[in] computeTime How long servoUpdate() took in seconds.
+     * \param[in] slack The time remaining until the next period starts in seconds.
+     * \param[in] held Whether servoUpdate() was skipped.
+     * \return SERVO_CYCLE_RATE_FALLBACK if the servo clock must switch to
+     * getPeriod(), otherwise zero.
+     */
+    unsigned int endCycle(double computeTime, double slack, bool held);
+
+    /*!
+     * Returns the current servo period in seconds.
+     */
+    double getPeriod() const { return period; }
+
+    /*!
+     * Whether the robot interface should skip non-critical work during
+     * the current servo cycle.
+     */
+    static bool isSlackLow() { return slackLow.load(std::memory_order_relaxed); }
+
+private:
+
+    /*!
+     * Whether the policy is enabled.
+     */
+    bool enabled;
+
+    /*!
+     * The predicted slack below which non-critical work is skipped, in seconds.
+     */
+    double slackThreshold;
+
+    /*!
+     * Whether to skip servoUpdate() when a cycle starts a full period late.
+     */
+    bool holdOnMiss;
+
+    /*!
+     * The number of consecutive overruns after which the servo period is
+     * increased.  Zero disables the rate fallback.
+     */
+    int fallbackCount;
+
+    /*!
+     * The factor by which the period is increased.
+     */
+    double fallbackFactor;
+
+    /*!
+     * The longest period to which the policy falls back, in seconds.
+     */
+    double maxPeriod;
+
+    /*!
+     * The current servo period in seconds.
+     */
+    double period;
+
+    /*!
+     * How long servoUpdate() took in the most recent cycle in which it ran.
+     */
+    double lastComputeTime;
+
+    /*!
+     * The number of consecutive cycles in which servoUpdate() ran and overran.
+     */
+    int consecutiveOverruns;
+
+    /*!
+     * Whether the current cycle's slack is low.  There is only one servo
+     * loop per process.
+     */
+    static std::atomic<bool> slackLow;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_OVERRUN_POLICY_HPP__
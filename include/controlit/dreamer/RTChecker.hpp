@@ -0,0 +1,191 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_RT_CHECKER_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_RT_CHECKER_HPP__
+
+#include <stddef.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define RT_CHECKER_MAX_FRAMES 16
+
+// The preload library defines these functions.  Everyone else sees weak
+// declarations that are null unless the library was loaded via LD_PRELOAD.
+#ifdef CONTROLIT_DREAMER_RT_CHECKER_PRELOAD
+#define RT_CHECKER_API __attribute__((visibility("default")))
+#else
+#define RT_CHECKER_API __attribute__((weak))
+#endif
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * A heap allocation or system call that happened while the calling thread
+ * was armed.
+ */
+struct RTCheckerEvent
+{
+    /*!
+     * The name of the intercepted function, e.g., "malloc" or "write".
+     */
+    const char * function;
+
+    /*!
+     * The number of bytes requested, for allocations.
+     */
+    size_t size;
+
+    /*!
+     * The backtrace of the call, starting at the caller of the
+     * intercepted function.
+     */
+    int numFrames;
+    void * frames[RT_CHECKER_MAX_FRAMES];
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+extern "C" {
+
+/*!
+ * Starts and stops intercepting allocations and system calls made by the
+ * calling thread.
+ */
+RT_CHECKER_API void controlit_dreamer_rt_checker_arm();
+RT_CHECKER_API void controlit_dreamer_rt_checker_disarm();
+
+/*!
+ * Removes up to maxEvents recorded events.
+ *
+ * \param[out] events Where to save the events.
+ * \param[in] maxEvents The capacity of events.
+ * \param[out] numDropped The number of events that were dropped because
+ * the queue was full since the previous call.
+ * \return The number of events saved.
+ */
+RT_CHECKER_API size_t controlit_dreamer_rt_checker_drain(controlit::dreamer::RTCheckerEvent * events,
+    size_t maxEvents, size_t * numDropped);
+
+} // extern "C"
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * Detects heap allocations and system calls in the servo loop.
+ *
+ * The detection is done by libcontrolit_dreamer_rt_checker.so, which
+ * interposes malloc(), free(), and the libc system call wrappers and must
+ * be loaded via LD_PRELOAD.  The servo thread brackets each call to
+ * servoUpdate() with arm() and disarm(), which are cheap and safe to call
+ * from the real-time thread.  A non-real-time thread periodically calls
+ * report(), which logs each new call site once with its backtrace.
+ *
+ * Only calls that go through the dynamic symbol table are intercepted.
+ * System calls made internally by libc, e.g., when stdio flushes a
+ * buffer, and inline syscall instructions are not detected.
+ */
+class RTChecker
+{
+public:
+    /*!
+     * The constructor.
+     */
+    RTChecker();
+
+    /*!
+     * Initializes this class.  This must be called before the servo
+     * thread starts.
+     *
+     * \param[in] enabled Whether to check the servo loop.
+     * \return Whether the checker is active.  This is false if it is
+     * disabled or if the preload library is not loaded.
+     */
+    bool init(bool enabled);
+
+    /*!
+     * Starts intercepting the calling thread's allocations and system calls.
+     */
+    inline void arm()
+    {
+        if (active) controlit_dreamer_rt_checker_arm();
+    }
+
+    /*!
+     * Stops intercepting the calling thread's allocations and system calls.
+     */
+    inline void disarm()
+    {
+        if (active) controlit_dreamer_rt_checker_disarm();
+    }
+
+    /*!
+     * Reports the recorded events.  This is called by a non-real-time thread.
+     */
+    void report();
+
+    /*!
+     * Returns the number of events reported so far, including the ones
+     * dropped by the preload library.
+     */
+    unsigned long long getNumEvents() const { return numEvents; }
+
+    /*!
+     * Returns a summary of all call sites that were detected.
+     */
+    std::string toString(std::string const & prefix = "") const;
+
+private:
+
+    /*!
+     * The statistics of a call site.
+     */
+    struct CallSite
+    {
+        const char * function;
+        unsigned long long count;
+        unsigned long long bytes;
+    };
+
+    /*!
+     * Returns the demangled symbol of a code address.
+     */
+    static std::string symbolize(void * address);
+
+    /*!
+     * Returns the symbolized backtrace of an event.
+     */
+    static std::string getBacktrace(const RTCheckerEvent & event, std::string const & prefix);
+
+    /*!
+     * Whether the checker is enabled and the preload library is loaded.
+     */
+    bool active;
+
+    /*!
+     * The buffer into which report() drains events.
+     */
+    std::vector<RTCheckerEvent> events;
+
+    /*!
+     * The call sites that were detected, keyed by their backtraces.
+     */
+    std::map<std::vector<void *>, CallSite> callSites;
+
+    /*!
+     * The number of events dropped by the preload library.
+     */
+    unsigned long long numDropped;
+
+    /*!
+     * The number of events reported, including the dropped ones.
+     */
+    unsigned long long numEvents;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_RT_CHECKER_HPP__
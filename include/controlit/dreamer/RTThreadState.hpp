@@ -0,0 +1,41 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_RT_THREAD_STATE_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_RT_THREAD_STATE_HPP__
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * The states of a servo clock's real-time thread.  The real-time thread
+ * sets the state and the thread that spawned it waits for the state to
+ * become RT_THREAD_RUNNING or RT_THREAD_ERROR.
+ */
+typedef enum {
+    RT_THREAD_UNDEF,
+    RT_THREAD_INIT,
+    RT_THREAD_RUNNING,
+    RT_THREAD_CLEANUP,
+    RT_THREAD_ERROR,
+    RT_THREAD_DONE
+} rt_thread_state_t;
+
+/*!
+ * Returns the name of a real-time thread state.
+ */
+inline const char * rtThreadStateToString(rt_thread_state_t state)
+{
+    switch (state)
+    {
+        case RT_THREAD_UNDEF:   return "RT_THREAD_UNDEF";
+        case RT_THREAD_INIT:    return "RT_THREAD_INIT";
+        case RT_THREAD_RUNNING: return "RT_THREAD_RUNNING";
+        case RT_THREAD_CLEANUP: return "RT_THREAD_CLEANUP";
+        case RT_THREAD_ERROR:   return "RT_THREAD_ERROR";
+        case RT_THREAD_DONE:    return "RT_THREAD_DONE";
+        default:                return "Invalid state";
+    }
+}
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_RT_THREAD_STATE_HPP__
@@ -5,13 +5,23 @@
 #include <controlit/RobotInterface.hpp>
 #include <controlit/dreamer/HandControllerDreamer.hpp>
 #include <controlit/dreamer/HeadControllerDreamer.hpp>
-
-// #include <thread>  // for std::mutex
+#include <controlit/dreamer/FlightRecorder.hpp>
+#include <controlit/dreamer/LatencyHistogram.hpp>
+#include <controlit/dreamer/M3CopyPlan.hpp>
+#include <controlit/dreamer/M3JointMap.hpp>
+#include <controlit/dreamer/Mailbox.hpp>
+#include <controlit/dreamer/SeqLock.hpp>
+#include <std_msgs/Float64MultiArray.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <time.h>
 #include <unistd.h>
 #include "m3uta/controllers/torque_shm_uta_sds.h"
 #include <urdf/model.h>
 
-#include <rtai_sem.h> // for SEM
+#include <controlit/dreamer/SHMTransport.hpp>
 
 using std::chrono::high_resolution_clock;
 using std::chrono::duration_cast;
@@ -19,6 +29,42 @@ using std::chrono::duration_cast;
 namespace controlit {
 namespace dreamer {
 
+// The number of outstanding sequence numbers whose send times are remembered.
+// Must be a power of two.
+#define RTT_SEND_TIME_RING_SIZE 64
+
+/*!
+ * The joint state passed from the servo thread to an auxiliary controller
+ * thread, in radians and radians per second.
+ */
+template<int NumJoints>
+struct AuxiliaryJointState
+{
+    double position[NumJoints];
+    double velocity[NumJoints];
+};
+
+/*!
+ * The command passed from an auxiliary controller thread to the servo thread.
+ */
+template<int NumJoints>
+struct AuxiliaryJointCommand
+{
+    double command[NumJoints];
+};
+
+/*!
+ * Selects the servo cycles in which a subsystem does its work: every
+ * divider cycles, starting at cycle phase.
+ */
+struct RateDivider
+{
+    unsigned int divider;
+    unsigned int phase;
+
+    bool isDue(unsigned long long cycle) const { return cycle % divider == phase; }
+};
+
 /*!
  * A robot interface to Dreamer hardware.  This communicates with Dreamer via
  * shared memory created by the M3 server.
@@ -71,10 +117,28 @@ public:
      */
     virtual std::shared_ptr<Timer> getTimer();
 
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 private:
 
     /*!
-     * This is executed by the real-time thread. It initializes the connection to shared memory.
+     * Times the stages of read() and write() without ROS.  It sets up the
+     * members those stages use in place of init().
+     */
+    friend class RobotInterfaceDreamerBenchmark;
+
+    /*!
+     * Repeatedly calls initSM() with exponential backoff until it succeeds.
+     * This is executed during initialization, before the servo thread starts.
+     *
+     * \param[in] timeout The maximum time to wait in seconds.  A value less
+     * than or equal to zero means wait forever.
+     * \param[in] maxBackoff The maximum time between attempts in seconds.
+     * \return Whether the connection to shared memory was established.
+     */
+    bool waitForSM(double timeout, double maxBackoff);
+
+    /*!
+     * Initializes the connection to shared memory.
      */
     bool initSM();
 
@@ -88,31 +152,265 @@ private:
 
     void printSHMCommand();
 
+    /*!
+     * Copies the status out of shared memory and into shm_status.
+     *
+     * \return Whether the copy was successful.
+     */
+    bool readSHMStatus();
+
+    /*!
+     * Copies shm_cmd into shared memory.
+     */
+    void writeSHMCommand();
+
+    /*!
+     * Copies the parts of shm_cmd that changed into shared memory.  The
+     * caller must hold the command semaphore or sequence lock.
+     *
+     * \return The number of bytes copied.
+     */
+    size_t copySHMCommand();
+
+    /*!
+     * Builds the copy plans that determine which parts of shm_status and
+     * shm_cmd are exchanged with shared memory.
+     */
+    void initCopyPlans();
+
+    /*!
+     * Copies the joint states in the joint map from shm_status into a robot
+     * state, converting them into ControlIt! units and joint order.
+     *
+     * \param[out] latestRobotState The robot state to update.
+     */
+    void readJointState(controlit::RobotState & latestRobotState);
+
+    /*!
+     * Copies the latest command from the hand controller thread into shm_cmd.
+     */
+    void writeHandCommand();
+
+    /*!
+     * Copies the latest position command from the head controller thread
+     * into shm_cmd.  Until the first command arrives, this commands the
+     * head's current position.  Only used by the shared memory backend.
+     */
+    void writeHeadCommand();
+
+    /*!
+     * Pass the latest hand or head joint state from shm_status to its
+     * controller thread.
+     */
+    void publishHandState();
+    void publishHeadState();
+
+    /*!
+     * Periodically publishes the shared memory exchange statistics.
+     */
+    void publishSHMStats();
+
+    /*!
+     * Records the round trip latency of the command whose sequence number
+     * was most recently reflected by the M3 server.
+     */
+    void recordRTT();
+
+    /*!
+     * Periodically publishes the round trip latency statistics.
+     */
+    void publishRTTStats();
+
+    /*!
+     * Starts the threads that run the hand and head controllers.
+     *
+     * \param[in] nh The ROS node handle from which to obtain the thread parameters.
+     * \param[in] servoFrequency The servo frequency in Hz.
+     * \return Whether the threads were started.
+     */
+    bool startAuxiliaryThreads(ros::NodeHandle & nh, double servoFrequency);
+
+    /*!
+     * Initializes the mailboxes shared with the hand and head controller
+     * threads and the servo thread's copies of their values.
+     */
+    void initMailboxes();
+
+    /*!
+     * Stops the threads that run the hand and head controllers.
+     */
+    void stopAuxiliaryThreads();
+
+    /*!
+     * The bodies of the hand and head controller threads.  Each thread
+     * times itself and picks up the latest state from its mailbox, so the
+     * servo thread never makes a system call to wake it.
+     *
+     * \param[in] startTime The time on CLOCK_MONOTONIC shared by both threads.
+     * \param[in] offsetNs The time after startTime at which to run first,
+     * which staggers the threads.
+     * \param[in] periodNs The time between iterations.
+     */
+    void handThreadLoop(struct timespec startTime, long long offsetNs, long long periodNs);
+    void headThreadLoop(struct timespec startTime, long long offsetNs, long long periodNs);
+
     /*!
      * Whether the shared memory variables are initialized.
      */
     bool sharedMemoryReady;
 
     /*!
-     * Maps the name of a joint to its index within the shared memory.
+     * Maps the ControlIt! joints to their locations within shm_status and shm_cmd.
+     */
+    M3JointMap jointMap;
+
+    /*!
+     * The joint positions, velocities, and efforts obtained from shm_status,
+     * in ControlIt! units and joint order.
+     */
+    Vector jointPositions;
+    Vector jointVelocities;
+    Vector jointEfforts;
+
+    /*!
+     * Provides access to the shared memory and the locks protecting it.
+     * This is either RTAI-based or POSIX-based depending on ROS parameter
+     * "shm_transport".
      */
-    std::map<std::string, int> jointNameMap;
+    std::unique_ptr<SHMTransport> transport;
 
     /*!
      * A pointer to the shared memory used to communicate with the M3
-     * server.  M3Sds stands for "M3 Shared Data Structure".
+     * server.  M3Sds stands for "M3 Shared Data Structure".  This is
+     * obtained from the transport.
      */
     M3Sds * sharedMemoryPtr;
 
     /*!
-     * A pointer to the semaphore protecting the status register.
+     * Whether to exchange data with the M3 server using sequence locks
+     * instead of the transport's locks.  This requires an M3 server that
+     * implements the same protocol.
      */
-    SEM * status_sem;
+    bool useSeqLock;
 
     /*!
-     * A pointer to the semaphore protecting the command register.
+     * The maximum number of times to retry reading a torn status.
      */
-    SEM * command_sem;
+    unsigned int maxSeqLockRetries;
+
+    /*!
+     * The sequence lock protecting the status block in shared memory.
+     */
+    SeqLock statusSeqLock;
+
+    /*!
+     * The sequence lock protecting the command block in shared memory.
+     */
+    SeqLock commandSeqLock;
+
+    /*!
+     * Statistics on the exchange of data with the M3 server.
+     */
+    unsigned long long statusReadCount;
+    unsigned long long statusRetryCount;
+    unsigned long long statusReadFailureCount;
+    unsigned int maxStatusRetries;
+    unsigned long long commandWriteCount;
+    unsigned long long commandBytesTotal;
+
+    /*!
+     * The parts of shm_status that are read from shared memory.  Only
+     * the limbs and slots that are actually used are copied.
+     */
+    M3CopyPlan statusCopyPlan;
+
+    /*!
+     * The parts of shm_cmd that are written to shared memory every cycle.
+     */
+    M3CopyPlan commandHeaderCopyPlan;
+
+    /*!
+     * The parts of shm_cmd that belong to each chain.  These are only
+     * written to shared memory when the chain's command changes.
+     */
+    M3CopyPlan commandCopyPlans[M3_NUM_CHAINS];
+
+    /*!
+     * A bit mask of the chains whose commands changed since the last
+     * write to shared memory.
+     */
+    unsigned int commandDirtyMask;
+
+    /*!
+     * Whether the entire shm_cmd needs to be written to shared memory.
+     * This is true for the first write after connecting to shared memory.
+     */
+    bool fullCommandWritePending;
+
+    /*!
+     * Publishes the shared memory exchange statistics.  The elements are:
+     *
+     *   0: number of status reads
+     *   1: total number of status read retries
+     *   2: number of status reads that failed after exhausting all retries
+     *   3: maximum number of retries of a single status read
+     *   4: number of bytes copied per status read
+     *   5: average number of bytes copied per command write
+     */
+    controlit::addons::ros::RealtimePublisher<std_msgs::Float64MultiArray> shmStatsPublisher;
+
+    /*!
+     * Whether every command is stamped with a new sequence number and the
+     * round trip latency of every reflected sequence number is recorded.
+     * If false, the round trip latency is only measured when requested
+     * through the parent class' sendSeqno flag.
+     */
+    bool continuousRTT;
+
+    /*!
+     * Provides the send and receive times of the sequence numbers.
+     */
+    std::shared_ptr<Timer> rttClock;
+
+    /*!
+     * The times at which the most recent sequence numbers were sent,
+     * indexed by sequence number modulo RTT_SEND_TIME_RING_SIZE.
+     */
+    double rttSendTimes[RTT_SEND_TIME_RING_SIZE];
+
+    /*!
+     * The last sequence number reflected by the M3 server.
+     */
+    int lastReflectedSeqno;
+
+    /*!
+     * The number of reflected sequence numbers that did not match a
+     * remembered send time.
+     */
+    unsigned long long rttUnmatchedCount;
+
+    /*!
+     * The distribution of round trip latencies since initialization.
+     */
+    LatencyHistogram rttHistogram;
+
+    /*!
+     * Publishes the round trip latency statistics.  The elements are:
+     *
+     *   0: number of latency samples
+     *   1: 50th percentile latency in seconds
+     *   2: 99th percentile latency in seconds
+     *   3: 99.9th percentile latency in seconds
+     *   4: maximum latency in seconds
+     *   5: number of reflected sequence numbers without a send time
+     *   6: number of samples beyond the last histogram bucket
+     */
+    controlit::addons::ros::RealtimePublisher<std_msgs::Float64MultiArray> rttStatsPublisher;
+
+    /*!
+     * Records the raw status and command of every servo cycle.
+     */
+    FlightRecorder flightRecorder;
 
     /*!
      * Holds a copy of the status that was read from the shared memory.
@@ -126,44 +424,115 @@ private:
     M3UTATorqueShmSdsCommand shm_cmd;
 
     /*!
-     * The object that generates the commands for the hands.
+     * The object that generates the commands for the hands.  It runs in
+     * handThread.  It is created by init() since its publishers require a
+     * ROS master.
+     */
+    std::unique_ptr<HandControllerDreamer> handController;
+
+    /*!
+     * The current hand joint positions.  Only accessed by handThread.
+     */
+    HandControllerDreamer::JointVector handJointPositions;
+
+    /*!
+     * The current hand joint velocities.  Only accessed by handThread.
+     */
+    HandControllerDreamer::JointVector handJointVelocities;
+
+    /*!
+     * The command to send to the hand.  Only accessed by handThread.
+     */
+    HandControllerDreamer::JointVector handCommand;
+
+    /*!
+     * The object that generates the commands for the head.  It runs in
+     * headThread.  Like handController, it is created by init().
+     */
+    std::unique_ptr<HeadControllerDreamer> headController;
+
+    /*!
+     * The current head joint positions.  Only accessed by headThread.
+     */
+    HeadControllerDreamer::JointVector headJointPositions;
+
+    /*!
+     * The current head joint velocities.  Only accessed by headThread.
+     */
+    HeadControllerDreamer::JointVector headJointVelocities;
+
+    /*!
+     * The command to send to the head.  Only accessed by headThread.
+     */
+    HeadControllerDreamer::JointVector headCommand;
+
+    /*!
+     * How the head commands reach the head.  With the serial backend, the
+     * head controller sends them itself.  With the shared memory backend,
+     * they are written into shm_cmd.head.
+     */
+    HeadBackend headBackend;
+
+    /*!
+     * The slew rate limit applied by the M3 server to the head's desired
+     * positions in degrees per second.  Only used by the shared memory
+     * backend.
      */
-    HandControllerDreamer handController;
+    double headSlewRate;
 
     /*!
-     * The current hand joint positions.
+     * Whether a command was received from the head controller thread.
+     * Until then, the shared memory backend holds the head where it is.
      */
-    Vector handJointPositions;
+    bool headCommandReceived;
 
     /*!
-     * The current hand joint velocities.
+     * Pass the hand and head state from the servo thread to the auxiliary
+     * controller threads and the hand and head commands back.  The head
+     * command is only passed back by the shared memory backend.
      */
-    Vector handJointVelocities;
+    Mailbox<AuxiliaryJointState<NUM_HAND_JOINTS>> handStateMailbox;
+    Mailbox<AuxiliaryJointCommand<NUM_HAND_JOINTS>> handCommandMailbox;
+    Mailbox<AuxiliaryJointState<NUM_HEAD_JOINTS>> headStateMailbox;
+    Mailbox<AuxiliaryJointCommand<NUM_HEAD_JOINTS>> headCommandMailbox;
 
     /*!
-     * The command to send to the hand.
+     * The servo thread's copies of the values exchanged through the mailboxes.
      */
-    Vector handCommand;
+    AuxiliaryJointState<NUM_HAND_JOINTS> handStateSample;
+    AuxiliaryJointCommand<NUM_HAND_JOINTS> handCommandSample;
+    AuxiliaryJointState<NUM_HEAD_JOINTS> headStateSample;
+    AuxiliaryJointCommand<NUM_HEAD_JOINTS> headCommandSample;
 
     /*!
-     * The object that generates the commands for the head.
+     * The threads that run the hand and head controllers at a lower
+     * priority than the servo thread.
      */
-    HeadControllerDreamer headController;
+    std::thread handThread;
+    std::thread headThread;
 
     /*!
-     * The current head joint positions.
+     * Whether the auxiliary controller threads should continue running.
      */
-    Vector headJointPositions;
+    std::atomic<bool> auxiliaryThreadsRunning;
 
     /*!
-     * The current head joint velocities.
+     * The servo cycles in which data is exchanged with the hand and head
+     * controller threads.  Their phases are staggered so that both never
+     * land in the same cycle.  The threads run at the same rates on their
+     * own timers rather than being woken by the servo thread, since waking
+     * a blocked thread is a system call that would take the RTAI servo
+     * thread out of hard real-time mode.
      */
-    Vector headJointVelocities;
+    RateDivider handRate;
+    RateDivider headRate;
 
     /*!
-     * The command to send to the head.
+     * Whether the current servo cycle exchanges data with the hand or head
+     * controller thread.  Set by read() and used by write().
      */
-    Vector headCommand;    
+    bool handCycle;
+    bool headCycle;
 };
 
 } // namespace dreamer
@@ -0,0 +1,187 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_ROBOT_INTERFACE_DREAMER_REPLAY_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_ROBOT_INTERFACE_DREAMER_REPLAY_HPP__
+
+#include <controlit/RobotInterface.hpp>
+#include <controlit/dreamer/FlightRecorder.hpp>
+#include <controlit/dreamer/LatencyHistogram.hpp>
+#include <controlit/dreamer/M3JointMap.hpp>
+
+#include "m3uta/controllers/torque_shm_uta_sds.h"
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * A robot interface that replays frames recorded by FlightRecorder instead
+ * of communicating with the M3 server.
+ *
+ * Each call to read() supplies the robot state from the next recorded
+ * status once it is due, and otherwise from the same status as the previous
+ * call.  read() never blocks, so the servo clock alone determines how often
+ * the controller runs.  The effort command passed to write() is optionally saved to a
+ * CSV file along with the command that was recorded for the same frame.
+ * The time between read() and write(), i.e., the controller's compute
+ * time, is tracked in a histogram that is printed when replay finishes.
+ *
+ * Neither RTAI nor the robot is required.  The replay rate is set by ROS
+ * parameter "replay_rate": 1.0 replays at the recorded rate, 2.0 at twice
+ * the recorded rate, and 0 replays a new frame on every call to read().  To
+ * replay as fast as possible, use replay_rate 0 with ServoClockDreamerFreeRun.
+ * Only new frames are compared with the recorded command and saved.
+ */
+class RobotInterfaceDreamerReplay : public controlit::RobotInterface
+{
+public:
+    /*!
+     * The constructor.
+     */
+    RobotInterfaceDreamerReplay();
+
+    /*!
+     * The destructor.
+     */
+    virtual ~RobotInterfaceDreamerReplay();
+
+    /*!
+     * Initializes this robot interface.
+     *
+     * \param[in] nh The ROS node handle to use during the initialization
+     * process.
+     * \param[in] model The robot model.
+     * \return Whether the initialization was successful.
+     */
+    virtual bool init(ros::NodeHandle & nh, RTControlModel * model);
+
+    /*!
+     * Obtains the robot state from the next recorded frame.
+     *
+     * \param[out] latestRobotState The variable in which to store the
+     * latest robot state.
+     * \param[in] block Whether to block waiting for message to arrive.
+     * \return Whether the read was successful.  This is false once all
+     * frames were replayed unless looping is enabled.
+     */
+    virtual bool read(controlit::RobotState & latestRobotState, bool block = false);
+
+    /*!
+     * Captures the command.
+     *
+     * \param[in] command The command to send to the robot.
+     * \return Whether the write was successful.
+     */
+    virtual bool write(const controlit::Command & command);
+
+private:
+
+    /*!
+     * Loads the frames from a flight recorder file.
+     *
+     * \param[in] path The path of the file.
+     * \return Whether the file was successfully loaded.
+     */
+    bool loadFrames(const std::string & path);
+
+    /*!
+     * Prints the compute time statistics.
+     */
+    void printSummary();
+
+    /*!
+     * The recorded frames in chronological order.
+     */
+    std::vector<FlightRecorderFrame> frames;
+
+    /*!
+     * The index of the next frame to replay.
+     */
+    size_t nextFrame;
+
+    /*!
+     * The index of the frame most recently replayed by read().
+     */
+    size_t currentFrame;
+
+    /*!
+     * Whether to restart from the first frame after the last frame is replayed.
+     */
+    bool loop;
+
+    /*!
+     * Whether all frames were replayed.
+     */
+    bool finished;
+
+    /*!
+     * Whether the most recent read() replayed a new frame rather than
+     * repeating the previous one.
+     */
+    bool newFrame;
+
+    /*!
+     * The replay speed relative to the recorded rate.  Zero means as fast
+     * as possible.
+     */
+    double replayRate;
+
+    /*!
+     * When replay started and the timestamp of the first frame, used for
+     * pacing the replay.
+     */
+    std::chrono::steady_clock::time_point replayStartTime;
+    int64_t firstFrameTimestamp;
+
+    /*!
+     * When the most recent read() returned.
+     */
+    std::chrono::steady_clock::time_point readTime;
+
+    /*!
+     * The status and command that the joint map converts to and from.
+     */
+    M3UTATorqueShmSdsStatus shm_status;
+    M3UTATorqueShmSdsCommand shm_cmd;
+
+    /*!
+     * Maps the ControlIt! joints to their locations within shm_status and shm_cmd.
+     */
+    M3JointMap jointMap;
+
+    /*!
+     * The joint positions, velocities, and efforts obtained from shm_status.
+     */
+    Vector jointPositions;
+    Vector jointVelocities;
+    Vector jointEfforts;
+
+    /*!
+     * The effort command that was recorded for the current frame.
+     */
+    Vector recordedEffort;
+
+    /*!
+     * The controller compute time, measured from the end of read() to the
+     * start of write().
+     */
+    LatencyHistogram computeTimeHistogram;
+
+    /*!
+     * The largest difference between a captured effort and the recorded
+     * effort, in Nm.
+     */
+    double maxEffortDifference;
+
+    /*!
+     * Where the captured commands are saved.  Not open if capturing is disabled.
+     */
+    std::ofstream outputFile;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_ROBOT_INTERFACE_DREAMER_REPLAY_HPP__
@@ -0,0 +1,102 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_HPP__
+
+#include "m3uta/controllers/torque_shm_uta_sds.h"
+
+#include <string>
+
+namespace controlit {
+namespace dreamer {
+
+#define TORQUE_SHM "TSHMM"
+#define TORQUE_CMD_SEM "TSHMC"
+#define TORQUE_STATUS_SEM "TSHMS"
+
+/*!
+ * Provides access to the shared memory segment used to exchange data with
+ * the M3 server along with the locks protecting its status and command
+ * blocks.  Subclasses implement this using a particular operating system
+ * facility, e.g., RTAI or POSIX.
+ */
+class SHMTransport
+{
+public:
+    /*!
+     * The destructor.
+     */
+    virtual ~SHMTransport() {}
+
+    /*!
+     * Connects to an existing shared memory segment and its locks.  This
+     * may perform system calls and should not be called from the servo loop.
+     *
+     * \return Whether the connection was established.
+     */
+    virtual bool attach() = 0;
+
+    /*!
+     * Disconnects from the shared memory segment.
+     */
+    virtual void detach() = 0;
+
+    /*!
+     * Creates the shared memory segment and its locks.  This is what the M3
+     * server does.  It is used by M3ServerSimulator.
+     *
+     * \return Whether the segment and locks were created.
+     */
+    virtual bool create() = 0;
+
+    /*!
+     * Destroys the shared memory segment and locks created by create().
+     */
+    virtual void destroy() = 0;
+
+    /*!
+     * Returns a pointer to the shared memory, or nullptr if not attached.
+     */
+    virtual M3Sds * getSharedMemory() = 0;
+
+    /*!
+     * Acquires the lock protecting the status block.
+     */
+    virtual void lockStatus() = 0;
+
+    /*!
+     * Releases the lock protecting the status block.
+     */
+    virtual void unlockStatus() = 0;
+
+    /*!
+     * Acquires the lock protecting the command block.
+     */
+    virtual void lockCommand() = 0;
+
+    /*!
+     * Releases the lock protecting the command block.
+     */
+    virtual void unlockCommand() = 0;
+
+    /*!
+     * Returns the name of this transport.
+     */
+    virtual std::string getName() const = 0;
+
+    /*!
+     * Whether the ControlIt! timer should be based on RTAI.
+     */
+    virtual bool usesRTAI() const = 0;
+};
+
+/*!
+ * Creates a transport.
+ *
+ * \param[in] type The type of transport: "rtai", "posix", or "local".
+ * \return The transport, or nullptr if the type is invalid.
+ */
+SHMTransport * createSHMTransport(const std::string & type);
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_HPP__
@@ -0,0 +1,65 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_LOCAL_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_LOCAL_HPP__
+
+#include <controlit/dreamer/SHMTransport.hpp>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * Exchanges data through an M3Sds structure in the memory of the current
+ * process, protected by spin locks.  Neither RTAI nor an M3 server in
+ * another process is required.
+ *
+ * There is one segment per process.  Like the M3 server, one instance
+ * creates it by calling create() and the others attach to it.  This lets a
+ * test or benchmark act as the M3 server for a RobotInterfaceDreamer in the
+ * same process.
+ */
+class SHMTransportLocal : public SHMTransport
+{
+public:
+    /*!
+     * The constructor.
+     */
+    SHMTransportLocal();
+
+    /*!
+     * The destructor.
+     */
+    virtual ~SHMTransportLocal();
+
+    virtual bool attach();
+
+    virtual void detach();
+
+    virtual bool create();
+
+    virtual void destroy();
+
+    virtual M3Sds * getSharedMemory() { return sharedMemoryPtr; }
+
+    virtual void lockStatus();
+
+    virtual void unlockStatus();
+
+    virtual void lockCommand();
+
+    virtual void unlockCommand();
+
+    virtual std::string getName() const { return "local"; }
+
+    virtual bool usesRTAI() const { return false; }
+
+private:
+
+    /*!
+     * A pointer to the segment, or nullptr if not attached.
+     */
+    M3Sds * sharedMemoryPtr;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_LOCAL_HPP__
@@ -0,0 +1,101 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_POSIX_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_POSIX_HPP__
+
+#include <controlit/dreamer/SHMTransport.hpp>
+
+#include <atomic>
+#include <stdint.h>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * The locks that follow the M3Sds structure in a POSIX shared memory
+ * segment.  Each lock is a priority-inheritance futex word holding the
+ * thread ID of its owner, or zero if it is unlocked.
+ */
+struct SHMTransportPOSIXLocks
+{
+    std::atomic<uint32_t> statusLock;
+    std::atomic<uint32_t> commandLock;
+};
+
+/*!
+ * Accesses shared memory using POSIX shm_open() and mmap() and protects the
+ * status and command blocks using priority-inheritance futexes.  This does
+ * not require RTAI, allowing the robot interface to run on stock and
+ * PREEMPT_RT Linux kernels.
+ *
+ * The segment is named "/TSHMM".  It contains an M3Sds structure followed
+ * by an SHMTransportPOSIXLocks structure.
+ */
+class SHMTransportPOSIX : public SHMTransport
+{
+public:
+    /*!
+     * The constructor.
+     */
+    SHMTransportPOSIX();
+
+    /*!
+     * The destructor.
+     */
+    virtual ~SHMTransportPOSIX();
+
+    virtual bool attach();
+
+    virtual void detach();
+
+    virtual bool create();
+
+    virtual void destroy();
+
+    virtual M3Sds * getSharedMemory() { return sharedMemoryPtr; }
+
+    virtual void lockStatus();
+
+    virtual void unlockStatus();
+
+    virtual void lockCommand();
+
+    virtual void unlockCommand();
+
+    virtual std::string getName() const { return "posix"; }
+
+    virtual bool usesRTAI() const { return false; }
+
+    /*!
+     * Returns the size of the shared memory segment in bytes.
+     */
+    static size_t getSegmentSize();
+
+    /*!
+     * Returns the name of the shared memory segment.
+     */
+    static std::string getSegmentName();
+
+protected:
+
+    /*!
+     * Maps the shared memory segment into this process.
+     *
+     * \param[in] create Whether to create the segment if it does not exist.
+     * \return Whether the segment was mapped.
+     */
+    bool map(bool create);
+
+    /*!
+     * A pointer to the shared memory.
+     */
+    M3Sds * sharedMemoryPtr;
+
+    /*!
+     * A pointer to the locks, which are located right after the M3Sds.
+     */
+    SHMTransportPOSIXLocks * locks;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_POSIX_HPP__
@@ -0,0 +1,77 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_RTAI_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_RTAI_HPP__
+
+#include <controlit/dreamer/SHMTransport.hpp>
+
+#include <rtai_sem.h> // for SEM
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * Accesses the M3 server's shared memory using RTAI shared memory and
+ * RTAI semaphores.  This is the transport used by the M3 server on Dreamer.
+ */
+class SHMTransportRTAI : public SHMTransport
+{
+public:
+    /*!
+     * The constructor.
+     */
+    SHMTransportRTAI();
+
+    /*!
+     * The destructor.
+     */
+    virtual ~SHMTransportRTAI();
+
+    virtual bool attach();
+
+    virtual void detach();
+
+    virtual bool create();
+
+    virtual void destroy();
+
+    virtual M3Sds * getSharedMemory() { return sharedMemoryPtr; }
+
+    virtual void lockStatus() { rt_sem_wait(status_sem); }
+
+    virtual void unlockStatus() { rt_sem_signal(status_sem); }
+
+    virtual void lockCommand() { rt_sem_wait(command_sem); }
+
+    virtual void unlockCommand() { rt_sem_signal(command_sem); }
+
+    virtual std::string getName() const { return "rtai"; }
+
+    virtual bool usesRTAI() const { return true; }
+
+private:
+
+    /*!
+     * A pointer to the shared memory used to communicate with the M3
+     * server.  M3Sds stands for "M3 Shared Data Structure".
+     */
+    M3Sds * sharedMemoryPtr;
+
+    /*!
+     * A pointer to the semaphore protecting the status register.
+     */
+    SEM * status_sem;
+
+    /*!
+     * A pointer to the semaphore protecting the command register.
+     */
+    SEM * command_sem;
+
+    /*!
+     * Whether this transport created the semaphores.
+     */
+    bool ownsSemaphores;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_SHM_TRANSPORT_RTAI_HPP__
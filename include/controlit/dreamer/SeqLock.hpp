@@ -0,0 +1,109 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_SEQ_LOCK_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_SEQ_LOCK_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * The number of bytes reserved at the end of an M3Sds status or command
+ * block for the sequence counter.  The counter is placed in its own cache
+ * line so that updating it does not invalidate the data being exchanged.
+ */
+#define SEQLOCK_RESERVED_BYTES 64
+
+/*!
+ * A single-writer sequence lock protecting a block of shared memory.
+ *
+ * The writer increments the sequence counter before and after modifying
+ * the block, meaning the counter is odd while a write is in progress.
+ * Readers copy the block and retry if the counter was odd or changed
+ * during the copy.  Neither side ever blocks, which removes the priority
+ * inversion caused by waiting on an RTAI semaphore held by the peer.
+ *
+ * Both the M3 server and ControlIt! must use the same protocol.  The
+ * counter is stored in the last SEQLOCK_RESERVED_BYTES of the block, which
+ * is unused by M3UTATorqueShmSdsStatus and M3UTATorqueShmSdsCommand.
+ */
+class SeqLock
+{
+public:
+    /*!
+     * The constructor.
+     */
+    SeqLock();
+
+    /*!
+     * Initializes this sequence lock.
+     *
+     * \param[in] block A pointer to the start of the shared memory block.
+     * \param[in] blockSize The size of the block in bytes.  The sequence
+     * counter is located at the end of the block.
+     */
+    void init(unsigned char * block, size_t blockSize);
+
+    /*!
+     * Copies data out of the protected block.
+     *
+     * \param[out] dest Where to copy the data to.
+     * \param[in] src Where to copy the data from.  This must be in the protected block.
+     * \param[in] size The number of bytes to copy.
+     * \param[in] maxRetries The maximum number of times to retry a torn copy.
+     * \param[out] retries The number of retries that were performed.
+     * \return Whether a consistent copy was obtained.
+     */
+    bool read(void * dest, const void * src, size_t size, unsigned int maxRetries,
+        unsigned int & retries) const;
+
+    /*!
+     * Marks the start of a read that copies the block in several pieces.
+     *
+     * \return The sequence number to pass to endRead().
+     */
+    uint32_t beginRead() const;
+
+    /*!
+     * Marks the end of a read that was started by beginRead().
+     *
+     * \param[in] before The sequence number returned by beginRead().
+     * \return Whether the data copied since beginRead() is consistent.  If
+     * not, the read must be retried.
+     */
+    bool endRead(uint32_t before) const;
+
+    /*!
+     * Copies data into the protected block.  There must only be one writer.
+     *
+     * \param[out] dest Where to copy the data to.  This must be in the protected block.
+     * \param[in] src Where to copy the data from.
+     * \param[in] size The number of bytes to copy.
+     */
+    void write(void * dest, const void * src, size_t size);
+
+    /*!
+     * Marks the start of a write without copying any data.  Used by writers
+     * that update the block in several pieces.  Must be followed by a call
+     * to endWrite().
+     */
+    void beginWrite();
+
+    /*!
+     * Marks the end of a write that was started by beginWrite().
+     */
+    void endWrite();
+
+private:
+
+    /*!
+     * The sequence counter within shared memory.
+     */
+    std::atomic<uint32_t> * sequence;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_SEQ_LOCK_HPP__
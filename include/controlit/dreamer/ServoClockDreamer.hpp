@@ -2,6 +2,12 @@
 #define __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_DREAMER_RTAI_HPP__
 
 #include <controlit/ServoClock.hpp>
+#include <controlit/addons/ros/RealTimePublisher.hpp>
+#include <controlit/dreamer/OverrunPolicy.hpp>
+#include <controlit/dreamer/RTChecker.hpp>
+#include <controlit/dreamer/RTThreadState.hpp>
+#include <controlit/dreamer/ServoClockStats.hpp>
+#include <std_msgs/Float64MultiArray.h>
 #include <thread>  // for std::mutex
 
 #include <rtai_sched.h>
@@ -14,15 +20,6 @@
 namespace controlit {
 namespace dreamer {
 
-typedef enum {
-    RT_THREAD_UNDEF,
-    RT_THREAD_INIT,
-    RT_THREAD_RUNNING,
-    RT_THREAD_CLEANUP,
-    RT_THREAD_ERROR,
-    RT_THREAD_DONE
-} rt_thread_state_t;
-
 /*!
  * The coordinator for robots that are controlled via ROS topics.
  *
@@ -57,6 +54,17 @@ protected:
 
 private:
 
+    /*!
+     * Obtains the RTAI task parameters from the ROS parameter server.
+     */
+    void loadParameters();
+
+    /*!
+     * Publishes the latest servo loop timing statistics, if any.  This is
+     * called by the non-real-time thread.
+     */
+    void publishStats();
+
     /*!
      * The current state of the real-time thread.
      */
@@ -66,6 +74,55 @@ private:
      * The period of the real-time servo loop in nanoseconds.
      */
     long long rtPeriod_ns;
+
+    /*!
+     * The CPU masks of the real-time servo task (TSHMP) and of the
+     * non-real-time task that spawns it (TSHM).  Bit n allows CPU n.
+     */
+    int servoCPUMask;
+    int helperCPUMask;
+
+    /*!
+     * The RTAI priorities of the two tasks.  Zero is the highest priority.
+     */
+    int servoPriority;
+    int helperPriority;
+
+    /*!
+     * The stack size of the real-time thread in bytes.
+     */
+    int servoStackSize;
+
+    /*!
+     * Whether to check servoUpdate() for heap allocations and system calls.
+     */
+    bool rtCheckerEnabled;
+
+    /*!
+     * Checks servoUpdate() for heap allocations and system calls.
+     */
+    RTChecker rtChecker;
+
+    /*!
+     * Decides how the servo loop degrades when it overruns.
+     */
+    OverrunPolicy overrunPolicy;
+
+    /*!
+     * The timing statistics of the servo loop.
+     */
+    ServoClockStats stats;
+
+    /*!
+     * The most recent timing statistics obtained by the non-real-time thread.
+     */
+    ServoClockStatsSnapshot statsSnapshot;
+
+    /*!
+     * Publishes the timing statistics.  The elements are in the same order
+     * as the fields of ServoClockStatsSnapshot.
+     */
+    controlit::addons::ros::RealtimePublisher<std_msgs::Float64MultiArray> statsPublisher;
 };
 
 } // namespace dreamer
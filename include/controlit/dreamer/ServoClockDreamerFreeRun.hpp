@@ -0,0 +1,42 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_DREAMER_FREE_RUN_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_DREAMER_FREE_RUN_HPP__
+
+#include <controlit/ServoClock.hpp>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * A servo clock that calls servoUpdate() back to back without waiting for
+ * a period to elapse.  The servo frequency is ignored.
+ *
+ * This is meant for replaying flight recorder files as fast as possible
+ * with RobotInterfaceDreamerReplay and replay_rate 0.  It neither changes
+ * the scheduling policy nor locks memory, and must not be used with the
+ * robot.
+ */
+class ServoClockDreamerFreeRun : public controlit::ServoClock
+{
+public:
+    /*!
+     * The constructor.
+     */
+    ServoClockDreamerFreeRun();
+
+    /*!
+     * The destructor.
+     */
+    virtual ~ServoClockDreamerFreeRun();
+
+protected:
+
+    /*!
+     * The implementation of the update loop.
+     */
+    virtual void updateLoopImpl();
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_DREAMER_FREE_RUN_HPP__
@@ -0,0 +1,166 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_DREAMER_POSIX_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_DREAMER_POSIX_HPP__
+
+#include <controlit/ServoClock.hpp>
+#include <controlit/addons/ros/RealTimePublisher.hpp>
+#include <controlit/dreamer/OverrunPolicy.hpp>
+#include <controlit/dreamer/RTChecker.hpp>
+#include <controlit/dreamer/RTThreadState.hpp>
+#include <controlit/dreamer/ServoClockStats.hpp>
+#include <std_msgs/Float64MultiArray.h>
+
+#include <atomic>
+#include <pthread.h>
+#include <string>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * A servo clock for stock (PREEMPT_RT or mainline) Linux kernels.  It
+ * is the POSIX counterpart of ServoClockDreamer and does not require RTAI.
+ *
+ * The servo thread sleeps until absolute deadlines using
+ * clock_nanosleep(TIMER_ABSTIME) on CLOCK_MONOTONIC.  Before it starts
+ * looping, the thread locks all memory, pre-faults its stack, optionally
+ * pins itself to a CPU, and switches to the configured scheduling policy:
+ *
+ *   - "fifo": SCHED_FIFO at a fixed priority.
+ *   - "deadline": SCHED_DEADLINE with a runtime budget that is a fraction
+ *     of the servo period.  When the overrun policy slows the servo loop,
+ *     the runtime, deadline, and period are updated to match.
+ *   - "other": the default time-sharing scheduler, for unprivileged testing.
+ *
+ * The scheduling parameters are obtained from the ROS parameters
+ * posix_servo_* in the "controlit" namespace.  The servo loop timing
+ * statistics are published on topic "controlit/dreamer/servo_clock_stats"
+ * in the same format as ServoClockDreamer.
+ */
+class ServoClockDreamerPosix : public controlit::ServoClock
+{
+public:
+    /*!
+     * The constructor.
+     */
+    ServoClockDreamerPosix();
+
+    /*!
+     * The destructor.
+     */
+    virtual ~ServoClockDreamerPosix();
+
+    /*!
+     * This is executed by the real-time thread.
+     */
+    void * rtMethod(void * arg);
+
+protected:
+
+    /*!
+     * The implementation of the update loop.
+     */
+    virtual void updateLoopImpl();
+
+private:
+
+    /*!
+     * Obtains the scheduling parameters from the ROS parameter server.
+     */
+    void loadParameters();
+
+    /*!
+     * Configures the CPU affinity and scheduling policy of the calling
+     * thread and locks its memory.  This is called by the real-time thread.
+     *
+     * \return Whether the configuration was successful.
+     */
+    bool configureRTThread();
+
+    /*!
+     * Switches the calling thread to SCHED_DEADLINE with a runtime of
+     * deadlineRuntime times the current period and a deadline and period
+     * of rtPeriod_ns.  This is called by the real-time thread when it starts
+     * and whenever the overrun policy changes the period.
+     *
+     * \return Whether the scheduling policy was set.
+     */
+    bool setDeadlineScheduler();
+
+    /*!
+     * Publishes the latest servo loop timing statistics, if any.  This is
+     * called by the non-real-time thread.
+     */
+    void publishStats();
+
+    /*!
+     * The current state of the real-time thread.
+     */
+    std::atomic<rt_thread_state_t> rtThreadState;
+
+    /*!
+     * The period of the real-time servo loop in nanoseconds.
+     */
+    long long rtPeriod_ns;
+
+    /*!
+     * The CPU to which the real-time thread is pinned.  A negative value
+     * leaves the thread on all CPUs.
+     */
+    int cpu;
+
+    /*!
+     * The scheduling policy: "fifo", "deadline", or "other".
+     */
+    std::string scheduler;
+
+    /*!
+     * The SCHED_FIFO priority of the real-time thread.
+     */
+    int priority;
+
+    /*!
+     * The SCHED_DEADLINE runtime budget as a fraction of the servo period.
+     */
+    double deadlineRuntime;
+
+    /*!
+     * The stack size of the real-time thread in bytes.
+     */
+    int stackSize;
+
+    /*!
+     * Whether to check servoUpdate() for heap allocations and system calls.
+     */
+    bool rtCheckerEnabled;
+
+    /*!
+     * Checks servoUpdate() for heap allocations and system calls.
+     */
+    RTChecker rtChecker;
+
+    /*!
+     * Decides how the servo loop degrades when it overruns.
+     */
+    OverrunPolicy overrunPolicy;
+
+    /*!
+     * The timing statistics of the servo loop.
+     */
+    ServoClockStats stats;
+
+    /*!
+     * The most recent timing statistics obtained by the non-real-time thread.
+     */
+    ServoClockStatsSnapshot statsSnapshot;
+
+    /*!
+     * Publishes the timing statistics.  The elements are in the same order
+     * as the fields of ServoClockStatsSnapshot.
+     */
+    controlit::addons::ros::RealtimePublisher<std_msgs::Float64MultiArray> statsPublisher;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_DREAMER_POSIX_HPP__
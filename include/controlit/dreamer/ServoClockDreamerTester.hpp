@@ -3,18 +3,23 @@
 
 #include "ros/ros.h"
 #include <controlit/dreamer/ServoClockDreamer.hpp>
+#include <controlit/dreamer/ServoClockDreamerPosix.hpp>
 #include <controlit/dreamer/TimerRTAI.hpp>
 #include <controlit/addons/ros/RealTimePublisher.hpp>
 #include <controlit/ServoableClass.hpp>
 
 #include <std_msgs/Float64.h>
 
+#include <chrono>
+#include <memory>
+
 namespace controlit {
 namespace dreamer {
 
 /*!
- * Tests ServoClockDreamer by instantiating it and measuring its
- * servo frequency.
+ * Tests ServoClockDreamer or ServoClockDreamerPosix by instantiating it
+ * and measuring its servo frequency.  Both servo clocks also publish
+ * their jitter statistics, which allows a side-by-side comparison.
  */
 class ServoClockDreamerTester : controlit::ServoableClass
 {
@@ -32,9 +37,11 @@ public:
     /*!
      * Initializes this tester.
      *
+     * \param[in] usePosix Whether to test ServoClockDreamerPosix instead
+     * of ServoClockDreamer.
      * \return Whether the initialization was successful.
      */
-    bool init();
+    bool init(bool usePosix = false);
 
     /*!
      * Starts this tester.
@@ -70,16 +77,26 @@ private:
      */
     bool initialized;
 
+    /*!
+     * Whether ServoClockDreamerPosix is being tested.
+     */
+    bool usePosix;
+
     /*!
      * The servo clock that is being tested.
      */
-    ServoClockDreamer servoClock;
+    std::unique_ptr<controlit::ServoClock> servoClock;
 
     /*!
-     * The timer used to measure the servo period.
+     * The timer used to measure the servo period when testing ServoClockDreamer.
      */
     TimerRTAI timer;
 
+    /*!
+     * When servoUpdate() was last called when testing ServoClockDreamerPosix.
+     */
+    std::chrono::steady_clock::time_point lastUpdateTime;
+
     /*!
      * A real-time safe publisher for publishing the servo period.
      */
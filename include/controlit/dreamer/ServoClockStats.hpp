@@ -0,0 +1,176 @@
+#ifndef __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_STATS_HPP__
+#define __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_STATS_HPP__
+
+#include <controlit/dreamer/LatencyHistogram.hpp>
+#include <controlit/dreamer/OverrunPolicy.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * A summary of the servo loop timing statistics.  All times are in seconds.
+ */
+struct ServoClockStatsSnapshot
+{
+    unsigned long long numCycles;
+    unsigned long long numOverruns;
+    unsigned long long numMissedPeriods;
+    unsigned long long consecutiveOverruns;
+    unsigned long long maxConsecutiveOverruns;
+
+    // The time between when the servo thread should have woken up and when it did.
+    double wakeupJitterP50;
+    double wakeupJitterP99;
+    double wakeupJitterP999;
+    double wakeupJitterMax;
+
+    // The time spent in servoUpdate().
+    double computeTimeP50;
+    double computeTimeP99;
+    double computeTimeP999;
+    double computeTimeMax;
+
+    // The time remaining until the next period starts when servoUpdate() returns.
+    double slackP50;
+    double slackP1;
+    double slackP01;
+    double slackMin;
+
+    // What OverrunPolicy did.
+    unsigned long long numLowSlackCycles;
+    unsigned long long numHeldCycles;
+    unsigned long long numRateFallbacks;
+
+    // The current servo period.
+    double period;
+};
+
+/*!
+ * Collects the timing statistics of a servo loop.
+ *
+ * update() is called by the servo thread once per cycle and neither
+ * allocates memory nor makes system calls.  It records into one of two
+ * intervals.  Every SERVO_CLOCK_STATS_SNAPSHOT_PERIOD cycles, if the previous
+ * interval was consumed, it hands the interval over and switches to the
+ * other one, which takes constant time.  getSnapshot(), called by a
+ * non-real-time thread, adds the interval to the cumulative histograms,
+ * clears it, and computes the percentiles, so the servo thread never scans
+ * the histogram buckets.
+ */
+class ServoClockStats
+{
+public:
+    /*!
+     * The constructor.
+     */
+    ServoClockStats();
+
+    /*!
+     * Initializes this class.  This allocates the histograms and must be
+     * called before the servo thread starts.
+     *
+     * \param[in] period The servo period in seconds.
+     * \return Whether the initialization was successful.
+     */
+    bool init(double period);
+
+    /*!
+     * Records the timing of one servo cycle.  This is called by the servo thread.
+     *
+     * \param[in] wakeupLatency How late the servo thread woke up in seconds.
+     * \param[in] computeTime How long servoUpdate() took in seconds.
+     * \param[in] slack The time remaining until the next period starts in
+     * seconds.  A negative value is an overrun.
+     * \param[in] flags A combination of ServoCycleFlags.
+     */
+    void update(double wakeupLatency, double computeTime, double slack, unsigned int flags);
+
+    /*!
+     * Records a change of the servo period.  This is called by the servo thread.
+     *
+     * \param[in] period The new servo period in seconds.
+     */
+    void setPeriod(double period);
+
+    /*!
+     * Obtains the latest snapshot.  This is called by a non-real-time thread
+     * and computes the percentiles.
+     *
+     * \param[out] snapshot Where to save the snapshot.
+     * \return Whether a new snapshot was available.
+     */
+    bool getSnapshot(ServoClockStatsSnapshot & snapshot);
+
+    /*!
+     * The number of elements in the array form of a snapshot.
+     */
+    static const size_t NUM_FIELDS = 21;
+
+    /*!
+     * Saves a snapshot into an array, e.g., for publishing.  The elements
+     * are in the same order as the fields of ServoClockStatsSnapshot.
+     *
+     * \param[in] snapshot The snapshot.
+     * \param[out] data Where to save the snapshot.  Must have NUM_FIELDS elements.
+     */
+    static void toArray(const ServoClockStatsSnapshot & snapshot, std::vector<double> & data);
+
+    /*!
+     * Returns a string representation of a snapshot.
+     */
+    static std::string toString(const ServoClockStatsSnapshot & snapshot, std::string const & prefix = "");
+
+private:
+
+    /*!
+     * The histograms of the cycles in one interval and the counters at its end.
+     */
+    struct Interval
+    {
+        LatencyHistogram wakeupJitter;
+        LatencyHistogram computeTime;
+        LatencyHistogram slack;
+        ServoClockStatsSnapshot counters;
+    };
+
+    /*!
+     * The interval being recorded by the servo thread and the one that was
+     * handed over or is empty.
+     */
+    Interval intervals[2];
+
+    /*!
+     * The index of the interval being recorded.  Only accessed by the servo thread.
+     */
+    unsigned int recordingIndex;
+
+    /*!
+     * The index of the interval handed over to the non-real-time thread, or
+     * -1 if it was consumed.  The servo thread only switches intervals when
+     * this is -1, meaning the other interval is empty.
+     */
+    std::atomic<int> handedOverIndex;
+
+    /*!
+     * The histograms of all consumed intervals.  Only accessed by the
+     * non-real-time thread after init().
+     */
+    LatencyHistogram wakeupJitter;
+    LatencyHistogram computeTime;
+    LatencyHistogram slack;
+
+    /*!
+     * The counters being accumulated by the servo thread.  The percentile
+     * fields are unused.
+     */
+    ServoClockStatsSnapshot current;
+};
+
+} // namespace dreamer
+} // namespace controlit
+
+#endif // __CONTROLIT_DREAMER_INTEGRATION_SERVO_CLOCK_STATS_HPP__
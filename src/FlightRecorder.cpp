@@ -0,0 +1,367 @@
+#include <controlit/dreamer/FlightRecorder.hpp>
+
+#include <controlit/logging/Logging.hpp>
+
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace controlit {
+namespace dreamer {
+
+// Uncomment one of the following lines to enable/disable detailed debug statements.
+#define PRINT_INFO_STATEMENT(ss)
+// #define PRINT_INFO_STATEMENT(ss) CONTROLIT_INFO << ss;
+
+#define DEFAULT_DURATION 10.0                   // in seconds
+#define DEFAULT_FILE "/tmp/controlit_dreamer_flight_recorder.bin"
+#define DEFAULT_MAX_FILE_SIZE 256               // in megabytes
+#define DEFAULT_DUMP_PREFIX "/tmp/controlit_dreamer_flight_recorder_dump"
+#define DRAIN_PERIOD_MS 10
+#define MIN_DUMP_INTERVAL 10.0                  // in seconds
+
+// Set by SIGUSR1.  A lock-free atomic is safe to modify from a signal handler.
+static std::atomic<bool> signalTriggered(false);
+
+static void flightRecorderSignalHandler(int)
+{
+    signalTriggered = true;
+}
+
+FlightRecorder::FlightRecorder() :
+    enabled(false),
+    capacity(0),
+    ringLocked(false),
+    writeIndex(0),
+    readIndex(0),
+    frozen(false),
+    triggerRequested(false),
+    fileDescriptor(-1),
+    fileSize(0),
+    fileHeader(nullptr),
+    fileFrames(nullptr),
+    droppedFrames(0),
+    drainThreadRunning(false)
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    stop();
+}
+
+bool FlightRecorder::init(ros::NodeHandle & nh, double servoFrequency, const M3CopyPlan & statusPlan,
+    const std::vector<const M3CopyPlan *> & commandPlans)
+{
+    PRINT_INFO_STATEMENT("Method called!");
+
+    nh.param("flight_recorder_enabled", enabled, true);
+    if (!enabled)
+        return true;
+
+    double duration;
+    std::string path;
+    int maxFileSize;
+    nh.param("flight_recorder_duration", duration, DEFAULT_DURATION);
+    nh.param("flight_recorder_file", path, std::string(DEFAULT_FILE));
+    nh.param("flight_recorder_max_file_size", maxFileSize, DEFAULT_MAX_FILE_SIZE);
+    nh.param("flight_recorder_dump_prefix", dumpPrefix, std::string(DEFAULT_DUMP_PREFIX));
+
+    if (duration <= 0 || servoFrequency <= 0)
+    {
+        CONTROLIT_ERROR << "Invalid flight_recorder_duration (" << duration << ") or servo frequency ("
+                        << servoFrequency << ").";
+        return false;
+    }
+
+    statusCopyPlan = statusPlan;
+    commandCopyPlans.clear();
+    for (size_t ii = 0; ii < commandPlans.size(); ii++)
+        commandCopyPlans.push_back(*commandPlans[ii]);
+
+    // Allocate the ring buffer, zero it, and lock it into memory so the
+    // servo thread never takes a page fault when recording.  The bytes
+    // outside of the copy plans are never written and stay zero.
+    capacity = static_cast<uint64_t>(duration * servoFrequency);
+    if (capacity == 0) capacity = 1;
+
+    slots.reset(new Slot[capacity]);
+    for (uint64_t ii = 0; ii < capacity; ii++)
+    {
+        memset(&slots[ii].frame, 0, sizeof(FlightRecorderFrame));
+        slots[ii].sequence = 0;
+    }
+
+    if (mlock(slots.get(), capacity * sizeof(Slot)) == 0)
+        ringLocked = true;
+    else
+    {
+        // Not fatal.  Page faults only add jitter.
+        CONTROLIT_WARN << "Unable to lock the flight recorder ring buffer into memory: " << strerror(errno);
+    }
+
+    dumpFrame.reset(new FlightRecorderFrame);
+
+    // An empty path disables the continuous recording file.
+    if (!path.empty() && !openFile(path, static_cast<size_t>(maxFileSize) * 1024 * 1024))
+        return false;
+
+    triggerSubscriber = nh.subscribe("controlit/dreamer/flight_recorder/trigger", 1,
+        & FlightRecorder::triggerCallback, this);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = flightRecorderSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+
+    drainThreadRunning = true;
+    drainThread = std::thread(&FlightRecorder::drainLoop, this);
+
+    CONTROLIT_INFO << "Flight recorder keeping the last " << capacity << " frames ("
+                   << capacity * sizeof(FlightRecorderFrame) / 1024 << " KB) in memory"
+                   << (fileHeader ? ", draining to " + path : std::string(""));
+    return true;
+}
+
+bool FlightRecorder::openFile(const std::string & path, size_t maxBytes)
+{
+    uint64_t const fileCapacity = maxBytes > sizeof(FlightRecorderFileHeader)
+        ? (maxBytes - sizeof(FlightRecorderFileHeader)) / sizeof(FlightRecorderFrame) : 0;
+
+    if (fileCapacity == 0)
+    {
+        CONTROLIT_ERROR << "flight_recorder_max_file_size is too small to hold a single frame.";
+        return false;
+    }
+
+    fileSize = sizeof(FlightRecorderFileHeader) + fileCapacity * sizeof(FlightRecorderFrame);
+
+    fileDescriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fileDescriptor < 0)
+    {
+        CONTROLIT_ERROR << "Unable to open flight recorder file \"" << path << "\": " << strerror(errno);
+        return false;
+    }
+
+    if (ftruncate(fileDescriptor, fileSize) != 0)
+    {
+        CONTROLIT_ERROR << "Unable to size flight recorder file \"" << path << "\": " << strerror(errno);
+        close(fileDescriptor);
+        fileDescriptor = -1;
+        return false;
+    }
+
+    void * addr = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if (addr == MAP_FAILED)
+    {
+        CONTROLIT_ERROR << "Unable to map flight recorder file \"" << path << "\": " << strerror(errno);
+        close(fileDescriptor);
+        fileDescriptor = -1;
+        return false;
+    }
+
+    fileHeader = static_cast<FlightRecorderFileHeader *>(addr);
+    fileFrames = reinterpret_cast<FlightRecorderFrame *>(fileHeader + 1);
+
+    memcpy(fileHeader->magic, FLIGHT_RECORDER_MAGIC, sizeof(fileHeader->magic));
+    fileHeader->version = FLIGHT_RECORDER_VERSION;
+    fileHeader->frameSize = sizeof(FlightRecorderFrame);
+    fileHeader->capacity = fileCapacity;
+    fileHeader->numFrames = 0;
+    fileHeader->droppedFrames = 0;
+
+    return true;
+}
+
+void FlightRecorder::stop()
+{
+    drainThreadRunning = false;
+    if (drainThread.joinable()) drainThread.join();
+
+    if (fileHeader)
+    {
+        msync(fileHeader, fileSize, MS_SYNC);
+        munmap(fileHeader, fileSize);
+        fileHeader = nullptr;
+        fileFrames = nullptr;
+    }
+
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+
+    if (ringLocked)
+    {
+        munlock(slots.get(), capacity * sizeof(Slot));
+        ringLocked = false;
+    }
+}
+
+void FlightRecorder::record(uint64_t cycle, int64_t timestamp, const M3UTATorqueShmSdsStatus & status,
+    const M3UTATorqueShmSdsCommand & command)
+{
+    if (!enabled || frozen.load(std::memory_order_relaxed))
+        return;
+
+    uint64_t const index = writeIndex.load(std::memory_order_relaxed);
+    Slot & slot = slots[index % capacity];
+
+    // Mark the slot as being written before modifying it.
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.frame.cycle = cycle;
+    slot.frame.timestamp = timestamp;
+    statusCopyPlan.copy(&slot.frame.status, &status);
+    for (size_t ii = 0; ii < commandCopyPlans.size(); ii++)
+        commandCopyPlans[ii].copy(&slot.frame.command, &command);
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+    writeIndex.store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::trigger()
+{
+    triggerRequested.store(true, std::memory_order_relaxed);
+}
+
+bool FlightRecorder::readSlot(uint64_t index, FlightRecorderFrame & frame) const
+{
+    const Slot & slot = slots[index % capacity];
+
+    if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+        return false;
+
+    memcpy(&frame, &slot.frame, sizeof(frame));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+}
+
+void FlightRecorder::drainLoop()
+{
+    auto lastDumpTime = std::chrono::steady_clock::now() - std::chrono::seconds(static_cast<int>(MIN_DUMP_INTERVAL));
+
+    while (drainThreadRunning)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_PERIOD_MS));
+
+        drainToFile();
+
+        // Triggers that arrive too soon after a dump are ignored so that a
+        // persistent fault does not continuously freeze the recorder.
+        bool const triggered = triggerRequested.exchange(false) | signalTriggered.exchange(false);
+        if (triggered)
+        {
+            auto const now = std::chrono::steady_clock::now();
+            if (std::chrono::duration<double>(now - lastDumpTime).count() >= MIN_DUMP_INTERVAL)
+            {
+                dumpRing();
+                lastDumpTime = now;
+            }
+        }
+    }
+
+    drainToFile();
+}
+
+void FlightRecorder::drainToFile()
+{
+    if (!fileHeader)
+        return;
+
+    uint64_t const endIndex = writeIndex.load(std::memory_order_acquire);
+
+    // Skip the frames that were overwritten before they could be drained.
+    if (endIndex - readIndex > capacity)
+    {
+        droppedFrames += endIndex - capacity - readIndex;
+        readIndex = endIndex - capacity;
+    }
+
+    for (; readIndex < endIndex; readIndex++)
+    {
+        FlightRecorderFrame & dest = fileFrames[fileHeader->numFrames % fileHeader->capacity];
+        if (readSlot(readIndex, dest))
+            fileHeader->numFrames++;
+        else
+            droppedFrames++;
+    }
+
+    fileHeader->droppedFrames = droppedFrames;
+}
+
+void FlightRecorder::dumpRing()
+{
+    // Stop recording so the history leading up to the trigger is preserved.
+    frozen = true;
+
+    uint64_t const endIndex = writeIndex.load(std::memory_order_acquire);
+    uint64_t const startIndex = endIndex > capacity ? endIndex - capacity : 0;
+
+    char timeBuff[32];
+    time_t const now = time(nullptr);
+    struct tm localTime;
+    localtime_r(&now, &localTime);
+    strftime(timeBuff, sizeof(timeBuff), "%Y%m%d-%H%M%S", &localTime);
+
+    std::string const path = dumpPrefix + "_" + timeBuff + ".bin";
+
+    FILE * file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        CONTROLIT_ERROR << "Unable to create flight recorder dump \"" << path << "\": " << strerror(errno);
+        frozen = false;
+        return;
+    }
+
+    FlightRecorderFileHeader header;
+    memcpy(header.magic, FLIGHT_RECORDER_MAGIC, sizeof(header.magic));
+    header.version = FLIGHT_RECORDER_VERSION;
+    header.frameSize = sizeof(FlightRecorderFrame);
+    header.capacity = 0;
+    header.numFrames = 0;
+    header.droppedFrames = 0;
+    fwrite(&header, sizeof(header), 1, file);
+
+    // A frame that was being written when the recorder froze fails readSlot().
+    for (uint64_t index = startIndex; index < endIndex; index++)
+    {
+        if (readSlot(index, *dumpFrame))
+        {
+            fwrite(dumpFrame.get(), sizeof(FlightRecorderFrame), 1, file);
+            header.numFrames++;
+        }
+        else
+            header.droppedFrames++;
+    }
+
+    // The frames are written in chronological order.
+    header.capacity = header.numFrames;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+
+    frozen = false;
+
+    CONTROLIT_INFO << "Dumped " << header.numFrames << " flight recorder frames to \"" << path << "\".";
+}
+
+void FlightRecorder::triggerCallback(const boost::shared_ptr<std_msgs::Empty const> & msgPtr)
+{
+    trigger();
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -4,21 +4,21 @@
 namespace controlit {
 namespace dreamer {
 
-#define NUM_RIGHT_HAND_DOFS 5
-#define NUM_COMMAND_DOFS 6                   // Command includes both left and right hands
 #define NUM_TORQUE_CONTROLLED_JOINTS 6
 
 #define POWER_GRASP_MODE 0
 #define POSITION_MODE 1
 
 #define RIGHT_THUMB_CMC_INDEX 0
-#define LEFT_GRIPPER_JOINT_INDEX 5
+#define LEFT_GRIPPER_JOINT_INDEX NUM_RIGHT_HAND_JOINTS
 
 #define RIGHT_THUMB_CMC_KP 1
 #define RIGHT_THUMB_CMC_KD 0
 
 #define THUMB_SPEED 1  // radians per second
 
+#define NUM_PARAMS 9   // The number of elements in a message on controlit/hands/params
+
 #define TORQUE_COMMAND_J0_CONTRACT 0 // temporary value
 #define TORQUE_COMMAND_J1_CONTRACT 0.180
 #define TORQUE_COMMAND_J2_CONTRACT 0.115
@@ -32,20 +32,23 @@ namespace dreamer {
 #define TORQUE_COMMAND_J4_EXTEND -0.05
 
 HandControllerDreamer::HandControllerDreamer() :
-    rightHandControlMode(POWER_GRASP_MODE),
-    powerGraspRight(false),
-    powerGraspLeft(false),
     closingThumbFinger(false),
     closingRightFingers(false),
-    includeRightPointerFinger(true),
-    includeRightMiddleFinger(true),
-    includeRightPinkyFinger(true),
-    thumbKp(RIGHT_THUMB_CMC_KP),
-    thumbKd(RIGHT_THUMB_CMC_KD),
-    thumbGoalPos(0),
     rhCommandPublisher("controlit/rightHand/command", 1),
     rhStatePublisher("controlit/rightHand/state", 1)
 {
+    params.rightHandControlMode = POWER_GRASP_MODE;
+    params.powerGraspRight = false;
+    params.powerGraspLeft = false;
+    params.includeRightPointerFinger = true;
+    params.includeRightMiddleFinger = true;
+    params.includeRightPinkyFinger = true;
+    params.thumbKp = RIGHT_THUMB_CMC_KP;
+    params.thumbKd = RIGHT_THUMB_CMC_KD;
+    params.thumbGoalPos = 0;
+
+    pendingParams = params;
+    paramsMailbox.init(params);
 }
 
 HandControllerDreamer::~HandControllerDreamer()
@@ -54,8 +57,8 @@ HandControllerDreamer::~HandControllerDreamer()
 
 bool HandControllerDreamer::init(ros::NodeHandle & nh)
 {
-    currPosition.setZero(NUM_COMMAND_DOFS);
-    currVelocity.setZero(NUM_COMMAND_DOFS);
+    currPosition.setZero();
+    currVelocity.setZero();
 
     rightHandModeSubscriber = nh.subscribe("controlit/rightHand/mode", 1,
         & HandControllerDreamer::rightHandModeCallback, this);
@@ -85,20 +88,17 @@ bool HandControllerDreamer::init(ros::NodeHandle & nh)
     leftGripperPowerGraspSubscriber = nh.subscribe("controlit/leftGripper/powerGrasp", 1,
         & HandControllerDreamer::leftGripperCallback, this);
 
+    paramsSubscriber = nh.subscribe("controlit/hands/params", 1,
+        & HandControllerDreamer::paramsCallback, this);
+
     //---------------------------------------------------------------------------------
     // Initialize the publishers of the latest right hand state and command.
     //---------------------------------------------------------------------------------
     if(rhStatePublisher.trylock())
     {
-        rhStatePublisher.msg_.name.push_back("right_thumb_cmc");
-        rhStatePublisher.msg_.name.push_back("right_thumb_mcp");
-        rhStatePublisher.msg_.name.push_back("right_pointer_finger_mcp");
-        rhStatePublisher.msg_.name.push_back("right_middle_finger_mcp");
-        rhStatePublisher.msg_.name.push_back("right_pinky_mcp");
-
-
-        for (size_t ii = 0; ii < NUM_RIGHT_HAND_DOFS; ii++)
+        for (size_t ii = 0; ii < NUM_RIGHT_HAND_JOINTS; ii++)
         {   
+            rhStatePublisher.msg_.name.push_back(DREAMER_HAND_JOINTS[ii].name);
             rhStatePublisher.msg_.position.push_back(0.0);  // allocate memory for the joint states
             rhStatePublisher.msg_.velocity.push_back(0.0);
             rhStatePublisher.msg_.effort.push_back(0.0);
@@ -114,15 +114,9 @@ bool HandControllerDreamer::init(ros::NodeHandle & nh)
 
     if(rhCommandPublisher.trylock())
     {
-        rhCommandPublisher.msg_.name.push_back("right_thumb_cmc");
-        rhCommandPublisher.msg_.name.push_back("right_thumb_mcp");
-        rhCommandPublisher.msg_.name.push_back("right_pointer_finger_mcp");
-        rhCommandPublisher.msg_.name.push_back("right_middle_finger_mcp");
-        rhCommandPublisher.msg_.name.push_back("right_pinky_mcp");
-
-
-        for (size_t ii = 0; ii < NUM_RIGHT_HAND_DOFS; ii++)
+        for (size_t ii = 0; ii < NUM_RIGHT_HAND_JOINTS; ii++)
         {
+            rhCommandPublisher.msg_.name.push_back(DREAMER_HAND_JOINTS[ii].name);
             rhCommandPublisher.msg_.position.push_back(0.0);  // allocate memory for the joint states
             rhCommandPublisher.msg_.velocity.push_back(0.0);
             rhCommandPublisher.msg_.effort.push_back(0.0);
@@ -138,14 +132,14 @@ bool HandControllerDreamer::init(ros::NodeHandle & nh)
     return true;
 }
 
-void HandControllerDreamer::updateState(Vector position, Vector velocity)
+void HandControllerDreamer::updateState(JointVector const & position, JointVector const & velocity)
 {
     currPosition = position;
     currVelocity = velocity;
 
     if(rhStatePublisher.trylock())
     {
-        for (size_t ii = 0; ii < NUM_RIGHT_HAND_DOFS; ii++)
+        for (size_t ii = 0; ii < NUM_RIGHT_HAND_JOINTS; ii++)
         {   
             rhStatePublisher.msg_.position[ii] = currPosition[ii];
             rhStatePublisher.msg_.velocity[ii] = currVelocity[ii];
@@ -155,13 +149,20 @@ void HandControllerDreamer::updateState(Vector position, Vector velocity)
     }
 }
 
-void HandControllerDreamer::getCommand(Vector & command)
+void HandControllerDreamer::getCommand(JointVector & command)
 {
-    command.setZero(6); // for debugging, reset everything to zero 
+    command.setZero(); // for debugging, reset everything to zero
+
+    // Obtain the latest parameters, if they changed.
+    paramsMailbox.read(params);
+
+    double const thumbKp = params.thumbKp;
+    double const thumbKd = params.thumbKd;
+    double const thumbGoalPos = params.thumbGoalPos;
 
-    if (rightHandControlMode == POWER_GRASP_MODE)
+    if (params.rightHandControlMode == POWER_GRASP_MODE)
     {
-        if (powerGraspRight)
+        if (params.powerGraspRight)
         {
             // thumbKp = POWER_GRASP_ENABLED_KP;
 
@@ -182,9 +183,9 @@ void HandControllerDreamer::getCommand(Vector & command)
                 // thumbKp = 1; //POWER_GRASP_DISABLED_KP;
 
                 command[1] = TORQUE_COMMAND_J1_CONTRACT; // close right_thumb_mcp
-                command[2] = (includeRightPointerFinger ? TORQUE_COMMAND_J2_CONTRACT : TORQUE_COMMAND_J2_EXTEND);  // right_pointer_finger (uses torque commands with opposite signs)
-                command[3] = (includeRightMiddleFinger  ? TORQUE_COMMAND_J3_CONTRACT : TORQUE_COMMAND_J3_EXTEND);  // right_middle_finger
-                command[4] = (includeRightPinkyFinger   ? TORQUE_COMMAND_J4_CONTRACT : TORQUE_COMMAND_J4_EXTEND);  // right_pinky_finger
+                command[2] = (params.includeRightPointerFinger ? TORQUE_COMMAND_J2_CONTRACT : TORQUE_COMMAND_J2_EXTEND);  // right_pointer_finger (uses torque commands with opposite signs)
+                command[3] = (params.includeRightMiddleFinger  ? TORQUE_COMMAND_J3_CONTRACT : TORQUE_COMMAND_J3_EXTEND);  // right_middle_finger
+                command[4] = (params.includeRightPinkyFinger   ? TORQUE_COMMAND_J4_CONTRACT : TORQUE_COMMAND_J4_EXTEND);  // right_pinky_finger
             // }
             // else
             // {
@@ -251,7 +252,7 @@ void HandControllerDreamer::getCommand(Vector & command)
     // Publish the right hand command
     if(rhCommandPublisher.trylock())
     {
-        for (size_t ii = 0; ii < NUM_RIGHT_HAND_DOFS; ii++)
+        for (size_t ii = 0; ii < NUM_RIGHT_HAND_JOINTS; ii++)
         {   
             rhCommandPublisher.msg_.effort[ii] =  command[ii];
         }
@@ -262,55 +263,78 @@ void HandControllerDreamer::getCommand(Vector & command)
     }
 
     // Issue command to left gripper
-    command[5] = powerGraspLeft ? 2 : -0.5;
+    command[5] = params.powerGraspLeft ? 2 : -0.5;
 }
 
 
 void HandControllerDreamer::rightHandModeCallback(const boost::shared_ptr<std_msgs::Int32 const> & msgPtr)
 {
-    rightHandControlMode = msgPtr->data;
+    updateParams([&](HandControllerParams & p) { p.rightHandControlMode = msgPtr->data; });
 }
 
 void HandControllerDreamer::rightThumbCMCPosCallback(const boost::shared_ptr<std_msgs::Float64 const> & msgPtr)
 {
-    thumbGoalPos = msgPtr->data;
+    updateParams([&](HandControllerParams & p) { p.thumbGoalPos = msgPtr->data; });
 }
 
 void HandControllerDreamer::rightThumbCMCKpCallback(const boost::shared_ptr<std_msgs::Float64 const> & msgPtr)
 {
-    thumbKp = msgPtr->data;
+    updateParams([&](HandControllerParams & p) { p.thumbKp = msgPtr->data; });
 }
 
 void HandControllerDreamer::rightThumbCMCKdCallback(const boost::shared_ptr<std_msgs::Float64 const> & msgPtr)
 {
-    thumbKd = msgPtr->data;
+    updateParams([&](HandControllerParams & p) { p.thumbKd = msgPtr->data; });
 }
 
 void HandControllerDreamer::rightHandCallback(const boost::shared_ptr<std_msgs::Bool const> & msgPtr)
 {
-    powerGraspRight = msgPtr->data;
-    // CONTROLIT_INFO << "Right hand power grasp: " << (powerGraspRight ? "TRUE" : "FALSE");
+    updateParams([&](HandControllerParams & p) { p.powerGraspRight = msgPtr->data; });
+    // CONTROLIT_INFO << "Right hand power grasp: " << (msgPtr->data ? "TRUE" : "FALSE");
 }
 
 void HandControllerDreamer::leftGripperCallback(const boost::shared_ptr<std_msgs::Bool const> & msgPtr)
 {
-    powerGraspLeft = msgPtr->data;
-    // CONTROLIT_INFO << "Left gripper power grasp: " << (powerGraspLeft ? "TRUE" : "FALSE");
+    updateParams([&](HandControllerParams & p) { p.powerGraspLeft = msgPtr->data; });
+    // CONTROLIT_INFO << "Left gripper power grasp: " << (msgPtr->data ? "TRUE" : "FALSE");
 }
 
 void HandControllerDreamer::includeRightPinkyFingerCallback(const boost::shared_ptr<std_msgs::Bool const> & msgPtr)
 {
-    includeRightPinkyFinger = msgPtr->data;
+    updateParams([&](HandControllerParams & p) { p.includeRightPinkyFinger = msgPtr->data; });
 }
 
 void HandControllerDreamer::includeRightMiddleFingerCallback(const boost::shared_ptr<std_msgs::Bool const> & msgPtr)
 {
-    includeRightMiddleFinger = msgPtr->data;
+    updateParams([&](HandControllerParams & p) { p.includeRightMiddleFinger = msgPtr->data; });
 }
 
 void HandControllerDreamer::includeRightPointerFingerCallback(const boost::shared_ptr<std_msgs::Bool const> & msgPtr)
 {
-    includeRightPointerFinger = msgPtr->data;
+    updateParams([&](HandControllerParams & p) { p.includeRightPointerFinger = msgPtr->data; });
+}
+
+void HandControllerDreamer::paramsCallback(const boost::shared_ptr<std_msgs::Float64MultiArray const> & msgPtr)
+{
+    const std::vector<double> & data = msgPtr->data;
+    if (data.size() != NUM_PARAMS)
+    {
+        CONTROLIT_WARN << "Ignoring hand parameters with " << data.size() << " values, expected " << NUM_PARAMS << ".";
+        return;
+    }
+
+    updateParams([&](HandControllerParams & p)
+    {
+        p.rightHandControlMode = static_cast<int>(data[0]);
+        p.thumbGoalPos = data[1];
+        p.thumbKp = data[2];
+        p.thumbKd = data[3];
+        p.powerGraspRight = data[4] != 0;
+        p.powerGraspLeft = data[5] != 0;
+        p.includeRightPointerFinger = data[6] != 0;
+        p.includeRightMiddleFinger = data[7] != 0;
+        p.includeRightPinkyFinger = data[8] != 0;
+    });
 }
 
 } // namespace dreamer
@@ -1,58 +1,148 @@
 #include <controlit/dreamer/HeadControllerDreamer.hpp>
 
 #include <controlit/logging/RealTimeLogging.hpp>
-#include <SerialStreamBuf.h>
+
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace controlit {
 namespace dreamer {
 
-#define NUM_DOFS 7
 #define PRINT_SERIAL_MESSAGES 0
 
+#define DEFAULT_SERIAL_PORT "/dev/ttyS0"
+#define DEFAULT_SERIAL_BAUD 115200
+#define DEFAULT_SERIAL_PARITY "odd"
+#define DEFAULT_SERIAL_RESEND_RATE 10.0  // in Hz
+#define DEFAULT_PROTOCOL_VERSION 2
+#define DEFAULT_MAX_INTERPOLATION_TIME 0.5  // in seconds
+#define DEFAULT_RESPONSE_THRESHOLD 0.01     // in radians
+#define SERIAL_STATS_PERIOD 1.0          // in seconds
+#define NUM_SERIAL_STATS (HeadSerialLink::NUM_STATS_FIELDS + 9)
+#define NUM_TRACKING_STATS 8
+
+#define RTT_HISTOGRAM_BUCKET_WIDTH 0.0005  // in seconds
+#define RTT_HISTOGRAM_NUM_BUCKETS 400
+
+#define RESPONSE_HISTOGRAM_BUCKET_WIDTH 0.001  // in seconds
+#define RESPONSE_HISTOGRAM_NUM_BUCKETS 1000
+
 HeadControllerDreamer::HeadControllerDreamer() :
+    backend(HEAD_BACKEND_SERIAL),
+    stateReceived(false),
+    followingGoal(false),
+    segmentDuration(0),
+    maxInterpolationTime(DEFAULT_MAX_INTERPOLATION_TIME),
     jointStatePublisher("controlit/head/joint_states", 1),
-    jointCommandPublisher("controlit/head/joint_commands", 1)
+    jointCommandPublisher("controlit/head/joint_commands", 1),
+    protocolVersion(DEFAULT_PROTOCOL_VERSION),
+    seq(0),
+    numAcks(0),
+    numRejectedAcks(0),
+    numUnmatchedAcks(0),
+    numStates(0),
+    hasMeasuredState(false),
+    awaitingResponse(false),
+    responseThreshold(DEFAULT_RESPONSE_THRESHOLD),
+    numGoals(0),
+    trackingErrorSumSq(0),
+    trackingErrorMax(0),
+    numTrackingSamples(0)
 {
 
 }
 
 HeadControllerDreamer::~HeadControllerDreamer()
 {
-    serialPort.Close();
+    serialLink.close();
 }
 
-bool HeadControllerDreamer::init(ros::NodeHandle & nh)
+bool HeadControllerDreamer::init(ros::NodeHandle & nh, HeadBackend backend)
 {
-    serialPort.Open("/dev/ttyS0");
-    serialPort.SetBaudRate(LibSerial::SerialStreamBuf::BAUD_115200);
-    serialPort.SetCharSize(LibSerial::SerialStreamBuf::CHAR_SIZE_8); // 8 bit wide characters
-    serialPort.SetNumOfStopBits(1); // use one stop bit
-    serialPort.SetParity(LibSerial::SerialStreamBuf::PARITY_ODD);
-    // serialPort.SetFlowControl(LibSerial::SerialStreamBuf::FLOW_CONTROL_HARD);
+    this->backend = backend;
+
+    std::string port, parity;
+    int baud;
+    double resendRate;
+    nh.param("head_serial_port", port, std::string(DEFAULT_SERIAL_PORT));
+    nh.param("head_serial_baud", baud, DEFAULT_SERIAL_BAUD);
+    nh.param("head_serial_parity", parity, std::string(DEFAULT_SERIAL_PARITY));
+    nh.param("head_serial_resend_rate", resendRate, DEFAULT_SERIAL_RESEND_RATE);
+    nh.param("head_serial_protocol_version", protocolVersion, DEFAULT_PROTOCOL_VERSION);
+    nh.param("head_goal_max_interpolation_time", maxInterpolationTime, DEFAULT_MAX_INTERPOLATION_TIME);
+    nh.param("head_response_threshold", responseThreshold, DEFAULT_RESPONSE_THRESHOLD);
+
+    if (protocolVersion != 1 && protocolVersion != HEAD_PROTOCOL_VERSION)
+    {
+        CONTROLIT_ERROR << "Unsupported head_serial_protocol_version " << protocolVersion << ", must be 1 or "
+                        << HEAD_PROTOCOL_VERSION << ". Using version " << DEFAULT_PROTOCOL_VERSION << ".";
+        protocolVersion = DEFAULT_PROTOCOL_VERSION;
+    }
+
+    // NaN never compares equal, so the first command is always sent.
+    for (size_t ii = 0; ii < HEAD_PROTOCOL_NUM_DOFS; ii++)
+    {
+        errors[ii] = 0;
+        lastSentErrors[ii] = std::numeric_limits<float>::quiet_NaN();
+    }
+
+    // The shared memory backend leaves the serial port alone.
+    bool linkOpen = true;
+    if (backend == HEAD_BACKEND_SHM)
+        CONTROLIT_INFO << "Sending head commands through shared memory.";
+    else
+        linkOpen = serialLink.open(port, baud, parity);
+
+    if (backend == HEAD_BACKEND_SERIAL && linkOpen)
+    {
+        size_t const packetSize = protocolVersion == 1 ? HEAD_PROTOCOL_V1_PACKET_SIZE
+            : HeadSerialProtocol::encodeCommand(0, errors, serialOutputBuff);
+
+        CONTROLIT_INFO << "Sending head packets (protocol version " << protocolVersion << ") on change and every "
+                       << (resendRate > 0 ? 1.0 / resendRate : 0) << "s otherwise, at most "
+                       << 1.0 / serialLink.getWireTime(packetSize) << " packets/s.";
+    }
+
+    resendPeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(resendRate > 0 ? 1.0 / resendRate : 0));
+
+    for (size_t ii = 0; ii < HEAD_SEQ_WINDOW; ii++)
+        sendValid[ii] = false;
+
+    rttHistogram.init(RTT_HISTOGRAM_BUCKET_WIDTH, RTT_HISTOGRAM_NUM_BUCKETS);
+    responseHistogram.init(RESPONSE_HISTOGRAM_BUCKET_WIDTH, RESPONSE_HISTOGRAM_NUM_BUCKETS);
 
-    // Set the starting byte
-    serialOutputBuff[0] = SERIAL_START_BYTE;
+    lastSendTime = std::chrono::steady_clock::time_point();
+    lastStatsTime = std::chrono::steady_clock::now();
 
-    currPosition.setZero(NUM_DOFS);
-    currVelocity.setZero(NUM_DOFS);
+    currPosition.setZero();
+    currVelocity.setZero();
+    stateReceived = false;
+    responseStart.setZero();
+    responseDirection.setZero();
+    measuredPosition.setZero();
+    measuredVelocity.setZero();
 
-    commandPos.setZero(NUM_DOFS);
-    // commandVel.setZero(NUM_DOFS);
-    errorPos.setZero(NUM_DOFS);
+    commandPos.setZero();
+    // commandVel.setZero();
+    errorPos.setZero();
+
+    segmentStart.setZero();
+    segmentGoal.setZero();
+    followingGoal = false;
+
+    HeadCommandSample initialSample = {};
+    goalMailbox.init(initialSample);
+    errorMailbox.init(initialSample);
 
     // Create a real-time publisher of the joint states.
     while (!jointStatePublisher.trylock()) usleep(200);
 
-    jointStatePublisher.msg_.name.push_back("lower_neck_pitch");
-    jointStatePublisher.msg_.name.push_back("upper_neck_yaw");
-    jointStatePublisher.msg_.name.push_back("upper_neck_roll");
-    jointStatePublisher.msg_.name.push_back("upper_neck_pitch");
-    jointStatePublisher.msg_.name.push_back("eye_pitch");
-    jointStatePublisher.msg_.name.push_back("right_eye_yaw");
-    jointStatePublisher.msg_.name.push_back("left_eye_yaw");
-
     for (size_t ii = 0; ii < NUM_DOFS; ii++)
     {
+        jointStatePublisher.msg_.name.push_back(DREAMER_HEAD_JOINTS[ii].name);
         jointStatePublisher.msg_.position.push_back(0.0);  // allocate memory for the joint states
         jointStatePublisher.msg_.velocity.push_back(0.0);
         jointStatePublisher.msg_.effort.push_back(0.0);
@@ -63,16 +153,9 @@ bool HeadControllerDreamer::init(ros::NodeHandle & nh)
     // Create a real-time publisher of the joint commands
     while (!jointCommandPublisher.trylock()) usleep(200);
 
-    jointCommandPublisher.msg_.name.push_back("lower_neck_pitch");
-    jointCommandPublisher.msg_.name.push_back("upper_neck_yaw");
-    jointCommandPublisher.msg_.name.push_back("upper_neck_roll");
-    jointCommandPublisher.msg_.name.push_back("upper_neck_pitch");
-    jointCommandPublisher.msg_.name.push_back("eye_pitch");
-    jointCommandPublisher.msg_.name.push_back("right_eye_yaw");
-    jointCommandPublisher.msg_.name.push_back("left_eye_yaw");
-
     for (size_t ii = 0; ii < NUM_DOFS; ii++)
     {
+        jointCommandPublisher.msg_.name.push_back(DREAMER_HEAD_JOINTS[ii].name);
         jointCommandPublisher.msg_.position.push_back(0.0);  // allocate memory for the joint states
         jointCommandPublisher.msg_.velocity.push_back(0.0);
         jointCommandPublisher.msg_.effort.push_back(0.0);
@@ -80,121 +163,380 @@ bool HeadControllerDreamer::init(ros::NodeHandle & nh)
 
     jointCommandPublisher.unlockAndPublish();
 
+    // Create a real-time publisher of the serial link's transmit statistics
+    serialStatsPublisher.init(nh, "controlit/head/serial_stats", 1);
+    if (serialStatsPublisher.trylock())
+    {
+        serialStatsPublisher.msg_.data.resize(NUM_SERIAL_STATS, 0);
+        serialStatsPublisher.unlockAndPublish();
+    }
+
+    // Create a real-time publisher of the response latency and tracking error
+    trackingStatsPublisher.init(nh, "controlit/head/tracking_stats", 1);
+    if (trackingStatsPublisher.trylock())
+    {
+        trackingStatsPublisher.msg_.data.resize(NUM_TRACKING_STATS, 0);
+        trackingStatsPublisher.unlockAndPublish();
+    }
+
     // Create a subscriber for the head command
-    // headPositionCommandSubscriber = nh.subscribe("controlit/head/position_cmd", 1,
-    //     & HeadControllerDreamer::positionCommandCallback, this);
+    headPositionCommandSubscriber = nh.subscribe("controlit/head/position_cmd", 1,
+        & HeadControllerDreamer::positionCommandCallback, this);
 
     headPositionErrorSubscriber = nh.subscribe("controlit/head/error_cmd", 1,
         & HeadControllerDreamer::positionErrorCallback, this);
 
-    return true;
+    return linkOpen;
 }
 
-void HeadControllerDreamer::updateState(Vector position, Vector velocity)
+void HeadControllerDreamer::updateState(JointVector const & position, JointVector const & velocity)
 {
-    // currPosition = position;
-    // currVelocity = velocity;
-
-    // // Publish the current joint state
-    // if(jointStatePublisher.trylock())
-    // {
-    //     for (size_t ii = 0; ii < NUM_DOFS; ii++)
-    //     {
-    //         jointStatePublisher.msg_.position[ii] = position[ii];
-    //         jointStatePublisher.msg_.velocity[ii] = velocity[ii];
-    //     }
-
-    //     jointStatePublisher.unlockAndPublish();
-    // }
+    currPosition = position;
+    currVelocity = velocity;
+    stateReceived = true;
+
+    // The head responded to the latest goal once it moved far enough toward it.
+    if (awaitingResponse && (currPosition - responseStart).dot(responseDirection) >= responseThreshold)
+    {
+        responseHistogram.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - responseGoalTime).count());
+        awaitingResponse = false;
+    }
+
+    // Without readback from the head, publish the state obtained from the robot.
+    if (backend == HEAD_BACKEND_SHM || protocolVersion == 1)
+        publishJointState(position, velocity);
 }
 
-void HeadControllerDreamer::saveFloat(char * buff, float val)
+void HeadControllerDreamer::publishJointState(JointVector const & position, JointVector const & velocity)
 {
-    unsigned char const * pp = reinterpret_cast<unsigned char const *>(&val);
-
-    for (std::size_t ii = 0; ii != sizeof(float); ++ii)
+    if(jointStatePublisher.trylock())
     {
-        buff[ii] = pp[ii];
+        for (size_t ii = 0; ii < NUM_DOFS; ii++)
+        {
+            jointStatePublisher.msg_.position[ii] = position[ii];
+            jointStatePublisher.msg_.velocity[ii] = velocity[ii];
+        }
+
+        jointStatePublisher.unlockAndPublish();
     }
 }
 
-void HeadControllerDreamer::getCommand(Vector & command)
+void HeadControllerDreamer::getCommand(JointVector & command)
 {
-    // CONTROLIT_INFO << "Method Called";
+    std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
 
-    // for (size_t ii = 0; ii < NUM_DOFS; ii++)
-    // {
-    //     // CONTROLIT_INFO << "Setting command [" << ii << "] to be: " << commandPos[ii];
-    //     command[ii] = commandPos[ii];
-    // }
+    // Process the acknowledgements and encoder readings received since the last call.
+    if (backend == HEAD_BACKEND_SERIAL)
+        receivePackets(now);
 
+    updateSetpoint(now);
 
-    // if(jointCommandPublisher.trylock())
-    // {
-    //     for (size_t ii = 0; ii < NUM_DOFS; ii++)
-    //     {
-    //         // CONTROLIT_INFO << "Setting command [" << ii << "] to be: " << commandPos[ii];
-    //         jointCommandPublisher.msg_.position[ii] = commandPos[ii];
-    //     }
-    //     jointCommandPublisher.unlockAndPublish();
-    // }
+    if (followingGoal)
+    {
+        for (size_t ii = 0; ii < NUM_DOFS; ii++)
+        {
+            command[ii] = commandPos[ii];
+        }
 
-    // Package up the error values for transmission over the serial port.
+        if(jointCommandPublisher.trylock())
+        {
+            for (size_t ii = 0; ii < NUM_DOFS; ii++)
+            {
+                jointCommandPublisher.msg_.position[ii] = commandPos[ii];
+            }
+            jointCommandPublisher.unlockAndPublish();
+        }
+
+        if (stateReceived)
+        {
+            trackingErrorSumSq += errorPos.squaredNorm();
+            trackingErrorMax = std::max(trackingErrorMax, errorPos.cwiseAbs().maxCoeff());
+            numTrackingSamples += NUM_DOFS;
+        }
+    }
+    else
+    {
+        for (size_t ii = 0; ii < NUM_DOFS; ii++)
+        {
+            command[ii] = commandPos[ii];
+        }
+    }
+
+    if (now - lastStatsTime >= std::chrono::duration<double>(SERIAL_STATS_PERIOD))
+    {
+        if (backend == HEAD_BACKEND_SERIAL)
+            publishSerialStats();
+        publishTrackingStats();
+        lastStatsTime = now;
+    }
+
+    // With the shared memory backend, the robot interface sends the command.
+    if (backend == HEAD_BACKEND_SHM)
+        return;
 
     // The errors are specified as type double (8 bytes). Cast them to be of type float (4 bytes) for transmission.
+    bool changed = false;
+    for (size_t ii = 0; ii < HEAD_PROTOCOL_NUM_DOFS; ii++)
+    {
+        errors[ii] = static_cast<float>(errorPos[ii]);
+        if (errors[ii] != lastSentErrors[ii])
+            changed = true;
+    }
 
-    saveFloat(&serialOutputBuff[1], static_cast<float>(errorPos[0]));
-    saveFloat(&serialOutputBuff[5], static_cast<float>(errorPos[1]));
-    saveFloat(&serialOutputBuff[9], static_cast<float>(errorPos[2]));
-    saveFloat(&serialOutputBuff[13], static_cast<float>(errorPos[3]));
+    // Send the position error values to the head if they changed or are due to be
+    // sent again.  Otherwise, just flush any packet the port could not take earlier.
+    bool const resendDue = resendPeriod.count() > 0 && now - lastSendTime >= resendPeriod;
 
-    // Compute and save the checksum, which is simply the XOR of all bytes preceding the checking byte in the message.
-    checksum = 0x00;
-    for (std::size_t ii = 0; ii < SERIAL_BUFFER_SIZE - 1; ii++)
+    if (changed || resendDue)
     {
-        checksum ^= serialOutputBuff[ii];
+        size_t packetSize;
+        if (protocolVersion == 1)
+            packetSize = HeadSerialProtocol::encodeCommandV1(errors, serialOutputBuff);
+        else
+        {
+            seq++;
+            packetSize = HeadSerialProtocol::encodeCommand(seq, errors, serialOutputBuff);
+
+            sendTimes[seq % HEAD_SEQ_WINDOW] = now;
+            sendSeqs[seq % HEAD_SEQ_WINDOW] = seq;
+            sendValid[seq % HEAD_SEQ_WINDOW] = true;
+        }
+
+        // Some debug output
+        #if PRINT_SERIAL_MESSAGES
+        {
+            std::stringstream msgBuff;
+            msgBuff << "Transmitting the following packet (seq " << seq << "):\n ";
+            for (size_t ii = 0; ii < HEAD_PROTOCOL_NUM_DOFS; ii++)
+                msgBuff << " [" << errors[ii] << "]";
+            msgBuff << "\nBytes:\n";
+            for (std::size_t ii = 0; ii < packetSize; ii++)
+            {
+                msgBuff << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(2)
+                        << static_cast<int>(static_cast<uint8_t>(serialOutputBuff[ii]));
+                if (ii < packetSize - 1)
+                    msgBuff << ", ";
+            }
+            CONTROLIT_INFO_RT << msgBuff.str();
+        }
+        #endif
+
+        serialLink.send(serialOutputBuff, packetSize);
+        memcpy(lastSentErrors, errors, sizeof(errors));
+        lastSendTime = now;
+    }
+    else
+        serialLink.service();
+}
+
+void HeadControllerDreamer::updateSetpoint(std::chrono::steady_clock::time_point now)
+{
+    // Error commands are relative to where the head is when they arrive.  The
+    // serial backend sends them as they are.  For the shared memory backend,
+    // they are turned into an absolute target that is held until the next
+    // command, so the head stops at the target instead of creeping by the
+    // error every cycle.  An error is not taken until the head position is
+    // known.  If an error and a goal arrived since the last cycle, the later
+    // of the two wins.
+    bool const newError = (stateReceived || backend == HEAD_BACKEND_SERIAL) && errorMailbox.read(commandSample);
+    if (newError)
+    {
+        for (size_t ii = 0; ii < NUM_DOFS; ii++)
+        {
+            errorPos[ii] = commandSample.value[ii];
+        }
+        commandPos = currPosition + errorPos;
+        followingGoal = false;
+    }
+
+    std::chrono::steady_clock::time_point const errorTime = commandSample.time;
+
+    if (goalMailbox.read(commandSample) && !(newError && commandSample.time < errorTime))
+    {
+        // Start the new segment from the current setpoint, or from the current
+        // position if the head was not following a goal.
+        double const elapsed = std::chrono::duration<double>(now - segmentStartTime).count();
+        double const fraction = segmentDuration > 0 ? std::min(1.0, elapsed / segmentDuration) : 1.0;
+
+        if (followingGoal)
+            segmentStart = segmentStart + (segmentGoal - segmentStart) * fraction;
+        else
+            segmentStart = currPosition;
+
+        // Spread the motion over the interval at which goals arrive.  The
+        // first goal after a pause is approached over the maximum time.
+        double const goalInterval = std::chrono::duration<double>(commandSample.time - lastGoalTime).count();
+        segmentDuration = followingGoal ? std::min(goalInterval, maxInterpolationTime) : maxInterpolationTime;
+
+        for (size_t ii = 0; ii < NUM_DOFS; ii++)
+        {
+            segmentGoal[ii] = commandSample.value[ii];
+        }
+
+        segmentStartTime = now;
+        lastGoalTime = commandSample.time;
+        followingGoal = true;
+        numGoals++;
+
+        // Measure how long the head takes to respond to goals that are far
+        // enough away to tell movement from noise.
+        responseDirection = segmentGoal - currPosition;
+        double const distance = responseDirection.norm();
+        awaitingResponse = stateReceived && distance > 2 * responseThreshold;
+        if (awaitingResponse)
+        {
+            responseDirection /= distance;
+            responseStart = currPosition;
+            responseGoalTime = commandSample.time;
+        }
     }
-    serialOutputBuff[SERIAL_BUFFER_SIZE - 1] = checksum;
 
-    // Some debug output
-    #if PRINT_SERIAL_MESSAGES
+    if (!followingGoal)
+        return;
+
+    double const elapsed = std::chrono::duration<double>(now - segmentStartTime).count();
+    double const fraction = segmentDuration > 0 ? std::min(1.0, elapsed / segmentDuration) : 1.0;
+
+    commandPos = segmentStart + (segmentGoal - segmentStart) * fraction;
+    errorPos = commandPos - currPosition;
+}
+
+void HeadControllerDreamer::receivePackets(std::chrono::steady_clock::time_point now)
+{
+    if (protocolVersion == 1)
+        return;
+
+    size_t numRead;
+    while ((numRead = serialLink.receive(serialInputBuff, sizeof(serialInputBuff))) > 0)
     {
-        std::stringstream msgBuff;
-        msgBuff << "Transmitting the following packet:\n";
-        msgBuff << "  [0x" << std::hex << std::uppercase << SERIAL_START_BYTE << std::nouppercase << std::dec << "]";
-        msgBuff << " [" << errorPos[0] << "] [" << errorPos[1] << "] [" << errorPos[2] << "] [" << errorPos[3] << "]\n";
-        msgBuff << "Bytes:\n";
-        for (std::size_t ii = 0; ii < SERIAL_BUFFER_SIZE; ii++)
+        for (size_t ii = 0; ii < numRead; ii++)
         {
-            msgBuff << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(2)  << static_cast<int>(serialOutputBuff[ii]);
-            if (ii < SERIAL_BUFFER_SIZE - 1)
-                msgBuff << ", ";
+            HeadRxPacket packet;
+            if (!protocol.parse(static_cast<uint8_t>(serialInputBuff[ii]), packet))
+                continue;
+
+            if (packet.type == HEAD_PACKET_ACK)
+            {
+                numAcks++;
+                if (packet.status != 0)
+                    numRejectedAcks++;
+
+                // Each command is acknowledged at most once, so forget its send time.
+                size_t const slot = packet.seq % HEAD_SEQ_WINDOW;
+                if (sendValid[slot] && sendSeqs[slot] == packet.seq)
+                {
+                    rttHistogram.record(std::chrono::duration<double>(now - sendTimes[slot]).count());
+                    sendValid[slot] = false;
+                }
+                else
+                    numUnmatchedAcks++;
+            }
+            else if (packet.type == HEAD_PACKET_STATE)
+            {
+                numStates++;
+
+                double const dt = std::chrono::duration<double>(now - lastStateTime).count();
+                for (size_t jj = 0; jj < NUM_DOFS; jj++)
+                {
+                    // State packets received in the same call share a receive time,
+                    // so only the first of them updates the velocity.
+                    if (hasMeasuredState && dt > 0)
+                        measuredVelocity[jj] = (packet.position[jj] - measuredPosition[jj]) / dt;
+                    measuredPosition[jj] = packet.position[jj];
+                }
+
+                lastStateTime = now;
+                hasMeasuredState = true;
+                publishJointState(measuredPosition, measuredVelocity);
+            }
         }
-        CONTROLIT_INFO_RT << msgBuff.str();
     }
-    #endif
+}
 
-    // send position error values to head
-    serialPort.write(serialOutputBuff, SERIAL_BUFFER_SIZE);
+void HeadControllerDreamer::publishSerialStats()
+{
+    if (serialStatsPublisher.trylock())
+    {
+        std::vector<double> & data = serialStatsPublisher.msg_.data;
+        HeadSerialLink::statsToArray(serialLink.getStats(), data);
+
+        data.resize(NUM_SERIAL_STATS);
+        size_t ii = HeadSerialLink::NUM_STATS_FIELDS;
+        data[ii++] = numAcks;
+        data[ii++] = numRejectedAcks;
+        data[ii++] = numUnmatchedAcks;
+        data[ii++] = numStates;
+        data[ii++] = protocol.getNumCRCErrors();
+        data[ii++] = protocol.getNumFramingErrors();
+        data[ii++] = rttHistogram.getPercentile(0.5);
+        data[ii++] = rttHistogram.getPercentile(0.99);
+        data[ii++] = rttHistogram.getMax();
+
+        serialStatsPublisher.unlockAndPublish();
+    }
+}
+
+void HeadControllerDreamer::publishTrackingStats()
+{
+    if (trackingStatsPublisher.trylock())
+    {
+        std::vector<double> & data = trackingStatsPublisher.msg_.data;
+        data.resize(NUM_TRACKING_STATS);
+        data[0] = backend == HEAD_BACKEND_SHM ? 1 : 0;
+        data[1] = numGoals;
+        data[2] = responseHistogram.getCount();
+        data[3] = responseHistogram.getPercentile(0.5);
+        data[4] = responseHistogram.getPercentile(0.99);
+        data[5] = responseHistogram.getMax();
+        data[6] = numTrackingSamples > 0 ? std::sqrt(trackingErrorSumSq / numTrackingSamples) : 0;
+        data[7] = trackingErrorMax;
+        trackingStatsPublisher.unlockAndPublish();
+    }
+
+    trackingErrorSumSq = 0;
+    trackingErrorMax = 0;
+    numTrackingSamples = 0;
 }
 
 void HeadControllerDreamer::positionCommandCallback(
     const boost::shared_ptr<std_msgs::Float64MultiArray const> & msgPtr)
 {
+    if (msgPtr->data.size() != NUM_DOFS)
+    {
+        CONTROLIT_WARN << "Ignoring head position command with " << msgPtr->data.size()
+                       << " values, expected " << NUM_DOFS << ".";
+        return;
+    }
+
+    HeadCommandSample sample;
     for (size_t ii = 0; ii < NUM_DOFS; ii++)
     {
-        commandPos[ii] = msgPtr->data[ii];
+        sample.value[ii] = msgPtr->data[ii];
     }
+    sample.time = std::chrono::steady_clock::now();
+
+    goalMailbox.write(sample);
 }
 
 
 void HeadControllerDreamer::positionErrorCallback(
     const boost::shared_ptr<std_msgs::Float64MultiArray const> & msgPtr)
 {
+    if (msgPtr->data.size() != NUM_DOFS)
+    {
+        CONTROLIT_WARN << "Ignoring head position error command with " << msgPtr->data.size()
+                       << " values, expected " << NUM_DOFS << ".";
+        return;
+    }
+
+    HeadCommandSample sample;
     for (size_t ii = 0; ii < NUM_DOFS; ii++)
     {
-        errorPos[ii] = msgPtr->data[ii];
+        sample.value[ii] = msgPtr->data[ii];
     }
+    sample.time = std::chrono::steady_clock::now();
+
+    errorMailbox.write(sample);
 }
 
 } // namespace dreamer
@@ -0,0 +1,251 @@
+#include <controlit/dreamer/HeadSerialLink.hpp>
+#include <controlit/logging/RealTimeLogging.hpp>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * Returns the termios speed constant of a baud rate, or B0 if it is not supported.
+ */
+static speed_t toSpeed(int baud)
+{
+    switch (baud)
+    {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 500000:  return B500000;
+        case 921600:  return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        default:      return B0;
+    }
+}
+
+HeadSerialLink::HeadSerialLink() :
+    fd(-1),
+    bitsPerByte(11),
+    baud(115200),
+    inFlightOffset(0),
+    hasPending(false)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+HeadSerialLink::~HeadSerialLink()
+{
+    close();
+}
+
+bool HeadSerialLink::open(std::string const & port, int baud, std::string const & parity)
+{
+    close();
+
+    speed_t const speed = toSpeed(baud);
+    if (speed == B0)
+    {
+        CONTROLIT_ERROR << "Unsupported baud rate " << baud << " for " << port << ".";
+        return false;
+    }
+
+    if (parity != "odd" && parity != "even" && parity != "none")
+    {
+        CONTROLIT_ERROR << "Invalid parity \"" << parity << "\" for " << port << ", must be odd, even, or none.";
+        return false;
+    }
+
+    fd = ::open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        CONTROLIT_ERROR << "Failed to open " << port << ": " << strerror(errno);
+        return false;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        CONTROLIT_ERROR << "Failed to get the attributes of " << port << ": " << strerror(errno);
+        close();
+        return false;
+    }
+
+    cfmakeraw(&tio);
+    tio.c_cflag &= ~(CSIZE | CSTOPB | PARENB | PARODD | CRTSCTS);
+    tio.c_cflag |= CS8 | CLOCAL | CREAD;
+    if (parity != "none")
+        tio.c_cflag |= PARENB | (parity == "odd" ? PARODD : 0);
+
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+
+    if (tcsetattr(fd, TCSANOW, &tio) != 0)
+    {
+        CONTROLIT_ERROR << "Failed to configure " << port << ": " << strerror(errno);
+        close();
+        return false;
+    }
+
+    // Discard anything left over from a previous session.
+    tcflush(fd, TCIOFLUSH);
+
+    this->baud = baud;
+    bitsPerByte = parity == "none" ? 10 : 11;
+    inFlight.clear();
+    inFlightOffset = 0;
+    hasPending = false;
+
+    CONTROLIT_INFO << "Opened " << port << " at " << baud << " baud, 8" << static_cast<char>(toupper(parity[0])) << "1.";
+    return true;
+}
+
+void HeadSerialLink::close()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+size_t HeadSerialLink::receive(char * buffer, size_t size)
+{
+    if (fd < 0)
+        return 0;
+
+    ssize_t numRead;
+    do
+    {
+        numRead = ::read(fd, buffer, size);
+    } while (numRead < 0 && errno == EINTR);
+
+    if (numRead < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            CONTROLIT_ERROR_RT << "Failed to read from the head's serial port: " << strerror(errno);
+        return 0;
+    }
+
+    return numRead;
+}
+
+double HeadSerialLink::getWireTime(size_t size) const
+{
+    return static_cast<double>(size * bitsPerByte) / baud;
+}
+
+int HeadSerialLink::updateTxQueueDepth()
+{
+    int depth = 0;
+    if (ioctl(fd, TIOCOUTQ, &depth) != 0)
+        depth = 0;
+
+    stats.txQueueDepth = depth;
+    if (depth > stats.maxTxQueueDepth)
+        stats.maxTxQueueDepth = depth;
+
+    return depth;
+}
+
+bool HeadSerialLink::writeInFlight()
+{
+    while (inFlightOffset < inFlight.size())
+    {
+        ssize_t const numWritten = ::write(fd, inFlight.data() + inFlightOffset, inFlight.size() - inFlightOffset);
+
+        if (numWritten < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return false;
+
+            if (errno == EINTR)
+                continue;
+
+            // Give up on this packet.  Packets are only ever dropped at a
+            // packet boundary or after an error, so the receiver can resync
+            // on the next start byte.
+            CONTROLIT_ERROR_RT << "Failed to write to the head's serial port: " << strerror(errno);
+            stats.numDropped++;
+            inFlight.clear();
+            inFlightOffset = 0;
+            return true;
+        }
+
+        inFlightOffset += numWritten;
+    }
+
+    stats.numSent++;
+    inFlight.clear();
+    inFlightOffset = 0;
+    return true;
+}
+
+void HeadSerialLink::service()
+{
+    if (fd < 0)
+        return;
+
+    // Finish the packet in flight before starting another one.
+    if (!inFlight.empty() && !writeInFlight())
+        return;
+
+    if (!hasPending)
+    {
+        updateTxQueueDepth();
+        return;
+    }
+
+    // Wait while the driver still holds a full packet so the pending packet
+    // stays replaceable rather than queueing behind stale data.
+    if (updateTxQueueDepth() >= static_cast<int>(pending.size()))
+        return;
+
+    inFlight.swap(pending);
+    inFlightOffset = 0;
+    hasPending = false;
+    writeInFlight();
+}
+
+void HeadSerialLink::send(const char * packet, size_t size)
+{
+    stats.numPackets++;
+
+    if (fd < 0)
+    {
+        stats.numDropped++;
+        return;
+    }
+
+    if (hasPending)
+        stats.numCoalesced++;
+
+    pending.assign(packet, packet + size);
+    hasPending = true;
+
+    service();
+}
+
+void HeadSerialLink::statsToArray(HeadSerialLinkStats const & stats, std::vector<double> & array)
+{
+    array.resize(NUM_STATS_FIELDS);
+    array[0] = stats.numPackets;
+    array[1] = stats.numSent;
+    array[2] = stats.numCoalesced;
+    array[3] = stats.numDropped;
+    array[4] = stats.txQueueDepth;
+    array[5] = stats.maxTxQueueDepth;
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -0,0 +1,179 @@
+#include <controlit/dreamer/HeadSerialProtocol.hpp>
+
+#include <string.h>
+
+namespace controlit {
+namespace dreamer {
+
+#define HEAD_COMMAND_PAYLOAD_SIZE (2 + 4 * HEAD_PROTOCOL_NUM_DOFS)
+#define HEAD_ACK_PAYLOAD_SIZE 3
+#define HEAD_STATE_PAYLOAD_SIZE (2 + 4 * HEAD_PROTOCOL_NUM_DOFS)
+
+static void saveUInt16(uint8_t * buff, uint16_t val)
+{
+    buff[0] = val & 0xFF;
+    buff[1] = val >> 8;
+}
+
+static uint16_t loadUInt16(const uint8_t * buff)
+{
+    return buff[0] | (buff[1] << 8);
+}
+
+static void saveFloat(uint8_t * buff, float val)
+{
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    for (size_t ii = 0; ii < sizeof(bits); ii++)
+        buff[ii] = (bits >> (8 * ii)) & 0xFF;
+}
+
+static float loadFloat(const uint8_t * buff)
+{
+    uint32_t bits = 0;
+    for (size_t ii = 0; ii < sizeof(bits); ii++)
+        bits |= static_cast<uint32_t>(buff[ii]) << (8 * ii);
+
+    float val;
+    memcpy(&val, &bits, sizeof(val));
+    return val;
+}
+
+HeadSerialProtocol::HeadSerialProtocol() :
+    frameSize(0),
+    numCRCErrors(0),
+    numFramingErrors(0)
+{
+}
+
+size_t HeadSerialProtocol::encodeCommandV1(const float * errors, char * buffer)
+{
+    uint8_t * buff = reinterpret_cast<uint8_t *>(buffer);
+
+    buff[0] = HEAD_PROTOCOL_START_BYTE;
+    for (size_t ii = 0; ii < 4; ii++)
+        saveFloat(&buff[1 + 4 * ii], errors[ii]);
+
+    // The checksum is simply the XOR of all bytes preceding the checksum byte.
+    uint8_t checksum = 0x00;
+    for (size_t ii = 0; ii < HEAD_PROTOCOL_V1_PACKET_SIZE - 1; ii++)
+        checksum ^= buff[ii];
+    buff[HEAD_PROTOCOL_V1_PACKET_SIZE - 1] = checksum;
+
+    return HEAD_PROTOCOL_V1_PACKET_SIZE;
+}
+
+size_t HeadSerialProtocol::encodeCommand(uint16_t seq, const float * errors, char * buffer)
+{
+    uint8_t * buff = reinterpret_cast<uint8_t *>(buffer);
+
+    buff[0] = HEAD_PROTOCOL_START_BYTE;
+    buff[1] = HEAD_PROTOCOL_VERSION;
+    buff[2] = HEAD_PACKET_COMMAND;
+    buff[3] = HEAD_COMMAND_PAYLOAD_SIZE;
+
+    uint8_t * payload = &buff[HEAD_PROTOCOL_HEADER_SIZE];
+    saveUInt16(payload, seq);
+    for (size_t ii = 0; ii < HEAD_PROTOCOL_NUM_DOFS; ii++)
+        saveFloat(&payload[2 + 4 * ii], errors[ii]);
+
+    size_t const size = HEAD_PROTOCOL_HEADER_SIZE + HEAD_COMMAND_PAYLOAD_SIZE;
+    uint16_t const crc = crc16(&buff[1], size - 1);
+    buff[size] = crc >> 8;
+    buff[size + 1] = crc & 0xFF;
+
+    return size + HEAD_PROTOCOL_CRC_SIZE;
+}
+
+uint16_t HeadSerialProtocol::crc16(const uint8_t * data, size_t size, uint16_t crc)
+{
+    for (size_t ii = 0; ii < size; ii++)
+    {
+        crc ^= static_cast<uint16_t>(data[ii]) << 8;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+bool HeadSerialProtocol::parse(uint8_t byte, HeadRxPacket & packet)
+{
+    // Skip bytes until the start of a frame.
+    if (frameSize == 0 && byte != HEAD_PROTOCOL_START_BYTE)
+    {
+        numFramingErrors++;
+        return false;
+    }
+
+    frame[frameSize++] = byte;
+
+    if (frameSize == HEAD_PROTOCOL_HEADER_SIZE
+        && (frame[1] != HEAD_PROTOCOL_VERSION || frame[3] > HEAD_PROTOCOL_MAX_PAYLOAD_SIZE))
+    {
+        // Not a frame after all.  Resync on the next start byte, which may
+        // be among the header bytes already received.  These are too few to
+        // complete a frame, so feeding them again cannot yield a packet.
+        numFramingErrors++;
+        uint8_t header[HEAD_PROTOCOL_HEADER_SIZE - 1];
+        memcpy(header, &frame[1], sizeof(header));
+        frameSize = 0;
+        for (size_t ii = 0; ii < sizeof(header); ii++)
+            parse(header[ii], packet);
+        return false;
+    }
+
+    if (frameSize < HEAD_PROTOCOL_HEADER_SIZE
+        || frameSize < static_cast<size_t>(HEAD_PROTOCOL_HEADER_SIZE + frame[3] + HEAD_PROTOCOL_CRC_SIZE))
+        return false;
+
+    size_t const crcOffset = frameSize - HEAD_PROTOCOL_CRC_SIZE;
+    uint16_t const crc = (frame[crcOffset] << 8) | frame[crcOffset + 1];
+    frameSize = 0;
+
+    if (crc != crc16(&frame[1], crcOffset - 1))
+    {
+        numCRCErrors++;
+        return false;
+    }
+
+    if (!decode(packet))
+    {
+        numFramingErrors++;
+        return false;
+    }
+
+    return true;
+}
+
+bool HeadSerialProtocol::decode(HeadRxPacket & packet) const
+{
+    const uint8_t * payload = &frame[HEAD_PROTOCOL_HEADER_SIZE];
+    size_t const payloadSize = frame[3];
+
+    packet.type = frame[2];
+
+    switch (packet.type)
+    {
+        case HEAD_PACKET_ACK:
+            if (payloadSize != HEAD_ACK_PAYLOAD_SIZE)
+                return false;
+            packet.seq = loadUInt16(payload);
+            packet.status = payload[2];
+            return true;
+
+        case HEAD_PACKET_STATE:
+            if (payloadSize != HEAD_STATE_PAYLOAD_SIZE)
+                return false;
+            packet.seq = loadUInt16(payload);
+            packet.status = 0;
+            for (size_t ii = 0; ii < HEAD_PROTOCOL_NUM_DOFS; ii++)
+                packet.position[ii] = loadFloat(&payload[2 + 4 * ii]);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+} // namespace dreamer
+} // namespace controlit
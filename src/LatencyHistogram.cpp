@@ -0,0 +1,102 @@
+#include <controlit/dreamer/LatencyHistogram.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace controlit {
+namespace dreamer {
+
+LatencyHistogram::LatencyHistogram() :
+    bucketWidth(0),
+    count(0),
+    overflowCount(0),
+    maxValue(0),
+    minValue(0)
+{
+}
+
+bool LatencyHistogram::init(double bucketWidth, size_t numBuckets)
+{
+    if (bucketWidth <= 0 || numBuckets == 0)
+        return false;
+
+    this->bucketWidth = bucketWidth;
+    buckets.assign(numBuckets, 0);
+    reset();
+    return true;
+}
+
+void LatencyHistogram::record(double value)
+{
+    if (value < 0) value = 0;
+
+    size_t const index = static_cast<size_t>(value / bucketWidth);
+    if (index < buckets.size())
+        buckets[index]++;
+    else
+        overflowCount++;
+
+    count++;
+    if (value > maxValue) maxValue = value;
+    if (value < minValue || count == 1) minValue = value;
+}
+
+void LatencyHistogram::reset()
+{
+    std::fill(buckets.begin(), buckets.end(), 0);
+    count = 0;
+    overflowCount = 0;
+    maxValue = 0;
+    minValue = 0;
+}
+
+void LatencyHistogram::add(const LatencyHistogram & other)
+{
+    if (other.count == 0)
+        return;
+
+    for (size_t ii = 0; ii < buckets.size() && ii < other.buckets.size(); ii++)
+        buckets[ii] += other.buckets[ii];
+
+    if (other.maxValue > maxValue || count == 0) maxValue = other.maxValue;
+    if (other.minValue < minValue || count == 0) minValue = other.minValue;
+
+    count += other.count;
+    overflowCount += other.overflowCount;
+}
+
+double LatencyHistogram::getPercentile(double fraction) const
+{
+    if (count == 0)
+        return 0;
+
+    // The number of values that must be at or below the percentile.
+    unsigned long long const target = static_cast<unsigned long long>(std::ceil(fraction * count));
+
+    unsigned long long cumulative = 0;
+    for (size_t ii = 0; ii < buckets.size(); ii++)
+    {
+        cumulative += buckets[ii];
+        if (cumulative >= target && cumulative > 0)
+            return std::min((ii + 1) * bucketWidth, maxValue);
+    }
+
+    return maxValue;
+}
+
+std::string LatencyHistogram::toString(std::string const & prefix) const
+{
+    std::stringstream ss;
+    ss << prefix << "LatencyHistogram:\n"
+       << prefix << "  - count: " << count << "\n"
+       << prefix << "  - p50: " << getPercentile(0.5) << "\n"
+       << prefix << "  - p99: " << getPercentile(0.99) << "\n"
+       << prefix << "  - p99.9: " << getPercentile(0.999) << "\n"
+       << prefix << "  - max: " << maxValue << "\n"
+       << prefix << "  - overflow: " << overflowCount;
+    return ss.str();
+}
+
+} // namespace dreamer
+} // namespace controlit
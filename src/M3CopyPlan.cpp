@@ -0,0 +1,65 @@
+#include <controlit/dreamer/M3CopyPlan.hpp>
+
+#include <algorithm>
+#include <string.h>
+
+namespace controlit {
+namespace dreamer {
+
+M3CopyPlan::M3CopyPlan() :
+    numBytes(0)
+{
+}
+
+void M3CopyPlan::clear()
+{
+    regions.clear();
+    numBytes = 0;
+}
+
+void M3CopyPlan::addRegion(const void * base, const void * start, size_t size)
+{
+    Region region;
+    region.offset = static_cast<const unsigned char *>(start) - static_cast<const unsigned char *>(base);
+    region.size = size;
+    regions.push_back(region);
+}
+
+void M3CopyPlan::finalize()
+{
+    std::sort(regions.begin(), regions.end());
+
+    std::vector<Region> merged;
+    for (size_t ii = 0; ii < regions.size(); ii++)
+    {
+        if (!merged.empty() && regions[ii].offset <= merged.back().offset + merged.back().size)
+        {
+            size_t const end = std::max(merged.back().offset + merged.back().size,
+                regions[ii].offset + regions[ii].size);
+            merged.back().size = end - merged.back().offset;
+        }
+        else
+            merged.push_back(regions[ii]);
+    }
+
+    regions = merged;
+
+    numBytes = 0;
+    for (size_t ii = 0; ii < regions.size(); ii++)
+        numBytes += regions[ii].size;
+}
+
+void M3CopyPlan::copy(void * dest, const void * src) const
+{
+    unsigned char * destBytes = static_cast<unsigned char *>(dest);
+    const unsigned char * srcBytes = static_cast<const unsigned char *>(src);
+
+    const size_t numRegions = regions.size();
+    for (size_t ii = 0; ii < numRegions; ii++)
+    {
+        memcpy(destBytes + regions[ii].offset, srcBytes + regions[ii].offset, regions[ii].size);
+    }
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -0,0 +1,423 @@
+#include <controlit/dreamer/M3JointMap.hpp>
+
+#include <controlit/ControlModel.hpp>
+#include <controlit/logging/RealTimeLogging.hpp>
+#include <urdf/model.h>
+
+#include <sstream>
+
+namespace controlit {
+namespace dreamer {
+
+// Uncomment one of the following lines to enable/disable detailed debug statements.
+#define PRINT_INFO_STATEMENT(ss)
+// #define PRINT_INFO_STATEMENT(ss) CONTROLIT_INFO << ss;
+
+#define JOINT_MAP_PARAMETER "m3_joint_map"
+
+bool m3ChainFromName(const std::string & name, m3_chain_t & chain)
+{
+    if      (name == "right_arm")  chain = M3_CHAIN_RIGHT_ARM;
+    else if (name == "left_arm")   chain = M3_CHAIN_LEFT_ARM;
+    else if (name == "torso")      chain = M3_CHAIN_TORSO;
+    else if (name == "head")       chain = M3_CHAIN_HEAD;
+    else if (name == "right_hand") chain = M3_CHAIN_RIGHT_HAND;
+    else if (name == "left_hand")  chain = M3_CHAIN_LEFT_HAND;
+    else return false;
+    return true;
+}
+
+const char * m3ChainName(m3_chain_t chain)
+{
+    switch (chain)
+    {
+        case M3_CHAIN_RIGHT_ARM:  return "right_arm";
+        case M3_CHAIN_LEFT_ARM:   return "left_arm";
+        case M3_CHAIN_TORSO:      return "torso";
+        case M3_CHAIN_HEAD:       return "head";
+        case M3_CHAIN_RIGHT_HAND: return "right_hand";
+        case M3_CHAIN_LEFT_HAND:  return "left_hand";
+        default:                  return "invalid";
+    }
+}
+
+/*!
+ * Obtains a number from an XmlRpc value that may be either an int or a double.
+ */
+static bool getNumber(XmlRpc::XmlRpcValue & value, double & number)
+{
+    if (value.getType() == XmlRpc::XmlRpcValue::TypeInt)
+    {
+        number = static_cast<int>(value);
+        return true;
+    }
+    else if (value.getType() == XmlRpc::XmlRpcValue::TypeDouble)
+    {
+        number = static_cast<double>(value);
+        return true;
+    }
+    return false;
+}
+
+M3JointMap::M3JointMap()
+{
+}
+
+bool M3JointMap::init(ros::NodeHandle & nh, M3UTATorqueShmSdsStatus & status,
+    M3UTATorqueShmSdsCommand & command)
+{
+    PRINT_INFO_STATEMENT("Method called!");
+
+    //---------------------------------------------------------------------------------
+    // Obtain the joint map specification.
+    //---------------------------------------------------------------------------------
+
+    std::vector<EntrySpec> stateSpecs, commandSpecs;
+
+    XmlRpc::XmlRpcValue jointMapParam;
+    if (nh.getParam(JOINT_MAP_PARAMETER, jointMapParam))
+    {
+        if (jointMapParam.getType() != XmlRpc::XmlRpcValue::TypeStruct
+            || !jointMapParam.hasMember("state") || !jointMapParam.hasMember("command"))
+        {
+            CONTROLIT_ERROR << "Parameter \"" << JOINT_MAP_PARAMETER << "\" must contain a \"state\" and a \"command\" list.";
+            return false;
+        }
+
+        if (!parseEntries(jointMapParam["state"], "state", stateSpecs)) return false;
+        if (!parseEntries(jointMapParam["command"], "command", commandSpecs)) return false;
+    }
+    else
+    {
+        CONTROLIT_INFO << "Parameter \"" << JOINT_MAP_PARAMETER << "\" not set, using default joint map.";
+        getDefaultSpecs(stateSpecs, commandSpecs);
+    }
+
+    if (!initEntries(stateSpecs, commandSpecs, status, command))
+        return false;
+
+    checkURDF();
+
+    PRINT_INFO_STATEMENT(toString());
+
+    return true;
+}
+
+bool M3JointMap::initDefault(M3UTATorqueShmSdsStatus & status, M3UTATorqueShmSdsCommand & command)
+{
+    std::vector<EntrySpec> stateSpecs, commandSpecs;
+    getDefaultSpecs(stateSpecs, commandSpecs);
+    return initEntries(stateSpecs, commandSpecs, status, command);
+}
+
+bool M3JointMap::initEntries(const std::vector<EntrySpec> & stateSpecs,
+    const std::vector<EntrySpec> & commandSpecs, M3UTATorqueShmSdsStatus & status,
+    M3UTATorqueShmSdsCommand & command)
+{
+    stateMap.clear();
+    commandMap.clear();
+
+    // Resolve the specifications into pointers within the status and command
+    // structures.
+    for (size_t ii = 0; ii < stateSpecs.size(); ii++)
+    {
+        if (!addStateEntry(status, stateSpecs[ii])) return false;
+    }
+
+    for (size_t ii = 0; ii < commandSpecs.size(); ii++)
+    {
+        if (!addCommandEntry(command, commandSpecs[ii])) return false;
+    }
+
+    return true;
+}
+
+bool M3JointMap::parseEntries(XmlRpc::XmlRpcValue & list, const std::string & listName,
+    std::vector<EntrySpec> & entries)
+{
+    if (list.getType() != XmlRpc::XmlRpcValue::TypeArray)
+    {
+        CONTROLIT_ERROR << "Joint map \"" << listName << "\" is not a list.";
+        return false;
+    }
+
+    for (int ii = 0; ii < list.size(); ii++)
+    {
+        XmlRpc::XmlRpcValue & entry = list[ii];
+
+        if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct
+            || !entry.hasMember("name") || !entry.hasMember("chain") || !entry.hasMember("slot")
+            || entry["name"].getType() != XmlRpc::XmlRpcValue::TypeString
+            || entry["chain"].getType() != XmlRpc::XmlRpcValue::TypeString
+            || entry["slot"].getType() != XmlRpc::XmlRpcValue::TypeInt)
+        {
+            CONTROLIT_ERROR << "Joint map \"" << listName << "\" entry " << ii
+                            << " must contain a name, chain, and slot.";
+            return false;
+        }
+
+        EntrySpec spec;
+        spec.name = static_cast<std::string>(entry["name"]);
+        spec.slot = static_cast<int>(entry["slot"]);
+        spec.sign = 1;
+        spec.scale = 1;
+        spec.offset = 0;
+
+        if (!m3ChainFromName(static_cast<std::string>(entry["chain"]), spec.chain))
+        {
+            CONTROLIT_ERROR << "Joint map \"" << listName << "\" entry " << ii << " (" << spec.name
+                            << ") has invalid chain \"" << static_cast<std::string>(entry["chain"]) << "\".";
+            return false;
+        }
+
+        if ((entry.hasMember("sign") && !getNumber(entry["sign"], spec.sign))
+            || (entry.hasMember("scale") && !getNumber(entry["scale"], spec.scale))
+            || (entry.hasMember("offset") && !getNumber(entry["offset"], spec.offset)))
+        {
+            CONTROLIT_ERROR << "Joint map \"" << listName << "\" entry " << ii << " (" << spec.name
+                            << ") has a non-numeric sign, scale, or offset.";
+            return false;
+        }
+
+        // Commands are divided by the sign and scale, so neither may be zero.
+        if (spec.sign != 1 && spec.sign != -1)
+        {
+            CONTROLIT_ERROR << "Joint map \"" << listName << "\" entry " << ii << " (" << spec.name
+                            << ") has invalid sign " << spec.sign << " (must be 1 or -1).";
+            return false;
+        }
+
+        if (spec.scale == 0)
+        {
+            CONTROLIT_ERROR << "Joint map \"" << listName << "\" entry " << ii << " (" << spec.name
+                            << ") has a scale of zero.";
+            return false;
+        }
+
+        entries.push_back(spec);
+    }
+
+    return true;
+}
+
+void M3JointMap::getDefaultSpecs(std::vector<EntrySpec> & stateSpecs,
+    std::vector<EntrySpec> & commandSpecs)
+{
+    const char * armJointNames[] = {"shoulder_extensor", "shoulder_abductor", "shoulder_rotator",
+        "elbow", "wrist_rotator", "wrist_pitch", "wrist_yaw"};
+
+    EntrySpec spec;
+    spec.sign = 1;
+    spec.scale = 1;
+    spec.offset = 0;
+
+    // Torso. The torso_yaw joint is not controlled and torso_upper_pitch
+    // is a slave of torso_lower_pitch, so only the latter is commanded.
+    spec.chain = M3_CHAIN_TORSO;
+    spec.name = "torso_lower_pitch"; spec.slot = 1;
+    stateSpecs.push_back(spec);
+    commandSpecs.push_back(spec);
+
+    spec.name = "torso_upper_pitch"; spec.slot = 2;
+    stateSpecs.push_back(spec);
+
+    // Left arm. The left_wrist_yaw joint is mounted in the opposite direction.
+    spec.chain = M3_CHAIN_LEFT_ARM;
+    for (int ii = 0; ii < 7; ii++)
+    {
+        spec.name = std::string("left_") + armJointNames[ii];
+        spec.slot = ii;
+        spec.sign = (ii == 6 ? -1 : 1);
+        stateSpecs.push_back(spec);
+        commandSpecs.push_back(spec);
+    }
+
+    // Right arm.
+    spec.chain = M3_CHAIN_RIGHT_ARM;
+    spec.sign = 1;
+    for (int ii = 0; ii < 7; ii++)
+    {
+        spec.name = std::string("right_") + armJointNames[ii];
+        spec.slot = ii;
+        stateSpecs.push_back(spec);
+        commandSpecs.push_back(spec);
+    }
+}
+
+bool M3JointMap::addStateEntry(M3UTATorqueShmSdsStatus & status, const EntrySpec & spec)
+{
+    if (spec.slot < 0 || spec.slot >= MAX_NDOF)
+    {
+        CONTROLIT_ERROR << "Invalid slot " << spec.slot << " for joint " << spec.name
+                        << " (must be in range [0, " << MAX_NDOF << "))";
+        return false;
+    }
+
+    M3TorqueShmSdsBaseStatus & limb = m3LimbStatus(status, spec.chain);
+
+    StateEntry entry;
+    entry.name = spec.name;
+    entry.chain = spec.chain;
+    entry.slot = spec.slot;
+    entry.theta = &limb.theta[spec.slot];
+    entry.thetadot = &limb.thetadot[spec.slot];
+    entry.torque = &limb.torque[spec.slot];
+    entry.positionScale = spec.sign * spec.scale * DEG_TO_RAD_SCALE;
+    entry.velocityScale = spec.sign * spec.scale * DEG_TO_RAD_SCALE;
+    entry.effortScale = spec.sign * spec.scale * MNM_TO_NM_SCALE;
+    entry.positionOffset = spec.offset;
+
+    stateMap.push_back(entry);
+    return true;
+}
+
+bool M3JointMap::addCommandEntry(M3UTATorqueShmSdsCommand & command, const EntrySpec & spec)
+{
+    if (spec.slot < 0 || spec.slot >= MAX_NDOF)
+    {
+        CONTROLIT_ERROR << "Invalid slot " << spec.slot << " for joint " << spec.name
+                        << " (must be in range [0, " << MAX_NDOF << "))";
+        return false;
+    }
+
+    M3TorqueShmSdsBaseCommand & limb = m3LimbCommand(command, spec.chain);
+
+    CommandEntry entry;
+    entry.name = spec.name;
+    entry.chain = spec.chain;
+    entry.slot = spec.slot;
+    entry.tqDesired = &limb.tq_desired[spec.slot];
+    entry.effortScale = NM_TO_MNM_SCALE / (spec.sign * spec.scale);
+
+    commandMap.push_back(entry);
+    return true;
+}
+
+void M3JointMap::checkURDF() const
+{
+    urdf::Model urdfModel;
+    if (!urdfModel.initParam("robot_description"))
+    {
+        CONTROLIT_WARN << "Unable to load URDF, not verifying the joint map against the robot model.";
+        return;
+    }
+
+    for (size_t ii = 0; ii < stateMap.size(); ii++)
+    {
+        auto joint = urdfModel.getJoint(stateMap[ii].name);
+        if (!joint)
+        {
+            CONTROLIT_WARN << "Joint map entry " << stateMap[ii].name << " is not in the URDF.";
+        }
+        else if (joint->type == urdf::Joint::FIXED)
+        {
+            CONTROLIT_WARN << "Joint map entry " << stateMap[ii].name << " is a fixed joint in the URDF.";
+        }
+    }
+}
+
+bool M3JointMap::checkModel(RTControlModel * model) const
+{
+    if (model == nullptr || model->get() == nullptr)
+    {
+        CONTROLIT_ERROR << "No robot model, unable to verify the joint map.";
+        return false;
+    }
+
+    size_t const numRealJoints = model->get()->getRealJointNamesVector().size();
+    size_t const numActuatedJoints = model->get()->getActuatedJointNamesVector().size();
+
+    if (stateMap.size() != numRealJoints || commandMap.size() != numActuatedJoints)
+    {
+        CONTROLIT_ERROR << "Joint map has " << stateMap.size() << " state and " << commandMap.size()
+                        << " command joints but the robot model has " << numRealJoints << " real and "
+                        << numActuatedJoints << " actuated joints.";
+        return false;
+    }
+
+    return true;
+}
+
+void M3JointMap::gather(Vector & position, Vector & velocity, Vector & effort) const
+{
+    const size_t numJoints = stateMap.size();
+    for (size_t ii = 0; ii < numJoints; ii++)
+    {
+        const StateEntry & entry = stateMap[ii];
+        position[ii] = entry.positionScale * (*entry.theta) + entry.positionOffset;
+        velocity[ii] = entry.velocityScale * (*entry.thetadot);
+        effort[ii]   = entry.effortScale * (*entry.torque);
+    }
+}
+
+unsigned int M3JointMap::scatter(const Vector & effort) const
+{
+    unsigned int dirtyMask = 0;
+
+    const size_t numJoints = commandMap.size();
+    for (size_t ii = 0; ii < numJoints; ii++)
+    {
+        const CommandEntry & entry = commandMap[ii];
+        mReal const value = entry.effortScale * effort[ii];
+        dirtyMask |= static_cast<unsigned int>(*entry.tqDesired != value) << entry.chain;
+        *entry.tqDesired = value;
+    }
+
+    return dirtyMask;
+}
+
+void M3JointMap::gatherCommand(Vector & effort) const
+{
+    const size_t numJoints = commandMap.size();
+    for (size_t ii = 0; ii < numJoints; ii++)
+    {
+        const CommandEntry & entry = commandMap[ii];
+        effort[ii] = (*entry.tqDesired) / entry.effortScale;
+    }
+}
+
+void M3JointMap::addStateRegions(M3CopyPlan & plan, const M3UTATorqueShmSdsStatus & status) const
+{
+    for (size_t ii = 0; ii < stateMap.size(); ii++)
+    {
+        plan.addRegion(&status, stateMap[ii].theta, sizeof(mReal));
+        plan.addRegion(&status, stateMap[ii].thetadot, sizeof(mReal));
+        plan.addRegion(&status, stateMap[ii].torque, sizeof(mReal));
+    }
+}
+
+void M3JointMap::addCommandRegions(M3CopyPlan & plan, const M3UTATorqueShmSdsCommand & command,
+    m3_chain_t chain) const
+{
+    for (size_t ii = 0; ii < commandMap.size(); ii++)
+    {
+        if (commandMap[ii].chain == chain)
+            plan.addRegion(&command, commandMap[ii].tqDesired, sizeof(mReal));
+    }
+}
+
+std::string M3JointMap::toString(std::string const & prefix) const
+{
+    std::stringstream ss;
+    ss << prefix << "M3JointMap:\n"
+       << prefix << "  - state:\n";
+
+    for (size_t ii = 0; ii < stateMap.size(); ii++)
+    {
+        ss << prefix << "    " << ii << ": " << stateMap[ii].name << " -> "
+           << m3ChainName(stateMap[ii].chain) << "[" << stateMap[ii].slot << "]\n";
+    }
+
+    ss << prefix << "  - command:\n";
+
+    for (size_t ii = 0; ii < commandMap.size(); ii++)
+    {
+        ss << prefix << "    " << ii << ": " << commandMap[ii].name << " -> "
+           << m3ChainName(commandMap[ii].chain) << "[" << commandMap[ii].slot << "]\n";
+    }
+
+    return ss.str();
+}
+
+} // namespace dreamer
+} // namespace controlit
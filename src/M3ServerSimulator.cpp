@@ -0,0 +1,320 @@
+#include <controlit/dreamer/M3ServerSimulator.hpp>
+
+#include <rtai_nam2num.h>
+#include <rtai_sched.h>
+
+#include <algorithm>
+#include <iostream>
+#include <signal.h>
+#include <sstream>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace controlit {
+namespace dreamer {
+
+#define DEFAULT_SERVO_FREQUENCY 1000  // In Hz
+#define DEFAULT_INERTIA 0.05          // In kg*m^2
+#define DEFAULT_DAMPING 1.0           // In Nm*s/rad
+#define COMMAND_TIMEOUT_CYCLES 100    // Disable joints if the command timestamp does not change for this many cycles
+#define MAX_SEQLOCK_RETRIES 10
+#define NS_PER_SEC 1000000000L
+
+#define DEG_TO_RAD(deg) ((deg) / 180 * 3.14159265359)
+#define RAD_TO_DEG(rad) ((rad) / 3.14159265359 * 180)
+
+M3ServerSimulator::M3ServerSimulator() :
+    sharedMemoryPtr(nullptr),
+    useSeqLock(false),
+    period(1.0 / DEFAULT_SERVO_FREQUENCY),
+    inertia(DEFAULT_INERTIA),
+    damping(DEFAULT_DAMPING),
+    continueRunning(false),
+    enabled(false),
+    staleCommandCycles(0),
+    prevCommandTimestamp(0),
+    cycleCount(0),
+    overrunCount(0),
+    commandReadFailures(0)
+{
+    memset(position, 0, sizeof(position));
+    memset(velocity, 0, sizeof(velocity));
+    memset(&status, 0, sizeof(status));
+    memset(&command, 0, sizeof(command));
+}
+
+M3ServerSimulator::~M3ServerSimulator()
+{
+    if (transport)
+        transport->destroy();
+}
+
+bool M3ServerSimulator::init(const std::string & transportType, bool useSeqLock, double freq,
+    double inertia, double damping)
+{
+    if (freq <= 0 || inertia <= 0 || damping < 0)
+    {
+        std::cerr << "M3ServerSimulator::init: ERROR: Invalid frequency, inertia, or damping." << std::endl;
+        return false;
+    }
+
+    this->useSeqLock = useSeqLock;
+    this->period = 1.0 / freq;
+    this->inertia = inertia;
+    this->damping = damping;
+
+    transport.reset(createSHMTransport(transportType));
+    if (!transport)
+    {
+        std::cerr << "M3ServerSimulator::init: ERROR: Invalid transport \"" << transportType << "\"." << std::endl;
+        return false;
+    }
+
+    // RTAI semaphores can only be used by RTAI tasks.
+    if (transport->usesRTAI())
+    {
+        rt_allow_nonroot_hrt();
+        if (!rt_task_init_schmod(nam2num("TSHMSM"), 0, 0, 0, SCHED_FIFO, 0xF))
+        {
+            std::cerr << "M3ServerSimulator::init: ERROR: rt_task_init_schmod failed." << std::endl;
+            return false;
+        }
+    }
+
+    if (!transport->create())
+    {
+        std::cerr << "M3ServerSimulator::init: ERROR: Unable to create shared memory." << std::endl;
+        return false;
+    }
+
+    sharedMemoryPtr = transport->getSharedMemory();
+
+    statusSeqLock.init(reinterpret_cast<unsigned char *>(sharedMemoryPtr->status), MAX_SDS_SIZE_BYTES);
+    commandSeqLock.init(reinterpret_cast<unsigned char *>(sharedMemoryPtr->cmd), MAX_SDS_SIZE_BYTES);
+
+    writeStatus();
+    return true;
+}
+
+void M3ServerSimulator::readCommand()
+{
+    if (useSeqLock)
+    {
+        // On failure, keep using the previous command.
+        unsigned int retries;
+        M3UTATorqueShmSdsCommand latestCommand;
+        if (commandSeqLock.read(&latestCommand, sharedMemoryPtr->cmd, sizeof(latestCommand),
+            MAX_SEQLOCK_RETRIES, retries))
+            command = latestCommand;
+        else
+            commandReadFailures++;
+    }
+    else
+    {
+        transport->lockCommand();
+        memcpy(&command, sharedMemoryPtr->cmd, sizeof(command));
+        transport->unlockCommand();
+    }
+
+    // Like the M3 server, disable the joints when the controller stops
+    // updating the command timestamp.
+    if (command.timestamp != prevCommandTimestamp)
+    {
+        prevCommandTimestamp = command.timestamp;
+        staleCommandCycles = 0;
+        enabled = true;
+    }
+    else if (++staleCommandCycles > COMMAND_TIMEOUT_CYCLES)
+    {
+        enabled = false;
+    }
+}
+
+void M3ServerSimulator::stepChain(m3_chain_t chain)
+{
+    M3TorqueShmSdsBaseStatus & limbStatus = m3LimbStatus(status, chain);
+    M3TorqueShmSdsBaseCommand & limbCommand = m3LimbCommand(command, chain);
+
+    for (int ii = 0; ii < MAX_NDOF; ii++)
+    {
+        // Head joints commanded by position slew toward q_desired, which is in degrees.
+        if (chain == M3_CHAIN_HEAD && limbCommand.slew_rate_q_desired[ii] > 0)
+        {
+            double const maxStep = DEG_TO_RAD(limbCommand.slew_rate_q_desired[ii]) * period;
+            double const step = enabled ? DEG_TO_RAD(limbCommand.q_desired[ii]) - position[chain][ii] : 0;
+
+            velocity[chain][ii] = std::max(-maxStep, std::min(maxStep, step)) / period;
+            position[chain][ii] += velocity[chain][ii] * period;
+
+            limbStatus.theta[ii] = RAD_TO_DEG(position[chain][ii]);
+            limbStatus.thetadot[ii] = RAD_TO_DEG(velocity[chain][ii]);
+            limbStatus.torque[ii] = 0;
+            continue;
+        }
+
+        // The commanded torque is in mNm.
+        double const torque = enabled ? 1.0e-3 * limbCommand.tq_desired[ii] : 0;
+
+        // Semi-implicit Euler integration of I * qdd + b * qd = tau.
+        double const acceleration = (torque - damping * velocity[chain][ii]) / inertia;
+        velocity[chain][ii] += acceleration * period;
+        position[chain][ii] += velocity[chain][ii] * period;
+
+        limbStatus.theta[ii] = RAD_TO_DEG(position[chain][ii]);
+        limbStatus.thetadot[ii] = RAD_TO_DEG(velocity[chain][ii]);
+        limbStatus.torque[ii] = 1.0e3 * torque;
+    }
+}
+
+void M3ServerSimulator::writeStatus()
+{
+    if (useSeqLock)
+    {
+        statusSeqLock.write(sharedMemoryPtr->status, &status, sizeof(status));
+    }
+    else
+    {
+        transport->lockStatus();
+        memcpy(sharedMemoryPtr->status, &status, sizeof(status));
+        transport->unlockStatus();
+    }
+}
+
+void M3ServerSimulator::run()
+{
+    continueRunning = true;
+
+    long long const periodNs = static_cast<long long>(period * NS_PER_SEC);
+
+    struct timespec startTime, nextTime, now;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    nextTime = startTime;
+
+    while (continueRunning)
+    {
+        nextTime.tv_nsec += periodNs;
+        while (nextTime.tv_nsec >= NS_PER_SEC)
+        {
+            nextTime.tv_nsec -= NS_PER_SEC;
+            nextTime.tv_sec++;
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextTime, nullptr);
+
+        readCommand();
+
+        for (int chain = 0; chain < M3_NUM_CHAINS; chain++)
+            stepChain(static_cast<m3_chain_t>(chain));
+
+        // Like the M3 server, the timestamp is the number of microseconds since
+        // starting and the command's sequence number is reflected back.
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        status.timestamp = (now.tv_sec - startTime.tv_sec) * 1000000LL
+            + (now.tv_nsec - startTime.tv_nsec) / 1000;
+        status.seqno = command.seqno;
+
+        writeStatus();
+
+        cycleCount++;
+
+        long long const lateness = (now.tv_sec - nextTime.tv_sec) * NS_PER_SEC + (now.tv_nsec - nextTime.tv_nsec);
+        if (lateness > periodNs)
+            overrunCount++;
+
+        if (cycleCount % static_cast<unsigned long long>(1.0 / period) == 0)
+            std::cout << toString() << std::endl;
+    }
+}
+
+void M3ServerSimulator::stop()
+{
+    continueRunning = false;
+}
+
+std::string M3ServerSimulator::toString(std::string const & prefix) const
+{
+    std::stringstream ss;
+    ss << prefix << "M3ServerSimulator: cycles = " << cycleCount
+       << ", overruns = " << overrunCount
+       << ", command read failures = " << commandReadFailures
+       << ", joints " << (enabled ? "enabled" : "disabled");
+    return ss.str();
+}
+
+} // namespace dreamer
+} // namespace controlit
+
+static controlit::dreamer::M3ServerSimulator * simulatorPtr = nullptr;
+
+static void signalHandler(int)
+{
+    if (simulatorPtr) simulatorPtr->stop();
+}
+
+// This is the main method that starts everything.
+int main(int argc, char **argv)
+{
+    // Define usage
+    std::stringstream ss;
+    ss << "Usage: rosrun controlit_dreamer_integration M3ServerSimulator [options]\n"
+       << "Valid options include:\n"
+       << "  -h: display this usage string\n"
+       << "  -f [frequency]: the status update frequency (default: " << DEFAULT_SERVO_FREQUENCY << "Hz)\n"
+       << "  -t [transport]: the shared memory transport, \"rtai\" or \"posix\" (default: posix)\n"
+       << "  -s: exchange data using sequence locks instead of the transport's locks\n"
+       << "  -i [inertia]: the inertia of each joint (default: " << DEFAULT_INERTIA << " kg*m^2)\n"
+       << "  -d [damping]: the viscous damping of each joint (default: " << DEFAULT_DAMPING << " Nm*s/rad)";
+
+    double freq = DEFAULT_SERVO_FREQUENCY;
+    double inertia = DEFAULT_INERTIA;
+    double damping = DEFAULT_DAMPING;
+    std::string transportType = "posix";
+    bool useSeqLock = false;
+
+    // Parse the command line arguments
+    int option_char;
+    while ((option_char = getopt (argc, argv, "hf:t:si:d:")) != -1)
+    {
+        switch (option_char)
+        {
+            case 'h':
+                std::cout << ss.str() << std::endl;
+                return 0;
+                break;
+            case 'f':
+                freq = std::stod(optarg);
+                break;
+            case 't':
+                transportType = optarg;
+                break;
+            case 's':
+                useSeqLock = true;
+                break;
+            case 'i':
+                inertia = std::stod(optarg);
+                break;
+            case 'd':
+                damping = std::stod(optarg);
+                break;
+            default:
+                std::cerr << "ERROR: Unknown option " << option_char << ".  " << ss.str() << std::endl;
+                return -1;
+        }
+    }
+
+    controlit::dreamer::M3ServerSimulator simulator;
+    if (!simulator.init(transportType, useSeqLock, freq, inertia, damping)) return -1;
+
+    simulatorPtr = &simulator;
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+
+    std::cout << "M3ServerSimulator: Running at " << freq << "Hz using the " << transportType
+              << " transport. Press ctrl+c to stop." << std::endl;
+
+    simulator.run();
+
+    std::cout << "M3ServerSimulator: Done. " << simulator.toString() << std::endl;
+    return 0;
+}
@@ -18,7 +18,11 @@ namespace dreamer {
 // #define PRINT_INFO_STATEMENT_RT_ALWAYS(ss) std::cout << ss << std::endl;
 
 OdometryStateReceiverDreamer::OdometryStateReceiverDreamer() :
-    OdometryStateReceiver() // Call super-class' constructor
+    OdometryStateReceiver(), // Call super-class' constructor
+    fixedBase(true),
+    basePosition(Vector3d::Zero()),
+    baseOrientation(Eigen::Quaterniond::Identity()),
+    baseVelocity(Vector::Zero(6))
 {
 }
 
@@ -34,13 +38,21 @@ bool OdometryStateReceiverDreamer::init(ros::NodeHandle & nh, RTControlModel * m
     // If the super-class fails to initialize, abort.
     if (!initSuccess) return false;
 
+    nh.param("fixed_base", fixedBase, true);
+
     return true;
 }
 
 bool OdometryStateReceiverDreamer::getOdometry(controlit::RobotState & latestRobotState, bool block)
 {
+    // In fixed-base mode, the base state never changes after it is first set.
+    // Check the state itself rather than remembering which RobotState was set,
+    // since a RobotState may be reinitialized or reallocated at the same address.
+    if (fixedBase && hasBaseState(latestRobotState))
+        return true;
+
     // Dreamer is fixed to the world.  Just set the base state equal to zero.
-    if (!latestRobotState.setRobotBaseState(Vector3d::Zero(), Eigen::Quaterniond::Identity(), Vector::Zero(6)))
+    if (!latestRobotState.setRobotBaseState(basePosition, baseOrientation, baseVelocity))
     {
         CONTROLIT_WARN_RT << "Failed to set robot base state, aborting this read operation.";
         return false;
@@ -49,5 +61,15 @@ bool OdometryStateReceiverDreamer::getOdometry(controlit::RobotState & latestRob
     return true;
 }
 
+bool OdometryStateReceiverDreamer::hasBaseState(const controlit::RobotState & robotState) const
+{
+    const Vector & velocity = robotState.getRobotBaseVelocity();
+
+    return robotState.getRobotBasePosition() == basePosition
+        && robotState.getRobotBaseOrientation().coeffs() == baseOrientation.coeffs()
+        && velocity.size() == baseVelocity.size()
+        && velocity == baseVelocity;
+}
+
 } // namespace dreamer
 } // namespace controlit
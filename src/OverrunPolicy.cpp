@@ -0,0 +1,106 @@
+#include <controlit/dreamer/OverrunPolicy.hpp>
+#include <controlit/logging/RealTimeLogging.hpp>
+
+namespace controlit {
+namespace dreamer {
+
+#define DEFAULT_SLACK_THRESHOLD 0.0001       // in seconds
+#define DEFAULT_FALLBACK_COUNT 10
+#define DEFAULT_FALLBACK_FACTOR 2.0
+#define DEFAULT_FALLBACK_MIN_FREQUENCY 250.0  // in Hz
+
+std::atomic<bool> OverrunPolicy::slackLow(false);
+
+OverrunPolicy::OverrunPolicy() :
+    enabled(false),
+    slackThreshold(DEFAULT_SLACK_THRESHOLD),
+    holdOnMiss(true),
+    fallbackCount(DEFAULT_FALLBACK_COUNT),
+    fallbackFactor(DEFAULT_FALLBACK_FACTOR),
+    maxPeriod(1.0 / DEFAULT_FALLBACK_MIN_FREQUENCY),
+    period(0),
+    lastComputeTime(0),
+    consecutiveOverruns(0)
+{
+}
+
+void OverrunPolicy::init(ros::NodeHandle & nh, double period)
+{
+    double minFrequency;
+    nh.param("overrun_policy_enabled", enabled, false);
+    nh.param("overrun_slack_threshold", slackThreshold, DEFAULT_SLACK_THRESHOLD);
+    nh.param("overrun_hold_on_miss", holdOnMiss, true);
+    nh.param("overrun_fallback_count", fallbackCount, DEFAULT_FALLBACK_COUNT);
+    nh.param("overrun_fallback_factor", fallbackFactor, DEFAULT_FALLBACK_FACTOR);
+    nh.param("overrun_fallback_min_frequency", minFrequency, DEFAULT_FALLBACK_MIN_FREQUENCY);
+
+    if (fallbackFactor <= 1 || minFrequency <= 0)
+    {
+        CONTROLIT_WARN << "Invalid overrun_fallback_factor (" << fallbackFactor << ") or "
+                       << "overrun_fallback_min_frequency (" << minFrequency << "), disabling the rate fallback.";
+        fallbackCount = 0;
+    }
+
+    maxPeriod = minFrequency > 0 ? 1.0 / minFrequency : period;
+    this->period = period;
+    lastComputeTime = 0;
+    consecutiveOverruns = 0;
+    slackLow = false;
+
+    if (enabled)
+    {
+        CONTROLIT_INFO << "Overrun policy: slack threshold = " << slackThreshold * 1e6 << "us, hold on miss = "
+                       << (holdOnMiss ? "true" : "false") << ", rate fallback after " << fallbackCount
+                       << " overruns by a factor of " << fallbackFactor << " down to " << minFrequency << "Hz";
+    }
+}
+
+unsigned int OverrunPolicy::beginCycle(double lateness)
+{
+    unsigned int flags = 0;
+
+    if (lateness >= period)
+        flags |= SERVO_CYCLE_MISSED_PERIOD;
+
+    if (!enabled)
+        return flags;
+
+    if ((flags & SERVO_CYCLE_MISSED_PERIOD) && holdOnMiss)
+        flags |= SERVO_CYCLE_HELD;
+
+    // Predict the slack assuming servoUpdate() takes as long as it did last time.
+    if (period - lateness - lastComputeTime < slackThreshold)
+        flags |= SERVO_CYCLE_LOW_SLACK;
+
+    slackLow.store((flags & SERVO_CYCLE_LOW_SLACK) != 0, std::memory_order_relaxed);
+    return flags;
+}
+
+unsigned int OverrunPolicy::endCycle(double computeTime, double slack, bool held)
+{
+    // Held cycles neither count as overruns nor end a series of overruns.
+    if (!enabled || held)
+        return 0;
+
+    lastComputeTime = computeTime;
+
+    if (slack >= 0)
+    {
+        consecutiveOverruns = 0;
+        return 0;
+    }
+
+    if (fallbackCount <= 0 || ++consecutiveOverruns < fallbackCount)
+        return 0;
+
+    consecutiveOverruns = 0;
+
+    if (period * fallbackFactor > maxPeriod * (1 + 1e-9))
+        return 0;
+
+    period *= fallbackFactor;
+    return SERVO_CYCLE_RATE_FALLBACK;
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -2,9 +2,15 @@
 #include <controlit/ServoClock.hpp>
 
 #include <controlit/dreamer/ServoClockDreamer.hpp>
+#include <controlit/dreamer/ServoClockDreamerPosix.hpp>
+#include <controlit/dreamer/ServoClockDreamerFreeRun.hpp>
 #include <controlit/dreamer/RobotInterfaceDreamer.hpp>
+#include <controlit/dreamer/RobotInterfaceDreamerReplay.hpp>
 
 // Defined in /opt/ros/indigo/include/pluginlib/class_list_macros.h:
 //
 PLUGINLIB_EXPORT_CLASS(controlit::dreamer::ServoClockDreamer, controlit::ServoClock);
+PLUGINLIB_EXPORT_CLASS(controlit::dreamer::ServoClockDreamerPosix, controlit::ServoClock);
+PLUGINLIB_EXPORT_CLASS(controlit::dreamer::ServoClockDreamerFreeRun, controlit::ServoClock);
 PLUGINLIB_EXPORT_CLASS(controlit::dreamer::RobotInterfaceDreamer, controlit::RobotInterface);
+PLUGINLIB_EXPORT_CLASS(controlit::dreamer::RobotInterfaceDreamerReplay, controlit::RobotInterface);
@@ -0,0 +1,145 @@
+#include <controlit/dreamer/RTChecker.hpp>
+#include <controlit/logging/RealTimeLogging.hpp>
+
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <stdlib.h>
+#include <sstream>
+
+namespace controlit {
+namespace dreamer {
+
+#define RT_CHECKER_DRAIN_SIZE 256
+
+RTChecker::RTChecker() :
+    active(false),
+    numDropped(0),
+    numEvents(0)
+{
+}
+
+bool RTChecker::init(bool enabled)
+{
+    active = false;
+
+    if (!enabled)
+        return false;
+
+    if (controlit_dreamer_rt_checker_arm == nullptr
+        || controlit_dreamer_rt_checker_disarm == nullptr
+        || controlit_dreamer_rt_checker_drain == nullptr)
+    {
+        CONTROLIT_WARN << "The RT checker is enabled but libcontrolit_dreamer_rt_checker.so is not loaded. "
+                       << "Start the controller with LD_PRELOAD=<path>/libcontrolit_dreamer_rt_checker.so.";
+        return false;
+    }
+
+    events.resize(RT_CHECKER_DRAIN_SIZE);
+    active = true;
+
+    CONTROLIT_INFO << "Checking the servo loop for heap allocations and system calls.";
+    return true;
+}
+
+std::string RTChecker::symbolize(void * address)
+{
+    char ** symbols = backtrace_symbols(&address, 1);
+    if (!symbols)
+        return "?";
+
+    std::string symbol = symbols[0];
+    free(symbols);
+
+    // The symbols look like "library(mangled+offset) [address]".
+    size_t const begin = symbol.find('(');
+    size_t const end = symbol.find('+', begin);
+    if (begin != std::string::npos && end != std::string::npos)
+    {
+        int status;
+        char * demangled = abi::__cxa_demangle(symbol.substr(begin + 1, end - begin - 1).c_str(),
+            nullptr, nullptr, &status);
+        if (status == 0)
+            symbol = symbol.substr(0, begin + 1) + demangled + symbol.substr(end);
+        free(demangled);
+    }
+
+    return symbol;
+}
+
+std::string RTChecker::getBacktrace(const RTCheckerEvent & event, std::string const & prefix)
+{
+    std::stringstream ss;
+    for (int ii = 0; ii < event.numFrames; ii++)
+        ss << "\n" << prefix << "  #" << ii << " " << symbolize(event.frames[ii]);
+    return ss.str();
+}
+
+void RTChecker::report()
+{
+    if (!active)
+        return;
+
+    size_t dropped;
+    size_t numDrained;
+    while ((numDrained = controlit_dreamer_rt_checker_drain(events.data(), events.size(), &dropped)) > 0
+        || dropped > 0)
+    {
+        numDropped += dropped;
+        numEvents += numDrained + dropped;
+        if (dropped > 0)
+            CONTROLIT_WARN << "The RT checker dropped " << dropped << " events.";
+
+        for (size_t ii = 0; ii < numDrained; ii++)
+        {
+            const RTCheckerEvent & event = events[ii];
+            std::vector<void *> key(event.frames, event.frames + event.numFrames);
+
+            std::map<std::vector<void *>, CallSite>::iterator site = callSites.find(key);
+            if (site == callSites.end())
+            {
+                CallSite newSite = {event.function, 1, event.size};
+                callSites[key] = newSite;
+
+                CONTROLIT_WARN << "Call to " << event.function << "()"
+                               << (event.size > 0 ? " (" + std::to_string(event.size) + " bytes)" : "")
+                               << " in the servo loop:" << getBacktrace(event, "");
+            }
+            else
+            {
+                site->second.count++;
+                site->second.bytes += event.size;
+            }
+        }
+    }
+}
+
+std::string RTChecker::toString(std::string const & prefix) const
+{
+    std::stringstream ss;
+    ss << prefix << "RT checker detected " << callSites.size() << " call sites in the servo loop"
+       << " (" << numDropped << " events dropped)";
+
+    for (std::map<std::vector<void *>, CallSite>::const_iterator site = callSites.begin();
+        site != callSites.end(); site++)
+    {
+        ss << "\n" << prefix << "  - " << site->second.function << "(): " << site->second.count << " calls";
+        if (site->second.bytes > 0)
+            ss << ", " << site->second.bytes << " bytes";
+
+        // Skip the frames within the C++ standard library, e.g., operator new.
+        for (size_t ii = 0; ii < site->first.size(); ii++)
+        {
+            std::string const caller = symbolize(site->first[ii]);
+            if (caller.find("libstdc++") == std::string::npos || ii + 1 == site->first.size())
+            {
+                ss << ", from " << caller;
+                break;
+            }
+        }
+    }
+
+    return ss.str();
+}
+
+} // namespace dreamer
+} // namespace controlit
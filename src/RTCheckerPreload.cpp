@@ -0,0 +1,341 @@
+/*
+ * The preload library of RTChecker.  Build it as a shared library and
+ * load it via LD_PRELOAD.  It interposes the heap allocation functions and
+ * the libc wrappers of the system calls that commonly creep into a servo
+ * loop.  While a thread is armed, each interposed call is recorded with its
+ * backtrace into a queue that RTChecker::report() drains.
+ *
+ * This library must not depend on anything that allocates or makes system
+ * calls on the recording path.
+ */
+
+#define CONTROLIT_DREAMER_RT_CHECKER_PRELOAD
+#include <controlit/dreamer/RTChecker.hpp>
+
+#include <atomic>
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+using controlit::dreamer::RTCheckerEvent;
+
+#define RT_CHECKER_QUEUE_SIZE 1024  // must be a power of two
+#define RT_CHECKER_SKIP_FRAMES 2    // recordEvent() and the interposed function
+
+// The glibc implementations of the allocation functions.  Using these
+// instead of dlsym(RTLD_NEXT, ...) avoids recursing into dlsym, which
+// itself allocates.
+extern "C" {
+void * __libc_malloc(size_t size);
+void __libc_free(void * ptr);
+void * __libc_calloc(size_t num, size_t size);
+void * __libc_realloc(void * ptr, size_t size);
+void * __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace {
+
+// Whether the calling thread is armed, and whether it is currently recording
+// an event.  The latter prevents recursion if backtrace() calls an
+// interposed function.
+__thread bool armed = false;
+__thread bool recording = false;
+
+// A single-producer, single-consumer queue.  Only the servo thread arms.
+RTCheckerEvent queue[RT_CHECKER_QUEUE_SIZE];
+std::atomic<size_t> queueHead(0);  // the next slot to write
+std::atomic<size_t> queueTail(0);  // the next slot to read
+std::atomic<size_t> numDropped(0);
+
+// The next definitions of the interposed system call wrappers.
+ssize_t (*next_read)(int, void *, size_t);
+ssize_t (*next_write)(int, const void *, size_t);
+int (*next_open)(const char *, int, ...);
+int (*next_close)(int);
+int (*next_ioctl)(int, unsigned long, ...);
+int (*next_poll)(struct pollfd *, nfds_t, int);
+int (*next_select)(int, fd_set *, fd_set *, fd_set *, struct timeval *);
+int (*next_nanosleep)(const struct timespec *, struct timespec *);
+int (*next_usleep)(useconds_t);
+int (*next_sched_yield)();
+void * (*next_mmap)(void *, size_t, int, int, int, off_t);
+int (*next_munmap)(void *, size_t);
+ssize_t (*next_send)(int, const void *, size_t, int);
+ssize_t (*next_sendto)(int, const void *, size_t, int, const struct sockaddr *, socklen_t);
+ssize_t (*next_recv)(int, void *, size_t, int);
+ssize_t (*next_recvfrom)(int, void *, size_t, int, struct sockaddr *, socklen_t *);
+
+template<typename T>
+void resolve(T & function, const char * name)
+{
+    function = reinterpret_cast<T>(dlsym(RTLD_NEXT, name));
+}
+
+// Obtains the next definition of an interposed function.  They are normally
+// resolved by initialize() but another library's constructor may call them
+// first.
+#define NEXT(name) (next_##name ? next_##name : (resolve(next_##name, #name), next_##name))
+
+// Resolves the interposed functions and loads the unwinder before any
+// thread is armed, since both allocate.
+__attribute__((constructor))
+void initialize()
+{
+    resolve(next_read, "read");
+    resolve(next_write, "write");
+    resolve(next_open, "open");
+    resolve(next_close, "close");
+    resolve(next_ioctl, "ioctl");
+    resolve(next_poll, "poll");
+    resolve(next_select, "select");
+    resolve(next_nanosleep, "nanosleep");
+    resolve(next_usleep, "usleep");
+    resolve(next_sched_yield, "sched_yield");
+    resolve(next_mmap, "mmap");
+    resolve(next_munmap, "munmap");
+    resolve(next_send, "send");
+    resolve(next_sendto, "sendto");
+    resolve(next_recv, "recv");
+    resolve(next_recvfrom, "recvfrom");
+
+    void * frames[RT_CHECKER_MAX_FRAMES];
+    backtrace(frames, RT_CHECKER_MAX_FRAMES);
+}
+
+// Must not be inlined into the interposed functions, or the backtrace
+// would have one frame fewer than RT_CHECKER_SKIP_FRAMES assumes.
+__attribute__((noinline)) void recordEvent(const char * function, size_t size)
+{
+    if (!armed || recording)
+        return;
+
+    recording = true;
+
+    size_t const head = queueHead.load(std::memory_order_relaxed);
+    if (head - queueTail.load(std::memory_order_acquire) >= RT_CHECKER_QUEUE_SIZE)
+    {
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        RTCheckerEvent & event = queue[head % RT_CHECKER_QUEUE_SIZE];
+        void * frames[RT_CHECKER_MAX_FRAMES + RT_CHECKER_SKIP_FRAMES];
+        int const numFrames = backtrace(frames, RT_CHECKER_MAX_FRAMES + RT_CHECKER_SKIP_FRAMES);
+
+        event.function = function;
+        event.size = size;
+        event.numFrames = numFrames > RT_CHECKER_SKIP_FRAMES ? numFrames - RT_CHECKER_SKIP_FRAMES : 0;
+        memcpy(event.frames, frames + RT_CHECKER_SKIP_FRAMES, event.numFrames * sizeof(void *));
+
+        queueHead.store(head + 1, std::memory_order_release);
+    }
+
+    recording = false;
+}
+
+} // namespace
+
+extern "C" {
+
+//---------------------------------------------------------------------------------
+// The RTChecker API.
+//---------------------------------------------------------------------------------
+
+void controlit_dreamer_rt_checker_arm()
+{
+    armed = true;
+}
+
+void controlit_dreamer_rt_checker_disarm()
+{
+    armed = false;
+}
+
+size_t controlit_dreamer_rt_checker_drain(RTCheckerEvent * events, size_t maxEvents, size_t * dropped)
+{
+    size_t const tail = queueTail.load(std::memory_order_relaxed);
+    size_t const head = queueHead.load(std::memory_order_acquire);
+
+    size_t numEvents = 0;
+    for (; numEvents < maxEvents && tail + numEvents != head; numEvents++)
+        events[numEvents] = queue[(tail + numEvents) % RT_CHECKER_QUEUE_SIZE];
+
+    queueTail.store(tail + numEvents, std::memory_order_release);
+    *dropped = numDropped.exchange(0, std::memory_order_relaxed);
+    return numEvents;
+}
+
+//---------------------------------------------------------------------------------
+// The interposed allocation functions.
+//---------------------------------------------------------------------------------
+
+void * malloc(size_t size)
+{
+    recordEvent("malloc", size);
+    return __libc_malloc(size);
+}
+
+void free(void * ptr)
+{
+    if (ptr) recordEvent("free", 0);
+    __libc_free(ptr);
+}
+
+void * calloc(size_t num, size_t size)
+{
+    recordEvent("calloc", num * size);
+    return __libc_calloc(num, size);
+}
+
+void * realloc(void * ptr, size_t size)
+{
+    recordEvent("realloc", size);
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void ** ptr, size_t alignment, size_t size)
+{
+    recordEvent("posix_memalign", size);
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+
+void * aligned_alloc(size_t alignment, size_t size)
+{
+    recordEvent("aligned_alloc", size);
+    return __libc_memalign(alignment, size);
+}
+
+void * memalign(size_t alignment, size_t size)
+{
+    recordEvent("memalign", size);
+    return __libc_memalign(alignment, size);
+}
+
+//---------------------------------------------------------------------------------
+// The interposed system call wrappers.
+//---------------------------------------------------------------------------------
+
+ssize_t read(int fd, void * buf, size_t count)
+{
+    recordEvent("read", 0);
+    return NEXT(read)(fd, buf, count);
+}
+
+ssize_t write(int fd, const void * buf, size_t count)
+{
+    recordEvent("write", 0);
+    return NEXT(write)(fd, buf, count);
+}
+
+int open(const char * path, int flags, ...)
+{
+    recordEvent("open", 0);
+
+    // The mode is only passed when a file may be created.
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+
+    return NEXT(open)(path, flags, mode);
+}
+
+int close(int fd)
+{
+    recordEvent("close", 0);
+    return NEXT(close)(fd);
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    recordEvent("ioctl", 0);
+
+    va_list args;
+    va_start(args, request);
+    void * arg = va_arg(args, void *);
+    va_end(args);
+
+    return NEXT(ioctl)(fd, request, arg);
+}
+
+int poll(struct pollfd * fds, nfds_t nfds, int timeout)
+{
+    recordEvent("poll", 0);
+    return NEXT(poll)(fds, nfds, timeout);
+}
+
+int select(int nfds, fd_set * readfds, fd_set * writefds, fd_set * exceptfds, struct timeval * timeout)
+{
+    recordEvent("select", 0);
+    return NEXT(select)(nfds, readfds, writefds, exceptfds, timeout);
+}
+
+int nanosleep(const struct timespec * req, struct timespec * rem)
+{
+    recordEvent("nanosleep", 0);
+    return NEXT(nanosleep)(req, rem);
+}
+
+int usleep(useconds_t usec)
+{
+    recordEvent("usleep", 0);
+    return NEXT(usleep)(usec);
+}
+
+int sched_yield()
+{
+    recordEvent("sched_yield", 0);
+    return NEXT(sched_yield)();
+}
+
+void * mmap(void * addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    recordEvent("mmap", length);
+    return NEXT(mmap)(addr, length, prot, flags, fd, offset);
+}
+
+int munmap(void * addr, size_t length)
+{
+    recordEvent("munmap", 0);
+    return NEXT(munmap)(addr, length);
+}
+
+ssize_t send(int fd, const void * buf, size_t len, int flags)
+{
+    recordEvent("send", 0);
+    return NEXT(send)(fd, buf, len, flags);
+}
+
+ssize_t sendto(int fd, const void * buf, size_t len, int flags, const struct sockaddr * addr, socklen_t addrlen)
+{
+    recordEvent("sendto", 0);
+    return NEXT(sendto)(fd, buf, len, flags, addr, addrlen);
+}
+
+ssize_t recv(int fd, void * buf, size_t len, int flags)
+{
+    recordEvent("recv", 0);
+    return NEXT(recv)(fd, buf, len, flags);
+}
+
+ssize_t recvfrom(int fd, void * buf, size_t len, int flags, struct sockaddr * addr, socklen_t * addrlen)
+{
+    recordEvent("recvfrom", 0);
+    return NEXT(recvfrom)(fd, buf, len, flags, addr, addrlen);
+}
+
+} // extern "C"
@@ -1,21 +1,23 @@
 #include <controlit/dreamer/RobotInterfaceDreamer.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <limits>
+#include <thread>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
 #include <controlit/Command.hpp>
 #include <controlit/RTControlModel.hpp>
 #include <controlit/logging/RealTimeLogging.hpp>
 #include <controlit/dreamer/OdometryStateReceiverDreamer.hpp>
+#include <controlit/dreamer/OverrunPolicy.hpp>
 #include <controlit/dreamer/TimerRTAI.hpp>
 
 #include "m3/robots/chain_name.h"
 #include <m3rt/base/m3ec_def.h>
 #include <m3rt/base/m3rt_def.h>
 
-#include <rtai_shm.h>
-
-#define TORQUE_SHM "TSHMM"
-#define TORQUE_CMD_SEM "TSHMC"
-#define TORQUE_STATUS_SEM "TSHMS"
 
 namespace controlit {
 namespace dreamer {
@@ -38,26 +40,91 @@ namespace dreamer {
 
 #define NON_REALTIME_PRIORITY 1
 
-#define DEG_TO_RAD(deg) deg / 180 * 3.14159265359
-#define RAD_TO_DEG(rad) rad / 3.14159265359 * 180
-
-#define NUM_HAND_JOINTS 6
-#define NUM_HEAD_JOINTS 7
+#define DEFAULT_MAX_SEQLOCK_RETRIES 10
+#define DEFAULT_RTT_HISTOGRAM_BUCKET_WIDTH 10e-6  // in seconds
+#define DEFAULT_RTT_HISTOGRAM_NUM_BUCKETS 2000
+#define NUM_RTT_STATS 7
+#define RTT_STATS_PUBLISH_PERIOD 1000 // in servo cycles
+
+#define DEFAULT_SHM_ATTACH_TIMEOUT 30.0        // in seconds
+#define DEFAULT_SHM_ATTACH_MAX_BACKOFF 1.0     // in seconds
+#define SHM_ATTACH_INITIAL_BACKOFF 0.01        // in seconds
+
+#define DEFAULT_HAND_RATE_DIVIDER 4   // 250 Hz at a 1 kHz servo frequency
+#define DEFAULT_HEAD_RATE_DIVIDER 20  // 50 Hz at a 1 kHz servo frequency, the serial link cannot sustain 1 kHz
+#define DEFAULT_HEAD_SLEW_RATE 10.0    // in degrees per second
+#define DEFAULT_AUXILIARY_THREAD_PRIORITY 0       // SCHED_FIFO priority, 0 means use the default scheduler
+#define NANOSECONDS_PER_SECOND 1000000000LL
+#define NUM_SHM_STATS 6
+#define SHM_STATS_PUBLISH_PERIOD 1000 // in servo cycles
+
+// The sequence counters are stored at the end of the shared memory blocks.
+static_assert(sizeof(M3UTATorqueShmSdsStatus) <= MAX_SDS_SIZE_BYTES - SEQLOCK_RESERVED_BYTES,
+    "M3UTATorqueShmSdsStatus overlaps the sequence counter");
+static_assert(sizeof(M3UTATorqueShmSdsCommand) <= MAX_SDS_SIZE_BYTES - SEQLOCK_RESERVED_BYTES,
+    "M3UTATorqueShmSdsCommand overlaps the sequence counter");
 
 RobotInterfaceDreamer::RobotInterfaceDreamer() :
     RobotInterface(),         // Call super-class' constructor
-    sharedMemoryReady(false)
+    sharedMemoryReady(false),
+    sharedMemoryPtr(nullptr),
+    useSeqLock(false),
+    maxSeqLockRetries(DEFAULT_MAX_SEQLOCK_RETRIES),
+    statusReadCount(0),
+    statusRetryCount(0),
+    statusReadFailureCount(0),
+    maxStatusRetries(0),
+    commandWriteCount(0),
+    commandBytesTotal(0),
+    commandDirtyMask(0),
+    fullCommandWritePending(true),
+    continuousRTT(true),
+    lastReflectedSeqno(0),
+    rttUnmatchedCount(0),
+    headBackend(HEAD_BACKEND_SERIAL),
+    headSlewRate(DEFAULT_HEAD_SLEW_RATE),
+    headCommandReceived(false),
+    auxiliaryThreadsRunning(false),
+    handCycle(false),
+    headCycle(false)
 {
+    memset(rttSendTimes, 0, sizeof(rttSendTimes));
+    handRate.divider = DEFAULT_HAND_RATE_DIVIDER;
+    handRate.phase = 0;
+    headRate.divider = DEFAULT_HEAD_RATE_DIVIDER;
+    headRate.phase = 1;
+
+    // Size the statistics messages here rather than in init() so that
+    // read() never indexes past their ends.
+    shmStatsPublisher.msg_.data.resize(NUM_SHM_STATS, 0);
+    rttStatsPublisher.msg_.data.resize(NUM_RTT_STATS, 0);
 }
 
 RobotInterfaceDreamer::~RobotInterfaceDreamer()
 {
+    stopAuxiliaryThreads();
+    flightRecorder.stop();
 }
 
 bool RobotInterfaceDreamer::init(ros::NodeHandle & nh, RTControlModel * model)
 {
     PRINT_INFO_STATEMENT("Method called!");
 
+    //---------------------------------------------------------------------------------
+    // Create the shared memory transport.  This is done before initializing the
+    // parent class since it determines which timer getTimer() returns.
+    //---------------------------------------------------------------------------------
+
+    std::string transportType;
+    nh.param("shm_transport", transportType, std::string("rtai"));
+
+    transport.reset(createSHMTransport(transportType));
+    if (!transport)
+    {
+        CONTROLIT_ERROR << "Invalid shm_transport \"" << transportType << "\", must be \"rtai\", \"posix\", or \"local\".";
+        return false;
+    }
+
     //---------------------------------------------------------------------------------
     // Initialize the parent class.
     //---------------------------------------------------------------------------------
@@ -65,23 +132,166 @@ bool RobotInterfaceDreamer::init(ros::NodeHandle & nh, RTControlModel * model)
     if (!RobotInterface::init(nh, model))
         return false;
 
+    //---------------------------------------------------------------------------------
+    // Initialize the joint map.  This determines where each joint is located
+    // within the shared memory status and command structures.
+    //---------------------------------------------------------------------------------
+
+    memset(&shm_status, 0, sizeof(shm_status));
+    memset(&shm_cmd, 0, sizeof(shm_cmd));
+
+    if (!jointMap.init(nh, shm_status, shm_cmd))
+    {
+        CONTROLIT_ERROR << "Failed to initialize the joint map.";
+        return false;
+    }
+
+    if (!jointMap.checkModel(model))
+        return false;
+
+    jointPositions.setZero(jointMap.getNumStateJoints());
+    jointVelocities.setZero(jointMap.getNumStateJoints());
+    jointEfforts.setZero(jointMap.getNumStateJoints());
+
+    //---------------------------------------------------------------------------------
+    // Determine how to command the head.  This affects which parts of the
+    // command are copied into shared memory.
+    //---------------------------------------------------------------------------------
+
+    std::string headBackendName;
+    nh.param("head_backend", headBackendName, std::string("serial"));
+    nh.param("head_shm_slew_rate", headSlewRate, DEFAULT_HEAD_SLEW_RATE);
+
+    if (headBackendName == "serial")
+        headBackend = HEAD_BACKEND_SERIAL;
+    else if (headBackendName == "shm")
+        headBackend = HEAD_BACKEND_SHM;
+    else
+    {
+        CONTROLIT_ERROR << "Invalid head_backend \"" << headBackendName << "\", must be \"serial\" or \"shm\".";
+        return false;
+    }
+
+    initCopyPlans();
+
+    //---------------------------------------------------------------------------------
+    // Determine how to exchange data with the M3 server.
+    //---------------------------------------------------------------------------------
+
+    std::string exchangeMode;
+    nh.param("shm_exchange_mode", exchangeMode, std::string("semaphore"));
+
+    if (exchangeMode == "seqlock")
+        useSeqLock = true;
+    else if (exchangeMode == "semaphore")
+        useSeqLock = false;
+    else
+    {
+        CONTROLIT_ERROR << "Invalid shm_exchange_mode \"" << exchangeMode << "\", must be \"semaphore\" or \"seqlock\".";
+        return false;
+    }
+
+    int maxRetries;
+    nh.param("shm_seqlock_max_retries", maxRetries, DEFAULT_MAX_SEQLOCK_RETRIES);
+    maxSeqLockRetries = maxRetries < 0 ? 0 : maxRetries;
+
+    shmStatsPublisher.init(nh, "controlit/dreamer/shm_stats", 1);
+    if (shmStatsPublisher.trylock())
+    {
+        shmStatsPublisher.unlockAndPublish();
+    }
+    else
+    {
+        CONTROLIT_ERROR << "Unable to initialize the shared memory statistics publisher!";
+        return false;
+    }
+
+    //---------------------------------------------------------------------------------
+    // Initialize the round trip latency measurement.
+    //---------------------------------------------------------------------------------
+
+    nh.param("rtt_continuous", continuousRTT, true);
+
+    double rttBucketWidth;
+    int rttNumBuckets;
+    nh.param("rtt_histogram_bucket_width", rttBucketWidth, DEFAULT_RTT_HISTOGRAM_BUCKET_WIDTH);
+    nh.param("rtt_histogram_num_buckets", rttNumBuckets, DEFAULT_RTT_HISTOGRAM_NUM_BUCKETS);
+
+    if (rttNumBuckets <= 0 || !rttHistogram.init(rttBucketWidth, rttNumBuckets))
+    {
+        CONTROLIT_ERROR << "Invalid rtt_histogram_bucket_width (" << rttBucketWidth
+                        << ") or rtt_histogram_num_buckets (" << rttNumBuckets << ").";
+        return false;
+    }
+
+    rttClock = getTimer();
+    rttClock->start();
+    seqno = 0;
+
+    rttStatsPublisher.init(nh, "controlit/dreamer/rtt_stats", 1);
+    if (rttStatsPublisher.trylock())
+    {
+        rttStatsPublisher.unlockAndPublish();
+    }
+    else
+    {
+        CONTROLIT_ERROR << "Unable to initialize the round trip latency statistics publisher!";
+        return false;
+    }
+
+    //---------------------------------------------------------------------------------
+    // Initialize the flight recorder.
+    //---------------------------------------------------------------------------------
+
+    double servoFrequency;
+    nh.param("servo_frequency", servoFrequency, 1000.0);
+
+    // Record the same status and command bytes that are exchanged with the
+    // M3 server.
+    std::vector<const M3CopyPlan *> commandRecordPlans;
+    commandRecordPlans.push_back(&commandHeaderCopyPlan);
+    for (int chain = 0; chain < M3_NUM_CHAINS; chain++)
+        commandRecordPlans.push_back(&commandCopyPlans[chain]);
+
+    if (!flightRecorder.init(nh, servoFrequency, statusCopyPlan, commandRecordPlans))
+    {
+        CONTROLIT_ERROR << "Failed to initialize the flight recorder.";
+        return false;
+    }
+
+    //---------------------------------------------------------------------------------
+    // Connect to the shared memory created by the M3 Server.  This is done here
+    // rather than in the servo thread so the real-time loop never makes system
+    // calls and only starts once the shared memory and its locks are valid.
+    //---------------------------------------------------------------------------------
+
+    double attachTimeout, attachMaxBackoff;
+    nh.param("shm_attach_timeout", attachTimeout, DEFAULT_SHM_ATTACH_TIMEOUT);
+    nh.param("shm_attach_max_backoff", attachMaxBackoff, DEFAULT_SHM_ATTACH_MAX_BACKOFF);
+
+    if (!waitForSM(attachTimeout, attachMaxBackoff))
+        return false;
+
     //---------------------------------------------------------------------------------
     // Initialize the hand controller.
     //---------------------------------------------------------------------------------
 
-    handController.init(nh);
-    handCommand.setZero(NUM_HAND_JOINTS);
-    handJointPositions.setZero(NUM_HAND_JOINTS);
-    handJointVelocities.setZero(NUM_HAND_JOINTS);
+    handController.reset(new HandControllerDreamer());
+    handController->init(nh);
+    handCommand.setZero();
+    handJointPositions.setZero();
+    handJointVelocities.setZero();
 
     //---------------------------------------------------------------------------------
     // Initialize the head controller.
     //---------------------------------------------------------------------------------
 
-    headController.init(nh);
-    headCommand.setZero(NUM_HEAD_JOINTS);
-    headJointPositions.setZero(NUM_HEAD_JOINTS);
-    headJointVelocities.setZero(NUM_HEAD_JOINTS);
+    headController.reset(new HeadControllerDreamer());
+    headController->init(nh, headBackend);
+    headCommandReceived = false;
+    headCommand.setZero();
+    headJointPositions.setZero();
+    headJointVelocities.setZero();
 
     //---------------------------------------------------------------------------------
     // Create the odometry receiver.
@@ -89,47 +299,378 @@ bool RobotInterfaceDreamer::init(ros::NodeHandle & nh, RTControlModel * model)
 
     PRINT_INFO_STATEMENT("Creating and initializing the odometry state receiver...");
     odometryStateReceiver.reset(new OdometryStateReceiverDreamer());
-    return odometryStateReceiver->init(nh, model);
+    if (!odometryStateReceiver->init(nh, model))
+        return false;
+
+    //---------------------------------------------------------------------------------
+    // Start the hand and head controller threads.
+    //---------------------------------------------------------------------------------
+
+    return startAuxiliaryThreads(nh, servoFrequency);
 }
 
-// This needs to be called by the RT thread provided by ServoClockDreamer.
-// It is called the first time either read() or write() is called.
+bool RobotInterfaceDreamer::waitForSM(double timeout, double maxBackoff)
+{
+    PRINT_INFO_STATEMENT("Method called!");
+
+    auto const startTime = std::chrono::steady_clock::now();
+    double backoff = SHM_ATTACH_INITIAL_BACKOFF;
+    int numAttempts = 0;
+
+    while (ros::ok())
+    {
+        numAttempts++;
+        if (initSM())
+        {
+            CONTROLIT_INFO << "Attached to shared memory using the " << transport->getName()
+                           << " transport after " << numAttempts << " attempt(s).";
+            return true;
+        }
+
+        double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if (timeout > 0 && elapsed + backoff > timeout)
+        {
+            CONTROLIT_ERROR << "Unable to attach to shared memory after " << numAttempts << " attempt(s) in "
+                            << elapsed << " seconds. Is the M3 Server running?";
+            return false;
+        }
+
+        CONTROLIT_WARN << "Unable to attach to shared memory, retrying in " << backoff << " seconds...";
+        std::this_thread::sleep_for(std::chrono::duration<double>(backoff));
+        backoff = std::min(2 * backoff, maxBackoff);
+    }
+
+    return false;
+}
+
+// This is called by waitForSM() during initialization, before the servo
+// thread starts.
 bool RobotInterfaceDreamer::initSM()
 {
     PRINT_INFO_STATEMENT("Method called!");
 
-    // Get a pointer to the shared memory created by the M3 Server.
-    PRINT_INFO_STATEMENT("Getting point to shared memory...");
-    sharedMemoryPtr = (M3Sds *) rt_shm_alloc(nam2num(TORQUE_SHM), sizeof(M3Sds), USE_VMALLOC);
-    if (!sharedMemoryPtr)
+    // Connect to the shared memory created by the M3 Server and the locks protecting it.
+    PRINT_INFO_STATEMENT("Attaching to shared memory using the " << transport->getName() << " transport...");
+    if (!transport->attach())
+        return false;
+
+    sharedMemoryPtr = transport->getSharedMemory();
+    fullCommandWritePending = true;
+
+    if (useSeqLock)
     {
-        CONTROLIT_ERROR << "Call to rt_shm_alloc failed for shared memory name \"" << TORQUE_SHM << "\"";
+        PRINT_INFO_STATEMENT("Initializing sequence locks...");
+        statusSeqLock.init(reinterpret_cast<unsigned char *>(sharedMemoryPtr->status), MAX_SDS_SIZE_BYTES);
+        commandSeqLock.init(reinterpret_cast<unsigned char *>(sharedMemoryPtr->cmd), MAX_SDS_SIZE_BYTES);
+    }
+
+    PRINT_INFO_STATEMENT("Done initializing connection to shared memory.");
+    sharedMemoryReady = true;  // Prevents this method from being called again.
+
+    return true;
+}
+
+// Sets the SCHED_FIFO priority of a thread.  A priority of zero leaves the
+// thread in the default scheduling class.
+static bool setThreadPriority(std::thread & thread, int priority)
+{
+    if (priority <= 0)
+        return true;
+
+    struct sched_param param;
+    param.sched_priority = priority;
+
+    int result = pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param);
+    if (result != 0)
+    {
+        CONTROLIT_WARN << "Unable to set auxiliary controller thread priority to " << priority
+                       << ": " << strerror(result);
         return false;
     }
 
-    // Get the semaphores protecting the status and command shared memory registers.
-    PRINT_INFO_STATEMENT("Getting shared memory semaphores...");
-    status_sem = (SEM *) rt_get_adr(nam2num(TORQUE_STATUS_SEM));
-    if (!status_sem)
+    return true;
+}
+
+// Restricts a thread to the CPUs in a mask, bit n allowing CPU n.  A mask
+// of zero leaves the thread on all CPUs.
+static bool setThreadAffinity(std::thread & thread, int cpuMask)
+{
+    if (cpuMask == 0)
+        return true;
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu = 0; cpu < static_cast<int>(sizeof(cpuMask) * 8); cpu++)
     {
-      CONTROLIT_ERROR << "Torque status semaphore \"" << TORQUE_STATUS_SEM << "\" not found";
-      return false;
+        if (static_cast<unsigned int>(cpuMask) & (1u << cpu))
+            CPU_SET(cpu, &cpuSet);
     }
 
-    command_sem = (SEM *) rt_get_adr(nam2num(TORQUE_CMD_SEM));
-    if (!command_sem)
+    int result = pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet), &cpuSet);
+    if (result != 0)
     {
-      CONTROLIT_ERROR << "Torque command semaphore \"" << TORQUE_CMD_SEM << "\" not found";
-      return false;
+        CONTROLIT_WARN << "Unable to set auxiliary controller thread CPU mask to 0x" << std::hex << cpuMask
+                       << std::dec << ": " << strerror(result);
+        return false;
     }
 
-    PRINT_INFO_STATEMENT("Done initializing connection to shared memory.");
-    sharedMemoryReady = true;  // Prevents this method from being called again.
+    return true;
+}
+
+bool RobotInterfaceDreamer::startAuxiliaryThreads(ros::NodeHandle & nh, double servoFrequency)
+{
+    int handDivider, headDivider;
+    int priority, cpuMask;
+    nh.param("hand_rate_divider", handDivider, DEFAULT_HAND_RATE_DIVIDER);
+    nh.param("head_rate_divider", headDivider, DEFAULT_HEAD_RATE_DIVIDER);
+    nh.param("auxiliary_thread_priority", priority, DEFAULT_AUXILIARY_THREAD_PRIORITY);
+    nh.param("auxiliary_thread_cpu_mask", cpuMask, 0);
+
+    if (handDivider <= 0 || headDivider <= 0 || servoFrequency <= 0)
+    {
+        CONTROLIT_ERROR << "Invalid hand_rate_divider (" << handDivider << "), head_rate_divider ("
+                        << headDivider << "), or servo_frequency (" << servoFrequency << ").";
+        return false;
+    }
+
+    // The hand exchanges data in cycles congruent to 0 modulo handDivider and
+    // the head in cycles congruent to 1 modulo headDivider.  These never
+    // coincide as long as the dividers have a common factor, i.e., their
+    // greatest common divisor is greater than one.
+    handRate.divider = handDivider;
+    handRate.phase = 0;
+    headRate.divider = headDivider;
+    headRate.phase = headDivider > 1 ? 1 : 0;
+
+    unsigned int gcd = handRate.divider, remainder = headRate.divider;
+    while (remainder != 0)
+    {
+        unsigned int const next = gcd % remainder;
+        gcd = remainder;
+        remainder = next;
+    }
 
+    if (gcd == 1)
+    {
+        CONTROLIT_WARN << "hand_rate_divider (" << handDivider << ") and head_rate_divider (" << headDivider
+                       << ") have no common factor, so the hand and head will sometimes share a cycle.";
+    }
+
+    double const handFrequency = servoFrequency / handDivider;
+    double const headFrequency = servoFrequency / headDivider;
+
+    // The threads share a start time and are offset from it by their phases
+    // so that they do not wake at the same time either.
+    long long const servoPeriodNs = static_cast<long long>(NANOSECONDS_PER_SECOND / servoFrequency);
+    struct timespec startTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+    initMailboxes();
+
+    auxiliaryThreadsRunning = true;
+    handThread = std::thread(&RobotInterfaceDreamer::handThreadLoop, this, startTime,
+        handRate.phase * servoPeriodNs, handRate.divider * servoPeriodNs);
+    headThread = std::thread(&RobotInterfaceDreamer::headThreadLoop, this, startTime,
+        headRate.phase * servoPeriodNs, headRate.divider * servoPeriodNs);
 
+    setThreadPriority(handThread, priority);
+    setThreadPriority(headThread, priority);
+    setThreadAffinity(handThread, cpuMask);
+    setThreadAffinity(headThread, cpuMask);
+
+    CONTROLIT_INFO << "Running the hand controller at " << handFrequency << "Hz and the head controller at "
+                   << headFrequency << "Hz.";
     return true;
 }
 
+void RobotInterfaceDreamer::initMailboxes()
+{
+    AuxiliaryJointState<NUM_HAND_JOINTS> initialHandState = {};
+    AuxiliaryJointCommand<NUM_HAND_JOINTS> initialHandCommand = {};
+    AuxiliaryJointState<NUM_HEAD_JOINTS> initialHeadState = {};
+    AuxiliaryJointCommand<NUM_HEAD_JOINTS> initialHeadCommand = {};
+
+    handStateMailbox.init(initialHandState);
+    handCommandMailbox.init(initialHandCommand);
+    headStateMailbox.init(initialHeadState);
+    headCommandMailbox.init(initialHeadCommand);
+
+    handStateSample = initialHandState;
+    handCommandSample = initialHandCommand;
+    headStateSample = initialHeadState;
+    headCommandSample = initialHeadCommand;
+}
+
+void RobotInterfaceDreamer::stopAuxiliaryThreads()
+{
+    auxiliaryThreadsRunning = false;
+
+    if (handThread.joinable()) handThread.join();
+    if (headThread.joinable()) headThread.join();
+}
+
+// Returns a time in nanoseconds.
+static inline long long toNanoseconds(const struct timespec & time)
+{
+    return time.tv_sec * NANOSECONDS_PER_SECOND + time.tv_nsec;
+}
+
+// Advances a time by a number of nanoseconds.
+static inline void addNanoseconds(struct timespec & time, long long ns)
+{
+    long long const sum = time.tv_nsec + ns;
+    time.tv_sec += sum / NANOSECONDS_PER_SECOND;
+    time.tv_nsec = sum % NANOSECONDS_PER_SECOND;
+}
+
+// Sleeps until the next wake time of an auxiliary thread and advances it by
+// one period.  Periods that already passed are skipped so that a thread that
+// falls behind does not run back to back to catch up.
+static void waitForNextPeriod(struct timespec & nextWakeTime, long long periodNs)
+{
+    // clock_nanosleep returns the error number instead of setting errno.
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextWakeTime, nullptr) == EINTR) {}
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    long long const lateness = toNanoseconds(now) - toNanoseconds(nextWakeTime);
+    addNanoseconds(nextWakeTime, (lateness / periodNs + 1) * periodNs);
+}
+
+void RobotInterfaceDreamer::handThreadLoop(struct timespec startTime, long long offsetNs, long long periodNs)
+{
+    AuxiliaryJointState<NUM_HAND_JOINTS> state;
+    AuxiliaryJointCommand<NUM_HAND_JOINTS> command;
+
+    struct timespec nextWakeTime = startTime;
+    addNanoseconds(nextWakeTime, offsetNs);
+
+    while (auxiliaryThreadsRunning)
+    {
+        waitForNextPeriod(nextWakeTime, periodNs);
+
+        if (handStateMailbox.read(state))
+        {
+            for (size_t ii = 0; ii < NUM_HAND_JOINTS; ii++)
+            {
+                handJointPositions[ii] = state.position[ii];
+                handJointVelocities[ii] = state.velocity[ii];
+            }
+
+            handController->updateState(handJointPositions, handJointVelocities);
+        }
+
+        handController->getCommand(handCommand);
+
+        for (size_t ii = 0; ii < NUM_HAND_JOINTS; ii++)
+            command.command[ii] = handCommand[ii];
+
+        handCommandMailbox.write(command);
+    }
+}
+
+void RobotInterfaceDreamer::headThreadLoop(struct timespec startTime, long long offsetNs, long long periodNs)
+{
+    AuxiliaryJointState<NUM_HEAD_JOINTS> state;
+
+    struct timespec nextWakeTime = startTime;
+    addNanoseconds(nextWakeTime, offsetNs);
+
+    while (auxiliaryThreadsRunning)
+    {
+        waitForNextPeriod(nextWakeTime, periodNs);
+
+        if (headStateMailbox.read(state))
+        {
+            for (size_t ii = 0; ii < NUM_HEAD_JOINTS; ii++)
+            {
+                headJointPositions[ii] = state.position[ii];
+                headJointVelocities[ii] = state.velocity[ii];
+            }
+
+            headController->updateState(headJointPositions, headJointVelocities);
+        }
+
+        // With the serial backend, this transmits the command to the head.
+        headController->getCommand(headCommand);
+
+        // With the shared memory backend, the servo thread sends it.
+        if (headBackend == HEAD_BACKEND_SHM && headController->hasState())
+        {
+            AuxiliaryJointCommand<NUM_HEAD_JOINTS> command;
+            for (size_t ii = 0; ii < NUM_HEAD_JOINTS; ii++)
+                command.command[ii] = headCommand[ii];
+            headCommandMailbox.write(command);
+        }
+    }
+}
+
+void RobotInterfaceDreamer::initCopyPlans()
+{
+    // The status header, the joints in the joint map, and the hand and head joints.
+    statusCopyPlan.clear();
+    statusCopyPlan.addRegion(&shm_status, &shm_status.timestamp, sizeof(shm_status.timestamp));
+    statusCopyPlan.addRegion(&shm_status, &shm_status.seqno, sizeof(shm_status.seqno));
+
+    jointMap.addStateRegions(statusCopyPlan, shm_status);
+
+    for (size_t ii = 0; ii < NUM_HAND_JOINTS; ii++)
+    {
+        DreamerJoint const & joint = DREAMER_HAND_JOINTS[ii];
+        M3TorqueShmSdsBaseStatus & limb = m3LimbStatus(shm_status, joint.chain);
+        statusCopyPlan.addRegion(&shm_status, &limb.theta[joint.slot], sizeof(mReal));
+        statusCopyPlan.addRegion(&shm_status, &limb.thetadot[joint.slot], sizeof(mReal));
+    }
+
+    for (size_t ii = 0; ii < NUM_HEAD_JOINTS; ii++)
+    {
+        DreamerJoint const & joint = DREAMER_HEAD_JOINTS[ii];
+        M3TorqueShmSdsBaseStatus & limb = m3LimbStatus(shm_status, joint.chain);
+        statusCopyPlan.addRegion(&shm_status, &limb.theta[joint.slot], sizeof(mReal));
+        statusCopyPlan.addRegion(&shm_status, &limb.thetadot[joint.slot], sizeof(mReal));
+    }
+
+    statusCopyPlan.finalize();
+
+    // The command header is written every cycle.
+    commandHeaderCopyPlan.clear();
+    commandHeaderCopyPlan.addRegion(&shm_cmd, &shm_cmd.timestamp, sizeof(shm_cmd.timestamp));
+    commandHeaderCopyPlan.addRegion(&shm_cmd, &shm_cmd.seqno, sizeof(shm_cmd.seqno));
+    commandHeaderCopyPlan.finalize();
+
+    // The per-chain commands are written only when they change.
+    for (int chain = 0; chain < M3_NUM_CHAINS; chain++)
+    {
+        commandCopyPlans[chain].clear();
+        jointMap.addCommandRegions(commandCopyPlans[chain], shm_cmd, static_cast<m3_chain_t>(chain));
+    }
+
+    for (size_t ii = 0; ii < NUM_HAND_JOINTS; ii++)
+    {
+        DreamerJoint const & joint = DREAMER_HAND_JOINTS[ii];
+        M3TorqueShmSdsBaseCommand & limb = m3LimbCommand(shm_cmd, joint.chain);
+        commandCopyPlans[joint.chain].addRegion(&shm_cmd, &limb.tq_desired[joint.slot], sizeof(mReal));
+    }
+
+    if (headBackend == HEAD_BACKEND_SHM)
+    {
+        for (size_t ii = 0; ii < NUM_HEAD_JOINTS; ii++)
+        {
+            DreamerJoint const & joint = DREAMER_HEAD_JOINTS[ii];
+            M3TorqueShmSdsBaseCommand & limb = m3LimbCommand(shm_cmd, joint.chain);
+            commandCopyPlans[joint.chain].addRegion(&shm_cmd, &limb.q_desired[joint.slot], sizeof(mReal));
+            commandCopyPlans[joint.chain].addRegion(&shm_cmd, &limb.slew_rate_q_desired[joint.slot], sizeof(mReal));
+        }
+    }
+
+    for (int chain = 0; chain < M3_NUM_CHAINS; chain++)
+        commandCopyPlans[chain].finalize();
+
+    CONTROLIT_INFO << "Copying " << statusCopyPlan.getNumBytes() << " of " << sizeof(shm_status)
+                   << " status bytes in " << statusCopyPlan.getNumRegions() << " regions per cycle.";
+}
+
 void RobotInterfaceDreamer::printLimbSHMStatus(std::stringstream & ss, std::string prefix,
     M3TorqueShmSdsBaseStatus & shmLimbStatus)
 {
@@ -267,17 +808,9 @@ void RobotInterfaceDreamer::printSHMCommand()
 
 bool RobotInterfaceDreamer::read(controlit::RobotState & latestRobotState, bool block)
 {
-    //---------------------------------------------------------------------------------
-    // If necessary, establish the connection to shared memory.
-    //---------------------------------------------------------------------------------
-
+    // The connection to shared memory is established by init().
     if (!sharedMemoryReady)
-    {
-        if (!initSM())
-        {
-             return false;
-        }
-    }
+        return false;
 
     //---------------------------------------------------------------------------------
     // Reset the timestamp within robot state to remember when the state was obtained.
@@ -290,188 +823,53 @@ bool RobotInterfaceDreamer::read(controlit::RobotState & latestRobotState, bool
     // The information is saved into member variable shm_status.
     //---------------------------------------------------------------------------------
 
-    PRINT_INFO_STATEMENT("Grabbing lock on status semaphore...");
-    rt_sem_wait(status_sem);
-    memcpy(&shm_status, sharedMemoryPtr->status, sizeof(shm_status));
-    rt_sem_signal(status_sem);
-    PRINT_INFO_STATEMENT("Releasing lock on status semaphore...");
+    if (!readSHMStatus())
+        return false;
+
+    // When the servo clock's overrun policy reports low slack, the non-critical
+    // work below is skipped for this cycle.
+    bool const slackLow = OverrunPolicy::isSlackLow();
 
     //---------------------------------------------------------------------------------
-    // If the reflected sequence number is equal to the current sequence number,
-    // compute the round trip communication latency and publish it.
+    // If continuously measuring the round trip latency, record the latency of the
+    // sequence number reflected by the M3 server.  Otherwise, if the reflected
+    // sequence number is equal to the current sequence number, compute the round
+    // trip communication latency and publish it.
     //---------------------------------------------------------------------------------
-    if (seqno == shm_status.seqno)
+    if (!slackLow)
     {
-        double latency = rttTimer->getTime();
-        publishCommLatency(latency);
+        if (continuousRTT)
+        {
+            recordRTT();
+            publishRTTStats();
+        }
+        else if (seqno == shm_status.seqno)
+        {
+            double latency = rttTimer->getTime();
+            publishCommLatency(latency);
+        }
     }
 
     // Temporary code to print everything received
     // printSHMStatus();
 
     //---------------------------------------------------------------------------------
-    // Save the joint position data.
-    //---------------------------------------------------------------------------------
-
-    // // latestRobotState.setJointPosition(0, DEG_TO_RAD(shm_status.torso.theta[0])); // torso pan
-    // // latestRobotState.setJointPosition(0, 0); // torso pan, fixed to zero since joint is not working as of 2014/10/16
-    // latestRobotState.setJointPosition(0, DEG_TO_RAD(shm_status.torso.theta[1])); // torso_lower_pitch
-    // latestRobotState.setJointPosition(1, DEG_TO_RAD(shm_status.torso.theta[2])); // torso_upper_pitch
-
-    // latestRobotState.setJointPosition(2, DEG_TO_RAD(shm_status.left_arm.theta[0])); // left arm
-    // latestRobotState.setJointPosition(3, DEG_TO_RAD(shm_status.left_arm.theta[1]));
-    // latestRobotState.setJointPosition(4, DEG_TO_RAD(shm_status.left_arm.theta[2]));
-    // latestRobotState.setJointPosition(5, DEG_TO_RAD(shm_status.left_arm.theta[3]));
-    // latestRobotState.setJointPosition(6, DEG_TO_RAD(shm_status.left_arm.theta[4]));
-    // latestRobotState.setJointPosition(7, DEG_TO_RAD(shm_status.left_arm.theta[5]));
-    // latestRobotState.setJointPosition(8, DEG_TO_RAD(shm_status.left_arm.theta[6]));
-
-    // latestRobotState.setJointPosition(9, DEG_TO_RAD(shm_status.head.theta[0])); // neck
-    // latestRobotState.setJointPosition(10, DEG_TO_RAD(shm_status.head.theta[1]));
-    // latestRobotState.setJointPosition(11, DEG_TO_RAD(shm_status.head.theta[2]));
-    // latestRobotState.setJointPosition(12, DEG_TO_RAD(shm_status.head.theta[3]));
-
-    // latestRobotState.setJointPosition(13, DEG_TO_RAD(shm_status.right_arm.theta[0])); // right arm
-    // latestRobotState.setJointPosition(14, DEG_TO_RAD(shm_status.right_arm.theta[1]));
-    // latestRobotState.setJointPosition(15, DEG_TO_RAD(shm_status.right_arm.theta[2]));
-    // latestRobotState.setJointPosition(16, DEG_TO_RAD(shm_status.right_arm.theta[3]));
-    // latestRobotState.setJointPosition(17, DEG_TO_RAD(shm_status.right_arm.theta[4]));
-    // latestRobotState.setJointPosition(18, DEG_TO_RAD(shm_status.right_arm.theta[5]));
-    // latestRobotState.setJointPosition(19, DEG_TO_RAD(shm_status.right_arm.theta[6]));
-
-    // Only control the left arm, right arm, and torso pitch joints
-    latestRobotState.setJointPosition(0, DEG_TO_RAD(shm_status.torso.theta[1])); // torso_lower_pitch
-    latestRobotState.setJointPosition(1, DEG_TO_RAD(shm_status.torso.theta[2])); // torso_upper_pitch
-    latestRobotState.setJointPosition(2, DEG_TO_RAD(shm_status.left_arm.theta[0]));
-    latestRobotState.setJointPosition(3, DEG_TO_RAD(shm_status.left_arm.theta[1]));
-    latestRobotState.setJointPosition(4, DEG_TO_RAD(shm_status.left_arm.theta[2]));
-    latestRobotState.setJointPosition(5, DEG_TO_RAD(shm_status.left_arm.theta[3]));
-    latestRobotState.setJointPosition(6, DEG_TO_RAD(shm_status.left_arm.theta[4]));
-    latestRobotState.setJointPosition(7, DEG_TO_RAD(shm_status.left_arm.theta[5]));
-    latestRobotState.setJointPosition(8, -1 * DEG_TO_RAD(shm_status.left_arm.theta[6]));
-    latestRobotState.setJointPosition(9, DEG_TO_RAD(shm_status.right_arm.theta[0]));
-    latestRobotState.setJointPosition(10, DEG_TO_RAD(shm_status.right_arm.theta[1]));
-    latestRobotState.setJointPosition(11, DEG_TO_RAD(shm_status.right_arm.theta[2]));
-    latestRobotState.setJointPosition(12, DEG_TO_RAD(shm_status.right_arm.theta[3]));
-    latestRobotState.setJointPosition(13, DEG_TO_RAD(shm_status.right_arm.theta[4]));
-    latestRobotState.setJointPosition(14, DEG_TO_RAD(shm_status.right_arm.theta[5]));
-    latestRobotState.setJointPosition(15, DEG_TO_RAD(shm_status.right_arm.theta[6]));
-
-    //---------------------------------------------------------------------------------
-    // Save the joint velocity data.
-    //---------------------------------------------------------------------------------
-
-    // // latestRobotState.setJointVelocity(0, DEG_TO_RAD(shm_status.torso.thetadot[0])); // torso pan
-    // // latestRobotState.setJointVelocity(0, 0); // torso pan, fixed to zero since joint is not working as of 2014/10/16
-    // latestRobotState.setJointVelocity(0, DEG_TO_RAD(shm_status.torso.thetadot[1])); // torso_pitch_1
-    // latestRobotState.setJointVelocity(1, DEG_TO_RAD(shm_status.torso.thetadot[2])); // torso_pitch_2
-
-    // latestRobotState.setJointVelocity(2, DEG_TO_RAD(shm_status.left_arm.thetadot[0])); // left arm
-    // latestRobotState.setJointVelocity(3, DEG_TO_RAD(shm_status.left_arm.thetadot[1]));
-    // latestRobotState.setJointVelocity(4, DEG_TO_RAD(shm_status.left_arm.thetadot[2]));
-    // latestRobotState.setJointVelocity(5, DEG_TO_RAD(shm_status.left_arm.thetadot[3]));
-    // latestRobotState.setJointVelocity(6, DEG_TO_RAD(shm_status.left_arm.thetadot[4]));
-    // latestRobotState.setJointVelocity(7, DEG_TO_RAD(shm_status.left_arm.thetadot[5]));
-    // latestRobotState.setJointVelocity(8, DEG_TO_RAD(shm_status.left_arm.thetadot[6]));
-
-    // latestRobotState.setJointVelocity(9, DEG_TO_RAD(shm_status.head.thetadot[0])); // neck
-    // latestRobotState.setJointVelocity(10, DEG_TO_RAD(shm_status.head.thetadot[1]));
-    // latestRobotState.setJointVelocity(11, DEG_TO_RAD(shm_status.head.thetadot[2]));
-    // latestRobotState.setJointVelocity(12, DEG_TO_RAD(shm_status.head.thetadot[3]));
-
-    // latestRobotState.setJointVelocity(13, DEG_TO_RAD(shm_status.right_arm.thetadot[0])); // right arm
-    // latestRobotState.setJointVelocity(14, DEG_TO_RAD(shm_status.right_arm.thetadot[1]));
-    // latestRobotState.setJointVelocity(15, DEG_TO_RAD(shm_status.right_arm.thetadot[2]));
-    // latestRobotState.setJointVelocity(16, DEG_TO_RAD(shm_status.right_arm.thetadot[3]));
-    // latestRobotState.setJointVelocity(17, DEG_TO_RAD(shm_status.right_arm.thetadot[4]));
-    // latestRobotState.setJointVelocity(18, DEG_TO_RAD(shm_status.right_arm.thetadot[5]));
-    // latestRobotState.setJointVelocity(19, DEG_TO_RAD(shm_status.right_arm.thetadot[6]));
-
-    // Only control the left arm, right arm, and torso pitch joints
-    latestRobotState.setJointVelocity(0, DEG_TO_RAD(shm_status.torso.thetadot[1])); // torso_lower_pitch
-    latestRobotState.setJointVelocity(1, DEG_TO_RAD(shm_status.torso.thetadot[2])); // torso_upper_pitch
-    latestRobotState.setJointVelocity(2, DEG_TO_RAD(shm_status.left_arm.thetadot[0]));
-    latestRobotState.setJointVelocity(3, DEG_TO_RAD(shm_status.left_arm.thetadot[1]));
-    latestRobotState.setJointVelocity(4, DEG_TO_RAD(shm_status.left_arm.thetadot[2]));
-    latestRobotState.setJointVelocity(5, DEG_TO_RAD(shm_status.left_arm.thetadot[3]));
-    latestRobotState.setJointVelocity(6, DEG_TO_RAD(shm_status.left_arm.thetadot[4]));
-    latestRobotState.setJointVelocity(7, DEG_TO_RAD(shm_status.left_arm.thetadot[5]));
-    latestRobotState.setJointVelocity(8, -1 * DEG_TO_RAD(shm_status.left_arm.thetadot[6]));
-    latestRobotState.setJointVelocity(9, DEG_TO_RAD(shm_status.right_arm.thetadot[0]));
-    latestRobotState.setJointVelocity(10, DEG_TO_RAD(shm_status.right_arm.thetadot[1]));
-    latestRobotState.setJointVelocity(11, DEG_TO_RAD(shm_status.right_arm.thetadot[2]));
-    latestRobotState.setJointVelocity(12, DEG_TO_RAD(shm_status.right_arm.thetadot[3]));
-    latestRobotState.setJointVelocity(13, DEG_TO_RAD(shm_status.right_arm.thetadot[4]));
-    latestRobotState.setJointVelocity(14, DEG_TO_RAD(shm_status.right_arm.thetadot[5]));
-    latestRobotState.setJointVelocity(15, DEG_TO_RAD(shm_status.right_arm.thetadot[6]));
-
-    //---------------------------------------------------------------------------------
-    // Save the joint effort data.
-    //---------------------------------------------------------------------------------
-
-    // // latestRobotState.setJointEffort(0, 1.0e-3 * shm_status.torso.torque[0]); // torso pan
-    // // latestRobotState.setJointEffort(0, 0); // torso pan, fixed to zero since joint is not working as of 2014/10/16
-    // latestRobotState.setJointEffort(0, 1.0e-3 * shm_status.torso.torque[1]); // torso_pitch_1
-    // latestRobotState.setJointEffort(1, 1.0e-3 * shm_status.torso.torque[2]); // torso_pitch_2
-
-    // latestRobotState.setJointEffort(2, 1.0e-3 * shm_status.left_arm.torque[0]); // left arm
-    // latestRobotState.setJointEffort(3, 1.0e-3 * shm_status.left_arm.torque[1]);
-    // latestRobotState.setJointEffort(4, 1.0e-3 * shm_status.left_arm.torque[2]);
-    // latestRobotState.setJointEffort(5, 1.0e-3 * shm_status.left_arm.torque[3]);
-    // latestRobotState.setJointEffort(6, 1.0e-3 * shm_status.left_arm.torque[4]);
-    // latestRobotState.setJointEffort(7, 1.0e-3 * shm_status.left_arm.torque[5]);
-    // latestRobotState.setJointEffort(8, 1.0e-3 * shm_status.left_arm.torque[6]);
-
-    // latestRobotState.setJointEffort(9, 1.0e-3 * shm_status.head.torque[0]); // neck
-    // latestRobotState.setJointEffort(10, 1.0e-3 * shm_status.head.torque[1]);
-    // latestRobotState.setJointEffort(11, 1.0e-3 * shm_status.head.torque[2]);
-    // latestRobotState.setJointEffort(12, 1.0e-3 * shm_status.head.torque[3]);
-
-    // latestRobotState.setJointEffort(13, 1.0e-3 * shm_status.right_arm.torque[0]); // right arm
-    // latestRobotState.setJointEffort(14, 1.0e-3 * shm_status.right_arm.torque[1]);
-    // latestRobotState.setJointEffort(15, 1.0e-3 * shm_status.right_arm.torque[2]);
-    // latestRobotState.setJointEffort(16, 1.0e-3 * shm_status.right_arm.torque[3]);
-    // latestRobotState.setJointEffort(17, 1.0e-3 * shm_status.right_arm.torque[4]);
-    // latestRobotState.setJointEffort(18, 1.0e-3 * shm_status.right_arm.torque[5]);
-    // latestRobotState.setJointEffort(19, 1.0e-3 * shm_status.right_arm.torque[6]);
-
-    // Only control the left arm, right arm, and torso pitch joints
-    latestRobotState.setJointEffort(0, 1.0e-3 * shm_status.torso.torque[1]); // torso_lower_pitch
-    latestRobotState.setJointEffort(1, 1.0e-3 * shm_status.torso.torque[2]); // torso_upper_pitch
-    latestRobotState.setJointEffort(2, 1.0e-3 * shm_status.left_arm.torque[0]);
-    latestRobotState.setJointEffort(3, 1.0e-3 * shm_status.left_arm.torque[1]);
-    latestRobotState.setJointEffort(4, 1.0e-3 * shm_status.left_arm.torque[2]);
-    latestRobotState.setJointEffort(5, 1.0e-3 * shm_status.left_arm.torque[3]);
-    latestRobotState.setJointEffort(6, 1.0e-3 * shm_status.left_arm.torque[4]);
-    latestRobotState.setJointEffort(7, 1.0e-3 * shm_status.left_arm.torque[5]);
-    latestRobotState.setJointEffort(8, -1.0e-3 * shm_status.left_arm.torque[6]);
-    latestRobotState.setJointEffort(9, 1.0e-3 * shm_status.right_arm.torque[0]);
-    latestRobotState.setJointEffort(10, 1.0e-3 * shm_status.right_arm.torque[1]);
-    latestRobotState.setJointEffort(11, 1.0e-3 * shm_status.right_arm.torque[2]);
-    latestRobotState.setJointEffort(12, 1.0e-3 * shm_status.right_arm.torque[3]);
-    latestRobotState.setJointEffort(13, 1.0e-3 * shm_status.right_arm.torque[4]);
-    latestRobotState.setJointEffort(14, 1.0e-3 * shm_status.right_arm.torque[5]);
-    latestRobotState.setJointEffort(15, 1.0e-3 * shm_status.right_arm.torque[6]);
-
-    // Get the latest hand state and update the hand controller
-    for (size_t ii = 0; ii < NUM_HAND_JOINTS - 1; ii++)
-    {
-        handJointPositions[ii] = DEG_TO_RAD(shm_status.right_hand.theta[ii]);
-        handJointVelocities[ii] = DEG_TO_RAD(shm_status.right_hand.thetadot[ii]);
-    }
-    handJointPositions[5] = DEG_TO_RAD(shm_status.left_hand.theta[0]);
-    handJointVelocities[5] = DEG_TO_RAD(shm_status.left_hand.thetadot[0]);
-
-    handController.updateState(handJointPositions, handJointVelocities);
-
-    // Get the latest head joint state and update the head controller.
-    for (size_t ii = 0; ii < NUM_HEAD_JOINTS; ii++)
-    {
-        headJointPositions[ii] = DEG_TO_RAD(shm_status.head.theta[ii]);
-        headJointVelocities[ii] = DEG_TO_RAD(shm_status.head.thetadot[ii]);
-    }
+    // Save the joint position, velocity, and effort data.  The joint map
+    // performs the unit conversions and reorders the joints into ControlIt!
+    // joint order.
+    //---------------------------------------------------------------------------------
 
-    headController.updateState(headJointPositions, headJointVelocities);
+    readJointState(latestRobotState);
+
+    // Pass the latest hand and head states to their controller threads.  Each
+    // runs at its own fraction of the servo frequency.
+    handCycle = !slackLow && handRate.isDue(statusReadCount);
+    if (handCycle)
+        publishHandState();
+
+    headCycle = !slackLow && headRate.isDue(statusReadCount);
+    if (headCycle)
+        publishHeadState();
 
     //---------------------------------------------------------------------------------
     // Get and save the latest odometry data.
@@ -488,20 +886,37 @@ bool RobotInterfaceDreamer::read(controlit::RobotState & latestRobotState, bool
     return controlit::RobotInterface::read(latestRobotState, block);
 }
 
-bool RobotInterfaceDreamer::write(const controlit::Command & command)
+void RobotInterfaceDreamer::readJointState(controlit::RobotState & latestRobotState)
 {
-    //---------------------------------------------------------------------------------
-    // If necessary, establish the connection to shared memory.
-    //---------------------------------------------------------------------------------
+    jointMap.gather(jointPositions, jointVelocities, jointEfforts);
 
-    if (!sharedMemoryReady)
+    for (size_t ii = 0; ii < jointMap.getNumStateJoints(); ii++)
     {
-        if (!initSM())
-        {
-            CONTROLIT_INFO << "Shared memory failed to initialize. Aborting write.";
-            return false;
-        }
+        latestRobotState.setJointPosition(ii, jointPositions[ii]);
+        latestRobotState.setJointVelocity(ii, jointVelocities[ii]);
+        latestRobotState.setJointEffort(ii, jointEfforts[ii]);
     }
+}
+
+void RobotInterfaceDreamer::publishHandState()
+{
+    m3GatherJoints<DreamerHandJoints>(shm_status, handStateSample.position, handStateSample.velocity);
+
+    handStateMailbox.write(handStateSample);
+}
+
+void RobotInterfaceDreamer::publishHeadState()
+{
+    m3GatherJoints<DreamerHeadJoints>(shm_status, headStateSample.position, headStateSample.velocity);
+
+    headStateMailbox.write(headStateSample);
+}
+
+bool RobotInterfaceDreamer::write(const controlit::Command & command)
+{
+    // The connection to shared memory is established by init().
+    if (!sharedMemoryReady)
+        return false;
 
     const Vector & cmd = command.getEffortCmd();
 
@@ -509,64 +924,20 @@ bool RobotInterfaceDreamer::write(const controlit::Command & command)
     // Save the effort command into the outgoing message.
     //---------------------------------------------------------------------------------
 
-    // // shm_cmd.torso.tq_desired[0] = 1e3 * cmd[0]; // torso pan
-    // shm_cmd.torso.tq_desired[0] = 0; // torso_yaw, fixed to zero since joint is not working as of 2014/10/16
-    // shm_cmd.torso.tq_desired[1] = 1e3 * cmd[0]; // torso_pitch_1
-    // //shm_cmd.torso.tq_desired[2] = 1e3 * cmd[1]; // torso_pitch_2
-
-    // shm_cmd.left_arm.tq_desired[0] = 1e3 * cmd[1]; // left arm
-    // shm_cmd.left_arm.tq_desired[1] = 1e3 * cmd[2];
-    // shm_cmd.left_arm.tq_desired[2] = 1e3 * cmd[3];
-    // shm_cmd.left_arm.tq_desired[3] = 1e3 * cmd[4];
-    // shm_cmd.left_arm.tq_desired[4] = 1e3 * cmd[5];
-    // shm_cmd.left_arm.tq_desired[5] = 1e3 * cmd[6];
-    // shm_cmd.left_arm.tq_desired[6] = 1e3 * cmd[7];
-
-    // shm_cmd.head.tq_desired[0] = 1e3 * cmd[8]; // neck
-    // shm_cmd.head.tq_desired[1] = 1e3 * cmd[9];
-    // shm_cmd.head.tq_desired[2] = 1e3 * cmd[10];
-    // shm_cmd.head.tq_desired[3] = 1e3 * cmd[11];
-
-    // shm_cmd.right_arm.tq_desired[0] = 1e3 * cmd[12]; // right arm
-    // shm_cmd.right_arm.tq_desired[1] = 1e3 * cmd[13];
-    // shm_cmd.right_arm.tq_desired[2] = 1e3 * cmd[14];
-    // shm_cmd.right_arm.tq_desired[3] = 1e3 * cmd[15];
-    // shm_cmd.right_arm.tq_desired[4] = 1e3 * cmd[16];
-    // shm_cmd.right_arm.tq_desired[5] = 1e3 * cmd[17];
-    // shm_cmd.right_arm.tq_desired[6] = 1e3 * cmd[18];
-
-    // Only control the left arm, right arm, and torso pitch joints
-    shm_cmd.torso.tq_desired[0]     = 0;
-    shm_cmd.torso.tq_desired[1]     = 1e3 * cmd[0]; // torso_pitch_1
-    shm_cmd.torso.tq_desired[2]     = 0;            // torso_pitch_2  (slave of torso_pitch_1)
-    shm_cmd.left_arm.tq_desired[0]  = 1e3 * cmd[1];
-    shm_cmd.left_arm.tq_desired[1]  = 1e3 * cmd[2];
-    shm_cmd.left_arm.tq_desired[2]  = 1e3 * cmd[3];
-    shm_cmd.left_arm.tq_desired[3]  = 1e3 * cmd[4];
-    shm_cmd.left_arm.tq_desired[4]  = 1e3 * cmd[5];
-    shm_cmd.left_arm.tq_desired[5]  = 1e3 * cmd[6];
-    shm_cmd.left_arm.tq_desired[6]  = -1e3 * cmd[7];
-    shm_cmd.right_arm.tq_desired[0] = 1e3 * cmd[8];
-    shm_cmd.right_arm.tq_desired[1] = 1e3 * cmd[9];
-    shm_cmd.right_arm.tq_desired[2] = 1e3 * cmd[10];
-    shm_cmd.right_arm.tq_desired[3] = 1e3 * cmd[11];
-    shm_cmd.right_arm.tq_desired[4] = 1e3 * cmd[12];
-    shm_cmd.right_arm.tq_desired[5] = 1e3 * cmd[13];
-    shm_cmd.right_arm.tq_desired[6] = 1e3 * cmd[14];
-
-    // Send commands to the right hand
-    handController.getCommand(handCommand);
-
-    // shm_cmd.right_hand.q_desired[0] = RAD_TO_DEG(handCommand[0]);
-    // shm_cmd.right_hand.slew_rate_q_desired[0] = 10;
-    // shm_cmd.right_hand.q_stiffness[0] = 1;
-
-    for (size_t ii = 0; ii < 5; ii++)
+    if (static_cast<size_t>(cmd.size()) != jointMap.getNumCommandJoints())
     {
-        shm_cmd.right_hand.tq_desired[ii] = 1.0e3 * handCommand[ii];
+        CONTROLIT_ERROR_RT << "Effort command has " << cmd.size() << " elements but joint map has "
+                           << jointMap.getNumCommandJoints() << " command joints. Aborting write.";
+        flightRecorder.trigger();
+        return false;
     }
 
-    shm_cmd.left_hand.tq_desired[0] = 1.0e3 * handCommand[5]; // The left gripper accepts commands in Nm?
+    commandDirtyMask |= jointMap.scatter(cmd);
+
+    // Send the latest command from the hand controller thread to the right hand.
+    // In the other cycles, the hands keep their previous command.
+    if (handCycle)
+        writeHandCommand();
 
     // shm_cmd.right_hand.tq_desired[0] = 0;
     // shm_cmd.right_hand.tq_desired[1] = 0;
@@ -585,24 +956,11 @@ bool RobotInterfaceDreamer::write(const controlit::Command & command)
     // shm_cmd.right_hand.q_stiffness[3] = 0;
     // shm_cmd.right_hand.q_stiffness[4] = 0;
 
-    // Send position commands to the neck joints
-    headController.getCommand(headCommand);
-
-    // shm_cmd.head.q_desired[0] = RAD_TO_DEG(headCommand[0]);
-    // shm_cmd.head.q_desired[1] = RAD_TO_DEG(headCommand[1]);
-    // shm_cmd.head.q_desired[2] = RAD_TO_DEG(headCommand[2]);
-    // shm_cmd.head.q_desired[3] = RAD_TO_DEG(headCommand[3]);
-    // shm_cmd.head.q_desired[4] = RAD_TO_DEG(headCommand[4]);
-    // shm_cmd.head.q_desired[5] = RAD_TO_DEG(headCommand[5]);
-    // shm_cmd.head.q_desired[6] = RAD_TO_DEG(headCommand[6]);
-
-    // shm_cmd.head.slew_rate_q_desired[0] = 10;
-    // shm_cmd.head.slew_rate_q_desired[1] = 10;
-    // shm_cmd.head.slew_rate_q_desired[2] = 10;
-    // shm_cmd.head.slew_rate_q_desired[3] = 10;
-    // shm_cmd.head.slew_rate_q_desired[4] = 10;
-    // shm_cmd.head.slew_rate_q_desired[5] = 10;
-    // shm_cmd.head.slew_rate_q_desired[6] = 10;
+    // With the shared memory backend, send the latest position command from the
+    // head controller thread to the neck joints.  The M3 server limits their slew
+    // rate.  Until the first command arrives, the head holds its current position.
+    if (headBackend == HEAD_BACKEND_SHM && (headCycle || !headCommandReceived))
+        writeHeadCommand();
 
     //---------------------------------------------------------------------------------
     // Save the timestamp into the outgoing command message.  This is necessary for
@@ -614,10 +972,16 @@ bool RobotInterfaceDreamer::write(const controlit::Command & command)
 
     //---------------------------------------------------------------------------------
     // If necessary, save the sequence number in the command message.  Used for
-    // measuring the communication time between ControlIt! and the robot.
+    // measuring the communication time between ControlIt! and the robot.  When
+    // continuously measuring, every command gets a new sequence number.
     //---------------------------------------------------------------------------------
 
-    if (sendSeqno)
+    if (continuousRTT)
+    {
+        seqno = (seqno == std::numeric_limits<int>::max()) ? 1 : seqno + 1;
+        rttSendTimes[seqno & (RTT_SEND_TIME_RING_SIZE - 1)] = rttClock->getTime();
+    }
+    else if (sendSeqno)
     {
         sendSeqno = false;
         seqno++;
@@ -631,11 +995,14 @@ bool RobotInterfaceDreamer::write(const controlit::Command & command)
     // Server.
     //---------------------------------------------------------------------------------
 
-    PRINT_INFO_STATEMENT("Getting lock on command semaphore...");
-    rt_sem_wait(command_sem);
-    memcpy(sharedMemoryPtr->cmd, &shm_cmd, sizeof(shm_cmd));
-    rt_sem_signal(command_sem);
-    PRINT_INFO_STATEMENT("Releasing lock on command semaphore...");
+    writeSHMCommand();
+
+    //---------------------------------------------------------------------------------
+    // Record the status and command of this cycle.
+    //---------------------------------------------------------------------------------
+
+    flightRecorder.record(statusReadCount, static_cast<int64_t>(rttClock->getTime() * 1e9),
+        shm_status, shm_cmd);
 
     //---------------------------------------------------------------------------------
     // Call the the parent class' write method.  This causes the command to be
@@ -645,8 +1012,196 @@ bool RobotInterfaceDreamer::write(const controlit::Command & command)
     return controlit::RobotInterface::write(command);
 }
 
+void RobotInterfaceDreamer::writeHandCommand()
+{
+    handCommandMailbox.read(handCommandSample);
+
+    // shm_cmd.right_hand.q_desired[0] = RAD_TO_DEG(handCommand[0]);
+    // shm_cmd.right_hand.slew_rate_q_desired[0] = 10;
+    // shm_cmd.right_hand.q_stiffness[0] = 1;
+
+    commandDirtyMask |= m3ScatterEfforts<DreamerHandJoints>(shm_cmd, handCommandSample.command);
+}
+
+void RobotInterfaceDreamer::writeHeadCommand()
+{
+    if (headCommandMailbox.read(headCommandSample))
+        headCommandReceived = true;
+
+    if (headCommandReceived)
+    {
+        commandDirtyMask |= m3ScatterPositions<DreamerHeadJoints>(shm_cmd, headCommandSample.command, headSlewRate);
+    }
+    else
+    {
+        AuxiliaryJointState<NUM_HEAD_JOINTS> currentState;
+        m3GatherJoints<DreamerHeadJoints>(shm_status, currentState.position, currentState.velocity);
+        commandDirtyMask |= m3ScatterPositions<DreamerHeadJoints>(shm_cmd, currentState.position, headSlewRate);
+    }
+}
+
+bool RobotInterfaceDreamer::readSHMStatus()
+{
+    statusReadCount++;
+
+    if (useSeqLock)
+    {
+        unsigned int retries;
+        bool consistent = false;
+
+        for (retries = 0; retries <= maxSeqLockRetries; retries++)
+        {
+            uint32_t const sequence = statusSeqLock.beginRead();
+            if (sequence & 1) continue; // the M3 server is in the middle of an update
+
+            statusCopyPlan.copy(&shm_status, sharedMemoryPtr->status);
+
+            if (statusSeqLock.endRead(sequence))
+            {
+                consistent = true;
+                break;
+            }
+        }
+
+        if (!consistent) retries = maxSeqLockRetries;
+
+        statusRetryCount += retries;
+        if (retries > maxStatusRetries) maxStatusRetries = retries;
+
+        if (!consistent)
+        {
+            statusReadFailureCount++;
+            flightRecorder.trigger();
+            publishSHMStats();
+            return false;
+        }
+    }
+    else
+    {
+        PRINT_INFO_STATEMENT("Grabbing lock on status semaphore...");
+        transport->lockStatus();
+        statusCopyPlan.copy(&shm_status, sharedMemoryPtr->status);
+        transport->unlockStatus();
+        PRINT_INFO_STATEMENT("Releasing lock on status semaphore...");
+    }
+
+    publishSHMStats();
+    return true;
+}
+
+void RobotInterfaceDreamer::writeSHMCommand()
+{
+    size_t numBytes;
+
+    if (useSeqLock)
+    {
+        commandSeqLock.beginWrite();
+        numBytes = copySHMCommand();
+        commandSeqLock.endWrite();
+    }
+    else
+    {
+        PRINT_INFO_STATEMENT("Getting lock on command semaphore...");
+        transport->lockCommand();
+        numBytes = copySHMCommand();
+        transport->unlockCommand();
+        PRINT_INFO_STATEMENT("Releasing lock on command semaphore...");
+    }
+
+    commandWriteCount++;
+    commandBytesTotal += numBytes;
+}
+
+size_t RobotInterfaceDreamer::copySHMCommand()
+{
+    if (fullCommandWritePending)
+    {
+        memcpy(sharedMemoryPtr->cmd, &shm_cmd, sizeof(shm_cmd));
+        fullCommandWritePending = false;
+        commandDirtyMask = 0;
+        return sizeof(shm_cmd);
+    }
+
+    size_t numBytes = commandHeaderCopyPlan.getNumBytes();
+    commandHeaderCopyPlan.copy(sharedMemoryPtr->cmd, &shm_cmd);
+
+    for (int chain = 0; chain < M3_NUM_CHAINS; chain++)
+    {
+        if (commandDirtyMask & (1u << chain))
+        {
+            commandCopyPlans[chain].copy(sharedMemoryPtr->cmd, &shm_cmd);
+            numBytes += commandCopyPlans[chain].getNumBytes();
+        }
+    }
+
+    commandDirtyMask = 0;
+    return numBytes;
+}
+
+void RobotInterfaceDreamer::publishSHMStats()
+{
+    if (statusReadCount % SHM_STATS_PUBLISH_PERIOD != 0 || OverrunPolicy::isSlackLow())
+        return;
+
+    if (shmStatsPublisher.trylock())
+    {
+        shmStatsPublisher.msg_.data[0] = statusReadCount;
+        shmStatsPublisher.msg_.data[1] = statusRetryCount;
+        shmStatsPublisher.msg_.data[2] = statusReadFailureCount;
+        shmStatsPublisher.msg_.data[3] = maxStatusRetries;
+        shmStatsPublisher.msg_.data[4] = statusCopyPlan.getNumBytes();
+        shmStatsPublisher.msg_.data[5] = commandWriteCount == 0 ? 0 :
+            static_cast<double>(commandBytesTotal) / commandWriteCount;
+        shmStatsPublisher.unlockAndPublish();
+    }
+}
+
+void RobotInterfaceDreamer::recordRTT()
+{
+    int const reflectedSeqno = shm_status.seqno;
+
+    // The M3 server has not received a new command since the last read.
+    if (reflectedSeqno == lastReflectedSeqno)
+        return;
+
+    lastReflectedSeqno = reflectedSeqno;
+
+    // Only the send times of the most recent sequence numbers are remembered.
+    unsigned int const age = static_cast<unsigned int>(seqno) - static_cast<unsigned int>(reflectedSeqno);
+    if (reflectedSeqno <= 0 || age >= RTT_SEND_TIME_RING_SIZE)
+    {
+        rttUnmatchedCount++;
+        return;
+    }
+
+    rttHistogram.record(rttClock->getTime()
+        - rttSendTimes[reflectedSeqno & (RTT_SEND_TIME_RING_SIZE - 1)]);
+}
+
+void RobotInterfaceDreamer::publishRTTStats()
+{
+    if (statusReadCount % RTT_STATS_PUBLISH_PERIOD != 0)
+        return;
+
+    if (rttStatsPublisher.trylock())
+    {
+        rttStatsPublisher.msg_.data[0] = rttHistogram.getCount();
+        rttStatsPublisher.msg_.data[1] = rttHistogram.getPercentile(0.5);
+        rttStatsPublisher.msg_.data[2] = rttHistogram.getPercentile(0.99);
+        rttStatsPublisher.msg_.data[3] = rttHistogram.getPercentile(0.999);
+        rttStatsPublisher.msg_.data[4] = rttHistogram.getMax();
+        rttStatsPublisher.msg_.data[5] = rttUnmatchedCount;
+        rttStatsPublisher.msg_.data[6] = rttHistogram.getOverflowCount();
+        rttStatsPublisher.unlockAndPublish();
+    }
+}
+
 std::shared_ptr<Timer> RobotInterfaceDreamer::getTimer()
 {
+    // RTAI is not available when using the POSIX transport.
+    if (transport && !transport->usesRTAI())
+        return RobotInterface::getTimer();
+
     std::shared_ptr<Timer> timerPtr;
     timerPtr.reset(new TimerRTAI());
     return timerPtr;
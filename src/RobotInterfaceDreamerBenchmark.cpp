@@ -0,0 +1,432 @@
+/*
+ * Measures the per-cycle cost of each stage of RobotInterfaceDreamer::read()
+ * and RobotInterfaceDreamer::write(): copying the status and command to and
+ * from shared memory, converting units and joint order, and exchanging the
+ * hand and head state and commands.
+ *
+ * The stages are the robot interface's own methods.  Instead of calling
+ * init(), which requires a ROS master and starts the hand and head threads,
+ * RobotInterfaceDreamerBenchmark sets up the members the stages use: Dreamer's
+ * default joint map, the shared memory head backend, and the "local" shared
+ * memory transport, with this program acting as the M3 server.  Neither RTAI,
+ * the M3 server, nor a ROS master is required.
+ *
+ * When libcontrolit_dreamer_rt_checker.so is loaded via LD_PRELOAD, the heap
+ * allocations (malloc, calloc, realloc, posix_memalign, etc.) and system
+ * calls made by each stage are counted and their call sites are listed at
+ * the end.
+ */
+
+#include <controlit/RobotState.hpp>
+#include <controlit/dreamer/M3JointMap.hpp>
+#include <controlit/dreamer/RTChecker.hpp>
+#include <controlit/dreamer/RobotInterfaceDreamer.hpp>
+#include <controlit/dreamer/SHMTransportLocal.hpp>
+
+#include "m3uta/controllers/torque_shm_uta_sds.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_NUM_ITERATIONS 1000000
+#define RT_CHECKER_REPORT_INTERVAL 256  // in iterations
+
+namespace controlit {
+namespace dreamer {
+
+/*!
+ * Runs a function repeatedly and prints how long each call took and, if
+ * the RT checker is active, how many heap allocations and system calls it
+ * made.
+ */
+template<typename Function>
+static void runBenchmark(const std::string & name, unsigned long long numIterations, RTChecker & rtChecker,
+    bool checking, Function function)
+{
+    // Warm up the caches while counting the heap allocations and system calls.
+    unsigned long long const numWarmupIterations = std::max(numIterations / 10, 1ULL);
+
+    rtChecker.report();
+    unsigned long long const eventsBefore = rtChecker.getNumEvents();
+
+    for (unsigned long long ii = 0; ii < numWarmupIterations; ii++)
+    {
+        rtChecker.arm();
+        function(ii);
+        rtChecker.disarm();
+
+        if ((ii + 1) % RT_CHECKER_REPORT_INTERVAL == 0)
+            rtChecker.report();
+    }
+
+    rtChecker.report();
+    unsigned long long const events = rtChecker.getNumEvents() - eventsBefore;
+
+    // Time the function without the checker.
+    auto const startTime = std::chrono::steady_clock::now();
+
+    for (unsigned long long ii = 0; ii < numIterations; ii++)
+        function(ii);
+
+    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << "  " << std::left << std::setw(40) << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(1) << elapsed / numIterations * 1e9 << " ns/cycle"
+              << std::setw(14) << std::setprecision(0) << numIterations / elapsed << " cycles/s";
+
+    if (checking)
+    {
+        std::cout << std::setw(10) << std::setprecision(3)
+                  << static_cast<double>(events) / numWarmupIterations << " allocs+syscalls/cycle";
+    }
+
+    std::cout << std::endl;
+}
+
+/*!
+ * Sets up a RobotInterfaceDreamer without ROS and times the stages of its
+ * read() and write() methods.  This is a friend of RobotInterfaceDreamer.
+ */
+class RobotInterfaceDreamerBenchmark
+{
+public:
+    /*!
+     * The constructor.
+     */
+    RobotInterfaceDreamerBenchmark();
+
+    /*!
+     * Creates the shared memory and prepares the robot interface the same
+     * way RobotInterfaceDreamer::init() does, except that the joint map is
+     * Dreamer's default, the head is commanded through shared memory, and
+     * the hand and head threads are not started.
+     *
+     * \return Whether the initialization was successful.
+     */
+    bool init();
+
+    /*!
+     * Runs the benchmarks and prints the results.
+     *
+     * \param[in] numIterations The number of iterations of each benchmark.
+     */
+    void run(unsigned long long numIterations);
+
+private:
+
+    /*!
+     * Acts as the M3 server.  This is declared before robotInterface so that
+     * it outlives the robot interface's connection to the shared memory.
+     */
+    SHMTransportLocal server;
+
+    /*!
+     * The robot interface being measured.
+     */
+    RobotInterfaceDreamer robotInterface;
+
+    /*!
+     * The robot state filled in by read().
+     */
+    controlit::RobotState robotState;
+
+    /*!
+     * The effort command passed to write().
+     */
+    Vector effortCommand;
+
+    /*!
+     * Counts the heap allocations and system calls of each stage.
+     */
+    RTChecker rtChecker;
+
+    /*!
+     * Whether rtChecker is active.
+     */
+    bool checking;
+};
+
+RobotInterfaceDreamerBenchmark::RobotInterfaceDreamerBenchmark() :
+    checking(false)
+{
+}
+
+bool RobotInterfaceDreamerBenchmark::init()
+{
+    //---------------------------------------------------------------------------------
+    // Act as the M3 server: create the shared memory and fill the status with
+    // non-zero values.
+    //---------------------------------------------------------------------------------
+
+    if (!server.create())
+    {
+        std::cerr << "ERROR: Unable to create the shared memory." << std::endl;
+        return false;
+    }
+
+    M3UTATorqueShmSdsStatus serverStatus;
+    memset(&serverStatus, 0, sizeof(serverStatus));
+    for (int chain = 0; chain < M3_NUM_CHAINS; chain++)
+    {
+        M3TorqueShmSdsBaseStatus & limb = m3LimbStatus(serverStatus, static_cast<m3_chain_t>(chain));
+        for (int ii = 0; ii < MAX_NDOF; ii++)
+        {
+            limb.theta[ii] = chain * 10 + ii;
+            limb.thetadot[ii] = chain + ii * 0.1;
+            limb.torque[ii] = 100 * ii;
+        }
+    }
+    memcpy(server.getSharedMemory()->status, &serverStatus, sizeof(serverStatus));
+
+    //---------------------------------------------------------------------------------
+    // Prepare the robot interface.  These are the parts of
+    // RobotInterfaceDreamer::init() that read() and write() depend on.
+    //---------------------------------------------------------------------------------
+
+    RobotInterfaceDreamer & ri = robotInterface;
+
+    ri.transport.reset(new SHMTransportLocal());
+
+    memset(&ri.shm_status, 0, sizeof(ri.shm_status));
+    memset(&ri.shm_cmd, 0, sizeof(ri.shm_cmd));
+
+    if (!ri.jointMap.initDefault(ri.shm_status, ri.shm_cmd))
+    {
+        std::cerr << "ERROR: Unable to initialize the joint map." << std::endl;
+        return false;
+    }
+
+    size_t const numStateJoints = ri.jointMap.getNumStateJoints();
+    size_t const numCommandJoints = ri.jointMap.getNumCommandJoints();
+
+    ri.jointPositions.setZero(numStateJoints);
+    ri.jointVelocities.setZero(numStateJoints);
+    ri.jointEfforts.setZero(numStateJoints);
+
+    // The serial backend would open the head's serial port.
+    ri.headBackend = HEAD_BACKEND_SHM;
+    ri.initCopyPlans();
+
+    // Initialize the sequence locks so that both exchange modes can be timed.
+    ri.useSeqLock = true;
+    if (!ri.initSM())
+    {
+        std::cerr << "ERROR: Unable to attach to the shared memory." << std::endl;
+        return false;
+    }
+
+    // Stand in for the hand and head threads, which are not started, by
+    // leaving a command from each in its mailbox.
+    ri.initMailboxes();
+
+    AuxiliaryJointCommand<NUM_HAND_JOINTS> handCommand;
+    for (size_t ii = 0; ii < NUM_HAND_JOINTS; ii++)
+        handCommand.command[ii] = 0.01 * ii;
+    ri.handCommandMailbox.write(handCommand);
+
+    AuxiliaryJointCommand<NUM_HEAD_JOINTS> headCommand;
+    for (size_t ii = 0; ii < NUM_HEAD_JOINTS; ii++)
+        headCommand.command[ii] = 0.1 * ii;
+    ri.headCommandMailbox.write(headCommand);
+
+    //---------------------------------------------------------------------------------
+    // Size the robot state and command to match the joint map.
+    //---------------------------------------------------------------------------------
+
+    std::vector<std::string> jointNames;
+    for (size_t ii = 0; ii < numStateJoints; ii++)
+    {
+        std::stringstream name;
+        name << "joint_" << ii;
+        jointNames.push_back(name.str());
+    }
+
+    robotState.init(jointNames);
+    effortCommand.setZero(numCommandJoints);
+
+    checking = rtChecker.init(true);
+    return true;
+}
+
+void RobotInterfaceDreamerBenchmark::run(unsigned long long numIterations)
+{
+    RobotInterfaceDreamer & ri = robotInterface;
+
+    // Every chain with a command in the copy plans.
+    unsigned int const allChainsMask = (1u << M3_NUM_CHAINS) - 1;
+
+    //---------------------------------------------------------------------------------
+    // Define the stages of read() and write().
+    //---------------------------------------------------------------------------------
+
+    auto readStatusSemaphore = [&](unsigned long long)
+    {
+        ri.useSeqLock = false;
+        ri.readSHMStatus();
+    };
+
+    auto readStatusSeqLock = [&](unsigned long long)
+    {
+        ri.useSeqLock = true;
+        ri.readSHMStatus();
+    };
+
+    auto convertState = [&](unsigned long long)
+    {
+        ri.jointMap.gather(ri.jointPositions, ri.jointVelocities, ri.jointEfforts);
+    };
+
+    auto readJointState = [&](unsigned long long)
+    {
+        ri.readJointState(robotState);
+    };
+
+    auto handState = [&](unsigned long long)
+    {
+        ri.publishHandState();
+    };
+
+    auto headState = [&](unsigned long long)
+    {
+        ri.publishHeadState();
+    };
+
+    auto convertCommand = [&](unsigned long long iteration)
+    {
+        // Change the command every cycle so every chain is dirty.
+        for (size_t ii = 0; ii < static_cast<size_t>(effortCommand.size()); ii++)
+            effortCommand[ii] = 0.001 * (iteration % 1000) + ii;
+
+        ri.commandDirtyMask |= ri.jointMap.scatter(effortCommand);
+    };
+
+    auto handCommand = [&](unsigned long long)
+    {
+        ri.writeHandCommand();
+    };
+
+    auto headCommand = [&](unsigned long long)
+    {
+        ri.writeHeadCommand();
+    };
+
+    auto writeCommandSemaphore = [&](unsigned long long)
+    {
+        ri.useSeqLock = false;
+        ri.commandDirtyMask = allChainsMask;
+        ri.writeSHMCommand();
+    };
+
+    auto writeCommandSeqLock = [&](unsigned long long)
+    {
+        ri.useSeqLock = true;
+        ri.commandDirtyMask = allChainsMask;
+        ri.writeSHMCommand();
+    };
+
+    // Every stage runs in every cycle, so this is an upper bound.  In the
+    // servo loop, the hand and head stages only run in their own cycles.
+    auto fullCycle = [&](unsigned long long iteration)
+    {
+        ri.readSHMStatus();
+        ri.readJointState(robotState);
+        ri.publishHandState();
+        ri.publishHeadState();
+        convertCommand(iteration);
+        ri.writeHandCommand();
+        ri.writeHeadCommand();
+        ri.writeSHMCommand();
+    };
+
+    //---------------------------------------------------------------------------------
+    // Run the benchmarks.
+    //---------------------------------------------------------------------------------
+
+    std::cout << "RobotInterfaceDreamerBenchmark: " << numIterations << " iterations, "
+              << ri.jointMap.getNumStateJoints() << " state joints, "
+              << ri.jointMap.getNumCommandJoints() << " command joints, "
+              << ri.statusCopyPlan.getNumBytes() << " of " << sizeof(ri.shm_status) << " status bytes copied.\n"
+              << "read():" << std::endl;
+
+    runBenchmark("status copy (semaphore)", numIterations, rtChecker, checking, readStatusSemaphore);
+    runBenchmark("status copy (seqlock)", numIterations, rtChecker, checking, readStatusSeqLock);
+    runBenchmark("unit conversion (joint map gather)", numIterations, rtChecker, checking, convertState);
+    runBenchmark("joint state (gather + robot state)", numIterations, rtChecker, checking, readJointState);
+    runBenchmark("hand state mailbox", numIterations, rtChecker, checking, handState);
+    runBenchmark("head state mailbox", numIterations, rtChecker, checking, headState);
+
+    std::cout << "write():" << std::endl;
+
+    runBenchmark("unit conversion (joint map scatter)", numIterations, rtChecker, checking, convertCommand);
+    runBenchmark("hand command mailbox", numIterations, rtChecker, checking, handCommand);
+    runBenchmark("head command mailbox", numIterations, rtChecker, checking, headCommand);
+    runBenchmark("command copy (semaphore, all chains)", numIterations, rtChecker, checking, writeCommandSemaphore);
+    runBenchmark("command copy (seqlock, all chains)", numIterations, rtChecker, checking, writeCommandSeqLock);
+
+    std::cout << "read() + write():" << std::endl;
+
+    ri.useSeqLock = false;
+    runBenchmark("full cycle (semaphore)", numIterations, rtChecker, checking, fullCycle);
+
+    ri.useSeqLock = true;
+    runBenchmark("full cycle (seqlock)", numIterations, rtChecker, checking, fullCycle);
+
+    if (checking)
+        std::cout << rtChecker.toString() << std::endl;
+    else
+        std::cout << "Heap allocations and system calls were not counted. To count them, run with "
+                  << "LD_PRELOAD=<devel>/lib/libcontrolit_dreamer_rt_checker.so." << std::endl;
+}
+
+} // namespace dreamer
+} // namespace controlit
+
+// This is the main method that starts everything.
+int main(int argc, char **argv)
+{
+    // Define usage
+    std::stringstream ss;
+    ss << "Usage: rosrun controlit_dreamer_integration RobotInterfaceDreamerBenchmark [options]\n"
+       << "Valid options include:\n"
+       << "  -h: display this usage string\n"
+       << "  -n [iterations]: the number of iterations of each benchmark (default: " << DEFAULT_NUM_ITERATIONS << ")";
+
+    unsigned long long numIterations = DEFAULT_NUM_ITERATIONS;
+
+    // Parse the command line arguments
+    int option_char;
+    while ((option_char = getopt (argc, argv, "hn:")) != -1)
+    {
+        switch (option_char)
+        {
+            case 'h':
+                std::cout << ss.str() << std::endl;
+                return 0;
+                break;
+            case 'n':
+                numIterations = std::stoull(optarg);
+                break;
+            default:
+                std::cerr << "ERROR: Unknown option " << option_char << ".  " << ss.str() << std::endl;
+                return -1;
+        }
+    }
+
+    if (numIterations == 0)
+    {
+        std::cerr << "ERROR: The number of iterations must be positive." << std::endl;
+        return -1;
+    }
+
+    controlit::dreamer::RobotInterfaceDreamerBenchmark benchmark;
+    if (!benchmark.init())
+        return -1;
+
+    benchmark.run(numIterations);
+    return 0;
+}
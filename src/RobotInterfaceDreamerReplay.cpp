@@ -0,0 +1,303 @@
+#include <controlit/dreamer/RobotInterfaceDreamerReplay.hpp>
+
+#include <controlit/Command.hpp>
+#include <controlit/RTControlModel.hpp>
+#include <controlit/logging/RealTimeLogging.hpp>
+#include <controlit/dreamer/OdometryStateReceiverDreamer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace controlit {
+namespace dreamer {
+
+// Uncomment one of the following lines to enable/disable detailed debug statements.
+#define PRINT_INFO_STATEMENT(ss)
+// #define PRINT_INFO_STATEMENT(ss) CONTROLIT_INFO << ss;
+
+#define DEFAULT_REPLAY_RATE 1.0
+#define COMPUTE_TIME_BUCKET_WIDTH 1e-6  // in seconds
+#define COMPUTE_TIME_NUM_BUCKETS 10000
+
+RobotInterfaceDreamerReplay::RobotInterfaceDreamerReplay() :
+    RobotInterface(),         // Call super-class' constructor
+    nextFrame(0),
+    currentFrame(0),
+    loop(false),
+    finished(false),
+    newFrame(false),
+    replayRate(DEFAULT_REPLAY_RATE),
+    firstFrameTimestamp(0),
+    maxEffortDifference(0)
+{
+}
+
+RobotInterfaceDreamerReplay::~RobotInterfaceDreamerReplay()
+{
+    if (!finished && computeTimeHistogram.getCount() > 0)
+        printSummary();
+}
+
+bool RobotInterfaceDreamerReplay::init(ros::NodeHandle & nh, RTControlModel * model)
+{
+    PRINT_INFO_STATEMENT("Method called!");
+
+    //---------------------------------------------------------------------------------
+    // Initialize the parent class.
+    //---------------------------------------------------------------------------------
+
+    if (!RobotInterface::init(nh, model))
+        return false;
+
+    //---------------------------------------------------------------------------------
+    // Load the recorded frames.
+    //---------------------------------------------------------------------------------
+
+    std::string replayFile;
+    if (!nh.getParam("replay_file", replayFile))
+    {
+        CONTROLIT_ERROR << "Parameter \"replay_file\" not set.";
+        return false;
+    }
+
+    if (!loadFrames(replayFile))
+        return false;
+
+    nh.param("replay_rate", replayRate, DEFAULT_REPLAY_RATE);
+    nh.param("replay_loop", loop, false);
+
+    //---------------------------------------------------------------------------------
+    // Initialize the joint map.
+    //---------------------------------------------------------------------------------
+
+    memset(&shm_status, 0, sizeof(shm_status));
+    memset(&shm_cmd, 0, sizeof(shm_cmd));
+
+    if (!jointMap.init(nh, shm_status, shm_cmd))
+    {
+        CONTROLIT_ERROR << "Failed to initialize the joint map.";
+        return false;
+    }
+
+    if (!jointMap.checkModel(model))
+        return false;
+
+    jointPositions.setZero(jointMap.getNumStateJoints());
+    jointVelocities.setZero(jointMap.getNumStateJoints());
+    jointEfforts.setZero(jointMap.getNumStateJoints());
+    recordedEffort.setZero(jointMap.getNumCommandJoints());
+
+    computeTimeHistogram.init(COMPUTE_TIME_BUCKET_WIDTH, COMPUTE_TIME_NUM_BUCKETS);
+
+    //---------------------------------------------------------------------------------
+    // Open the file in which to save the captured commands.
+    //---------------------------------------------------------------------------------
+
+    std::string outputPath;
+    nh.param("replay_output_file", outputPath, std::string(""));
+
+    if (!outputPath.empty())
+    {
+        outputFile.open(outputPath.c_str());
+        if (!outputFile.is_open())
+        {
+            CONTROLIT_ERROR << "Unable to open replay output file \"" << outputPath << "\".";
+            return false;
+        }
+
+        outputFile << "cycle,timestamp,compute_time";
+        for (size_t ii = 0; ii < jointMap.getNumCommandJoints(); ii++)
+            outputFile << ",effort_" << ii;
+        for (size_t ii = 0; ii < jointMap.getNumCommandJoints(); ii++)
+            outputFile << ",recorded_effort_" << ii;
+        outputFile << "\n";
+    }
+
+    //---------------------------------------------------------------------------------
+    // Create the odometry receiver.
+    //---------------------------------------------------------------------------------
+
+    PRINT_INFO_STATEMENT("Creating and initializing the odometry state receiver...");
+    odometryStateReceiver.reset(new OdometryStateReceiverDreamer());
+    return odometryStateReceiver->init(nh, model);
+}
+
+bool RobotInterfaceDreamerReplay::loadFrames(const std::string & path)
+{
+    FILE * file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        CONTROLIT_ERROR << "Unable to open replay file \"" << path << "\": " << strerror(errno);
+        return false;
+    }
+
+    FlightRecorderFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, FLIGHT_RECORDER_MAGIC, sizeof(header.magic)) != 0)
+    {
+        CONTROLIT_ERROR << "\"" << path << "\" is not a flight recorder file.";
+        fclose(file);
+        return false;
+    }
+
+    if (header.version != FLIGHT_RECORDER_VERSION || header.frameSize != sizeof(FlightRecorderFrame))
+    {
+        CONTROLIT_ERROR << "\"" << path << "\" has version " << header.version << " and frame size "
+                        << header.frameSize << ", expected version " << FLIGHT_RECORDER_VERSION
+                        << " and frame size " << sizeof(FlightRecorderFrame) << ".";
+        fclose(file);
+        return false;
+    }
+
+    // The file is a circular buffer.  Once it wraps, the oldest frame is
+    // the next one that would have been overwritten.
+    uint64_t const numFrames = std::min(header.numFrames, header.capacity);
+    uint64_t const oldestFrame = header.numFrames > header.capacity ? header.numFrames % header.capacity : 0;
+
+    std::vector<FlightRecorderFrame> fileFrames(numFrames);
+    if (numFrames == 0 || fread(fileFrames.data(), sizeof(FlightRecorderFrame), numFrames, file) != numFrames)
+    {
+        CONTROLIT_ERROR << "Unable to read " << numFrames << " frames from \"" << path << "\".";
+        fclose(file);
+        return false;
+    }
+
+    fclose(file);
+
+    frames.clear();
+    frames.reserve(numFrames);
+    for (uint64_t ii = 0; ii < numFrames; ii++)
+        frames.push_back(fileFrames[(oldestFrame + ii) % numFrames]);
+
+    CONTROLIT_INFO << "Loaded " << frames.size() << " frames spanning "
+                   << (frames.back().timestamp - frames.front().timestamp) / 1e9 << " seconds from \""
+                   << path << "\".";
+    return true;
+}
+
+void RobotInterfaceDreamerReplay::printSummary()
+{
+    CONTROLIT_INFO << "Replayed " << computeTimeHistogram.getCount() << " frames.\n"
+                   << "Controller compute time (seconds):\n"
+                   << computeTimeHistogram.toString("  ") << "\n"
+                   << "Maximum difference from recorded effort: " << maxEffortDifference << " Nm";
+}
+
+bool RobotInterfaceDreamerReplay::read(controlit::RobotState & latestRobotState, bool block)
+{
+    //---------------------------------------------------------------------------------
+    // Determine which frame to replay.
+    //---------------------------------------------------------------------------------
+
+    if (nextFrame >= frames.size())
+    {
+        if (!loop)
+        {
+            if (!finished)
+            {
+                finished = true;
+                printSummary();
+            }
+            return false;
+        }
+
+        nextFrame = 0;
+    }
+
+    std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+
+    if (nextFrame == 0)
+    {
+        replayStartTime = now;
+        firstFrameTimestamp = frames[0].timestamp;
+    }
+
+    //---------------------------------------------------------------------------------
+    // Replay the next frame once it is due.  Until then, the current frame is
+    // repeated rather than blocking the servo thread.
+    //---------------------------------------------------------------------------------
+
+    newFrame = replayRate <= 0 || nextFrame == 0 || now >= replayStartTime + std::chrono::nanoseconds(
+        static_cast<int64_t>((frames[nextFrame].timestamp - firstFrameTimestamp) / replayRate));
+
+    if (newFrame)
+    {
+        currentFrame = nextFrame++;
+        memcpy(&shm_status, &frames[currentFrame].status, sizeof(shm_status));
+        jointMap.gather(jointPositions, jointVelocities, jointEfforts);
+    }
+
+    //---------------------------------------------------------------------------------
+    // Save the joint position, velocity, and effort data.
+    //---------------------------------------------------------------------------------
+
+    latestRobotState.resetTimestamp();
+
+    for (size_t ii = 0; ii < jointMap.getNumStateJoints(); ii++)
+    {
+        latestRobotState.setJointPosition(ii, jointPositions[ii]);
+        latestRobotState.setJointVelocity(ii, jointVelocities[ii]);
+        latestRobotState.setJointEffort(ii, jointEfforts[ii]);
+    }
+
+    if (!odometryStateReceiver->getOdometry(latestRobotState, block))
+        return false;
+
+    bool const result = controlit::RobotInterface::read(latestRobotState, block);
+
+    readTime = std::chrono::steady_clock::now();
+    return result;
+}
+
+bool RobotInterfaceDreamerReplay::write(const controlit::Command & command)
+{
+    double const computeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - readTime).count();
+
+    const Vector & cmd = command.getEffortCmd();
+
+    if (static_cast<size_t>(cmd.size()) != jointMap.getNumCommandJoints())
+    {
+        CONTROLIT_ERROR_RT << "Effort command has " << cmd.size() << " elements but joint map has "
+                           << jointMap.getNumCommandJoints() << " command joints. Aborting write.";
+        return false;
+    }
+
+    //---------------------------------------------------------------------------------
+    // Compare the command with the one that was recorded.  A repeated frame
+    // was already compared.
+    //---------------------------------------------------------------------------------
+
+    if (!newFrame)
+        return controlit::RobotInterface::write(command);
+
+    computeTimeHistogram.record(computeTime);
+
+    const FlightRecorderFrame & frame = frames[currentFrame];
+
+    memcpy(&shm_cmd, &frame.command, sizeof(shm_cmd));
+    jointMap.gatherCommand(recordedEffort);
+
+    for (size_t ii = 0; ii < jointMap.getNumCommandJoints(); ii++)
+    {
+        double const difference = std::abs(cmd[ii] - recordedEffort[ii]);
+        if (difference > maxEffortDifference) maxEffortDifference = difference;
+    }
+
+    if (outputFile.is_open())
+    {
+        outputFile << frame.cycle << "," << frame.timestamp << "," << computeTime;
+        for (size_t ii = 0; ii < jointMap.getNumCommandJoints(); ii++)
+            outputFile << "," << cmd[ii];
+        for (size_t ii = 0; ii < jointMap.getNumCommandJoints(); ii++)
+            outputFile << "," << recordedEffort[ii];
+        outputFile << "\n";
+    }
+
+    return controlit::RobotInterface::write(command);
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -0,0 +1,22 @@
+#include <controlit/dreamer/SHMTransport.hpp>
+#include <controlit/dreamer/SHMTransportLocal.hpp>
+#include <controlit/dreamer/SHMTransportPOSIX.hpp>
+#include <controlit/dreamer/SHMTransportRTAI.hpp>
+
+namespace controlit {
+namespace dreamer {
+
+SHMTransport * createSHMTransport(const std::string & type)
+{
+    if (type == "rtai")
+        return new SHMTransportRTAI();
+    else if (type == "posix")
+        return new SHMTransportPOSIX();
+    else if (type == "local")
+        return new SHMTransportLocal();
+    else
+        return nullptr;
+}
+
+} // namespace dreamer
+} // namespace controlit
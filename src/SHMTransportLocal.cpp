@@ -0,0 +1,111 @@
+#include <controlit/dreamer/SHMTransportLocal.hpp>
+
+#include <controlit/logging/RealTimeLogging.hpp>
+
+#include <atomic>
+#include <string.h>
+#include <sys/mman.h>
+
+namespace controlit {
+namespace dreamer {
+
+// Uncomment one of the following lines to enable/disable detailed debug statements.
+#define PRINT_INFO_STATEMENT(ss)
+// #define PRINT_INFO_STATEMENT(ss) CONTROLIT_INFO << ss;
+
+/*!
+ * The process-wide segment and its locks.  The segment is null until
+ * create() is called.
+ */
+static M3Sds * localSegment = nullptr;
+static std::atomic_flag localStatusLock = ATOMIC_FLAG_INIT;
+static std::atomic_flag localCommandLock = ATOMIC_FLAG_INIT;
+
+static inline void lockSpin(std::atomic_flag & lock)
+{
+    while (lock.test_and_set(std::memory_order_acquire)) {}
+}
+
+static inline void unlockSpin(std::atomic_flag & lock)
+{
+    lock.clear(std::memory_order_release);
+}
+
+SHMTransportLocal::SHMTransportLocal() :
+    sharedMemoryPtr(nullptr)
+{
+}
+
+SHMTransportLocal::~SHMTransportLocal()
+{
+    detach();
+}
+
+bool SHMTransportLocal::attach()
+{
+    if (!localSegment)
+    {
+        PRINT_INFO_STATEMENT("The local shared memory segment was not created.");
+        return false;
+    }
+
+    sharedMemoryPtr = localSegment;
+    return true;
+}
+
+void SHMTransportLocal::detach()
+{
+    sharedMemoryPtr = nullptr;
+}
+
+bool SHMTransportLocal::create()
+{
+    if (localSegment)
+    {
+        CONTROLIT_ERROR << "The local shared memory segment already exists.";
+        return false;
+    }
+
+    localSegment = new M3Sds;
+    memset(localSegment, 0, sizeof(M3Sds));
+
+    // Prevent page faults when accessing the segment from the servo loop.
+    mlock(localSegment, sizeof(M3Sds));
+
+    sharedMemoryPtr = localSegment;
+    return true;
+}
+
+void SHMTransportLocal::destroy()
+{
+    if (sharedMemoryPtr != localSegment || !localSegment)
+        return;
+
+    munlock(localSegment, sizeof(M3Sds));
+    delete localSegment;
+    localSegment = nullptr;
+    sharedMemoryPtr = nullptr;
+}
+
+void SHMTransportLocal::lockStatus()
+{
+    lockSpin(localStatusLock);
+}
+
+void SHMTransportLocal::unlockStatus()
+{
+    unlockSpin(localStatusLock);
+}
+
+void SHMTransportLocal::lockCommand()
+{
+    lockSpin(localCommandLock);
+}
+
+void SHMTransportLocal::unlockCommand()
+{
+    unlockSpin(localCommandLock);
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -0,0 +1,181 @@
+#include <controlit/dreamer/SHMTransportPOSIX.hpp>
+
+#include <controlit/logging/RealTimeLogging.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace controlit {
+namespace dreamer {
+
+// Uncomment one of the following lines to enable/disable detailed debug statements.
+#define PRINT_INFO_STATEMENT(ss)
+// #define PRINT_INFO_STATEMENT(ss) CONTROLIT_INFO << ss;
+
+/*!
+ * Returns the thread ID of the calling thread.  The ID is cached so that
+ * acquiring an uncontended lock does not require a system call.
+ */
+static uint32_t getThreadID()
+{
+    static thread_local uint32_t tid = 0;
+    if (tid == 0)
+        tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    return tid;
+}
+
+/*!
+ * Acquires a priority-inheritance futex.  The uncontended case is a single
+ * compare-and-swap.  Otherwise the kernel queues the caller and boosts the
+ * priority of the current owner.
+ */
+static void lockPI(std::atomic<uint32_t> & word)
+{
+    uint32_t expected = 0;
+    if (word.compare_exchange_strong(expected, getThreadID(), std::memory_order_acquire))
+        return;
+
+    while (syscall(SYS_futex, &word, FUTEX_LOCK_PI, 0, nullptr, nullptr, 0) != 0 && errno == EINTR);
+}
+
+/*!
+ * Releases a priority-inheritance futex.
+ */
+static void unlockPI(std::atomic<uint32_t> & word)
+{
+    uint32_t expected = getThreadID();
+    if (word.compare_exchange_strong(expected, 0, std::memory_order_release))
+        return;
+
+    // There are waiters. Let the kernel hand the lock to the highest priority one.
+    syscall(SYS_futex, &word, FUTEX_UNLOCK_PI, 0, nullptr, nullptr, 0);
+}
+
+SHMTransportPOSIX::SHMTransportPOSIX() :
+    sharedMemoryPtr(nullptr),
+    locks(nullptr)
+{
+}
+
+SHMTransportPOSIX::~SHMTransportPOSIX()
+{
+    detach();
+}
+
+size_t SHMTransportPOSIX::getSegmentSize()
+{
+    return sizeof(M3Sds) + sizeof(SHMTransportPOSIXLocks);
+}
+
+std::string SHMTransportPOSIX::getSegmentName()
+{
+    return std::string("/") + TORQUE_SHM;
+}
+
+bool SHMTransportPOSIX::attach()
+{
+    PRINT_INFO_STATEMENT("Method called!");
+    return map(false);
+}
+
+bool SHMTransportPOSIX::map(bool create)
+{
+    std::string const name = getSegmentName();
+
+    int fd = shm_open(name.c_str(), O_RDWR | (create ? O_CREAT : 0), 0660);
+    if (fd < 0)
+    {
+        CONTROLIT_ERROR << "Call to shm_open failed for shared memory name \"" << name << "\": " << strerror(errno);
+        return false;
+    }
+
+    if (create && ftruncate(fd, getSegmentSize()) != 0)
+    {
+        CONTROLIT_ERROR << "Unable to set size of shared memory \"" << name << "\": " << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    struct stat fdStat;
+    if (fstat(fd, &fdStat) != 0 || static_cast<size_t>(fdStat.st_size) < getSegmentSize())
+    {
+        CONTROLIT_ERROR << "Shared memory \"" << name << "\" is smaller than " << getSegmentSize() << " bytes";
+        close(fd);
+        return false;
+    }
+
+    void * addr = mmap(nullptr, getSegmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping remains valid after the descriptor is closed
+
+    if (addr == MAP_FAILED)
+    {
+        CONTROLIT_ERROR << "Call to mmap failed for shared memory \"" << name << "\": " << strerror(errno);
+        return false;
+    }
+
+    // Prevent page faults when accessing the segment from the servo loop.
+    mlock(addr, getSegmentSize());
+
+    sharedMemoryPtr = static_cast<M3Sds *>(addr);
+    locks = reinterpret_cast<SHMTransportPOSIXLocks *>(static_cast<unsigned char *>(addr) + sizeof(M3Sds));
+
+    PRINT_INFO_STATEMENT("Done initializing connection to shared memory.");
+    return true;
+}
+
+bool SHMTransportPOSIX::create()
+{
+    PRINT_INFO_STATEMENT("Method called!");
+
+    if (!map(true))
+        return false;
+
+    // Zero the data and release both locks.
+    memset(sharedMemoryPtr, 0, getSegmentSize());
+    return true;
+}
+
+void SHMTransportPOSIX::destroy()
+{
+    detach();
+    shm_unlink(getSegmentName().c_str());
+}
+
+void SHMTransportPOSIX::detach()
+{
+    if (sharedMemoryPtr)
+    {
+        munmap(sharedMemoryPtr, getSegmentSize());
+        sharedMemoryPtr = nullptr;
+        locks = nullptr;
+    }
+}
+
+void SHMTransportPOSIX::lockStatus()
+{
+    lockPI(locks->statusLock);
+}
+
+void SHMTransportPOSIX::unlockStatus()
+{
+    unlockPI(locks->statusLock);
+}
+
+void SHMTransportPOSIX::lockCommand()
+{
+    lockPI(locks->commandLock);
+}
+
+void SHMTransportPOSIX::unlockCommand()
+{
+    unlockPI(locks->commandLock);
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -0,0 +1,121 @@
+#include <controlit/dreamer/SHMTransportRTAI.hpp>
+
+#include <controlit/logging/RealTimeLogging.hpp>
+
+#include <rtai_nam2num.h>
+#include <rtai_shm.h>
+
+#include <string.h>
+
+namespace controlit {
+namespace dreamer {
+
+// Uncomment one of the following lines to enable/disable detailed debug statements.
+#define PRINT_INFO_STATEMENT(ss)
+// #define PRINT_INFO_STATEMENT(ss) CONTROLIT_INFO << ss;
+
+SHMTransportRTAI::SHMTransportRTAI() :
+    sharedMemoryPtr(nullptr),
+    status_sem(nullptr),
+    command_sem(nullptr),
+    ownsSemaphores(false)
+{
+}
+
+SHMTransportRTAI::~SHMTransportRTAI()
+{
+    if (ownsSemaphores)
+        destroy();
+    else
+        detach();
+}
+
+bool SHMTransportRTAI::attach()
+{
+    PRINT_INFO_STATEMENT("Method called!");
+
+    // Get a pointer to the shared memory created by the M3 Server.
+    PRINT_INFO_STATEMENT("Getting point to shared memory...");
+    sharedMemoryPtr = (M3Sds *) rt_shm_alloc(nam2num(TORQUE_SHM), sizeof(M3Sds), USE_VMALLOC);
+    if (!sharedMemoryPtr)
+    {
+        CONTROLIT_ERROR << "Call to rt_shm_alloc failed for shared memory name \"" << TORQUE_SHM << "\"";
+        return false;
+    }
+
+    // Get the semaphores protecting the status and command shared memory registers.
+    PRINT_INFO_STATEMENT("Getting shared memory semaphores...");
+    status_sem = (SEM *) rt_get_adr(nam2num(TORQUE_STATUS_SEM));
+    if (!status_sem)
+    {
+        CONTROLIT_ERROR << "Torque status semaphore \"" << TORQUE_STATUS_SEM << "\" not found";
+        detach();
+        return false;
+    }
+
+    command_sem = (SEM *) rt_get_adr(nam2num(TORQUE_CMD_SEM));
+    if (!command_sem)
+    {
+        CONTROLIT_ERROR << "Torque command semaphore \"" << TORQUE_CMD_SEM << "\" not found";
+        detach();
+        return false;
+    }
+
+    PRINT_INFO_STATEMENT("Done initializing connection to shared memory.");
+    return true;
+}
+
+bool SHMTransportRTAI::create()
+{
+    PRINT_INFO_STATEMENT("Method called!");
+
+    sharedMemoryPtr = (M3Sds *) rt_shm_alloc(nam2num(TORQUE_SHM), sizeof(M3Sds), USE_VMALLOC);
+    if (!sharedMemoryPtr)
+    {
+        CONTROLIT_ERROR << "Call to rt_shm_alloc failed for shared memory name \"" << TORQUE_SHM << "\"";
+        return false;
+    }
+
+    memset(sharedMemoryPtr, 0, sizeof(M3Sds));
+
+    status_sem = rt_typed_sem_init(nam2num(TORQUE_STATUS_SEM), 1, BIN_SEM);
+    command_sem = rt_typed_sem_init(nam2num(TORQUE_CMD_SEM), 1, BIN_SEM);
+    ownsSemaphores = true;
+
+    if (!status_sem || !command_sem)
+    {
+        CONTROLIT_ERROR << "Unable to create torque semaphores \"" << TORQUE_STATUS_SEM
+                        << "\" and \"" << TORQUE_CMD_SEM << "\"";
+        destroy();
+        return false;
+    }
+
+    return true;
+}
+
+void SHMTransportRTAI::destroy()
+{
+    if (ownsSemaphores)
+    {
+        if (status_sem) rt_sem_delete(status_sem);
+        if (command_sem) rt_sem_delete(command_sem);
+        ownsSemaphores = false;
+    }
+
+    detach();
+}
+
+void SHMTransportRTAI::detach()
+{
+    if (sharedMemoryPtr)
+    {
+        rt_shm_free(nam2num(TORQUE_SHM));
+        sharedMemoryPtr = nullptr;
+    }
+
+    status_sem = nullptr;
+    command_sem = nullptr;
+}
+
+} // namespace dreamer
+} // namespace controlit
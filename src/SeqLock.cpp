@@ -0,0 +1,76 @@
+#include <controlit/dreamer/SeqLock.hpp>
+
+#include <string.h>
+
+namespace controlit {
+namespace dreamer {
+
+SeqLock::SeqLock() :
+    sequence(nullptr)
+{
+}
+
+void SeqLock::init(unsigned char * block, size_t blockSize)
+{
+    sequence = reinterpret_cast<std::atomic<uint32_t> *>(block + blockSize - SEQLOCK_RESERVED_BYTES);
+}
+
+bool SeqLock::read(void * dest, const void * src, size_t size, unsigned int maxRetries,
+    unsigned int & retries) const
+{
+    for (retries = 0; retries <= maxRetries; retries++)
+    {
+        uint32_t const before = beginRead();
+
+        // An odd sequence number means the writer is in the middle of an update.
+        if (before & 1) continue;
+
+        memcpy(dest, src, size);
+
+        if (endRead(before))
+            return true;
+    }
+
+    retries = maxRetries;
+    return false;
+}
+
+uint32_t SeqLock::beginRead() const
+{
+    return sequence->load(std::memory_order_acquire);
+}
+
+bool SeqLock::endRead(uint32_t before) const
+{
+    // Prevent the loads of the protected data from being reordered after the
+    // second load of the sequence counter.
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return !(before & 1) && sequence->load(std::memory_order_relaxed) == before;
+}
+
+void SeqLock::write(void * dest, const void * src, size_t size)
+{
+    beginWrite();
+    memcpy(dest, src, size);
+    endWrite();
+}
+
+void SeqLock::beginWrite()
+{
+    uint32_t const seq = sequence->load(std::memory_order_relaxed);
+    sequence->store(seq + 1, std::memory_order_relaxed);
+
+    // Prevent the stores performed by the writer from being reordered before
+    // the counter becomes odd.
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void SeqLock::endWrite()
+{
+    uint32_t const seq = sequence->load(std::memory_order_relaxed);
+    sequence->store(seq + 1, std::memory_order_release);
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -11,8 +11,13 @@ namespace dreamer {
 // #define PRINT_INFO_STATEMENT_RT(ss)
 #define PRINT_INFO_STATEMENT_RT(ss) CONTROLIT_INFO_RT << ss;
 
-#define NON_REALTIME_PRIORITY 1
 #define MAX_START_LATENCY_CYCLES 30
+#define STATS_PUBLISH_PERIOD_US 1000000
+
+#define DEFAULT_CPU_MASK 0xF           // cores 0-3
+#define DEFAULT_SERVO_PRIORITY 0
+#define DEFAULT_HELPER_PRIORITY 1
+#define DEFAULT_SERVO_STACK_SIZE 50000  // in bytes
 
 /*!
  * This global method takes as input a pointer to a ServoClockDreamer
@@ -30,8 +35,15 @@ void * call_rtMethod(void * scd)
 
 ServoClockDreamer::ServoClockDreamer() :
     ServoClock(), // Call super-class' constructor
-    rtThreadState(RT_THREAD_UNDEF)
+    rtThreadState(RT_THREAD_UNDEF),
+    servoCPUMask(DEFAULT_CPU_MASK),
+    helperCPUMask(DEFAULT_CPU_MASK),
+    servoPriority(DEFAULT_SERVO_PRIORITY),
+    helperPriority(DEFAULT_HELPER_PRIORITY),
+    servoStackSize(DEFAULT_SERVO_STACK_SIZE),
+    rtCheckerEnabled(false)
 {
+    memset(&statsSnapshot, 0, sizeof(statsSnapshot));
     PRINT_INFO_STATEMENT("ServoClockDreamer Created");
 }
 
@@ -39,6 +51,25 @@ ServoClockDreamer::~ServoClockDreamer()
 {
 }
 
+void ServoClockDreamer::loadParameters()
+{
+    ros::NodeHandle nh("controlit");
+    nh.param("rt_checker_enabled", rtCheckerEnabled, false);
+    nh.param("rtai_servo_cpu_mask", servoCPUMask, DEFAULT_CPU_MASK);
+    nh.param("rtai_servo_priority", servoPriority, DEFAULT_SERVO_PRIORITY);
+    nh.param("rtai_servo_stack_size", servoStackSize, DEFAULT_SERVO_STACK_SIZE);
+    nh.param("rtai_helper_cpu_mask", helperCPUMask, DEFAULT_CPU_MASK);
+    nh.param("rtai_helper_priority", helperPriority, DEFAULT_HELPER_PRIORITY);
+
+    if (servoCPUMask == 0 || helperCPUMask == 0)
+        throw std::runtime_error("The RTAI CPU masks must allow at least one CPU");
+
+    CONTROLIT_INFO << "RTAI tasks: TSHMP (servo) CPU mask = 0x" << std::hex << servoCPUMask << std::dec
+                   << ", priority = " << servoPriority << ", stack size = " << servoStackSize
+                   << "; TSHM (helper) CPU mask = 0x" << std::hex << helperCPUMask << std::dec
+                   << ", priority = " << helperPriority;
+}
+
 void ServoClockDreamer::updateLoopImpl()
 {
     // PRINT_INFO_STATEMENT("Method called!");
@@ -47,11 +78,30 @@ void ServoClockDreamer::updateLoopImpl()
     // TODO: Make this a parameter
     rtPeriod_ns = 1000000000L / frequency;
     long long const rtPeriod_us(rtPeriod_ns / 1000);
+
+    loadParameters();
+
+    rtChecker.init(rtCheckerEnabled);
+
+    ros::NodeHandle paramNH("controlit");
+    overrunPolicy.init(paramNH, rtPeriod_ns / 1e9);
+
+    // Allocate the statistics before the real-time thread starts.
+    if (!stats.init(rtPeriod_ns / 1e9))
+        throw std::runtime_error("Unable to initialize the servo clock statistics");
+
+    ros::NodeHandle nh;
+    statsPublisher.init(nh, "controlit/dreamer/servo_clock_stats", 1);
+    if (statsPublisher.trylock())
+    {
+        statsPublisher.msg_.data.resize(ServoClockStats::NUM_FIELDS, 0);
+        statsPublisher.unlockAndPublish();
+    }
     
     // Change scheduler of this thread to be RTAI
     PRINT_INFO_STATEMENT("Switching to RTAI scheduler...");
     rt_allow_nonroot_hrt();
-    RT_TASK * normalTask = rt_task_init_schmod(nam2num("TSHM"), NON_REALTIME_PRIORITY, 0, 0, SCHED_FIFO, 0xF);
+    RT_TASK * normalTask = rt_task_init_schmod(nam2num("TSHM"), helperPriority, 0, 0, SCHED_FIFO, helperCPUMask);
     if (!normalTask)
         throw std::runtime_error("rt_task_init_schmod failed for non-RT task");
     
@@ -61,7 +111,7 @@ void ServoClockDreamer::updateLoopImpl()
     rtThreadState = RT_THREAD_UNDEF;
     int rtThreadID = rt_thread_create((void*)call_rtMethod,
                                   this,  // parameters
-                                  50000); // stack size
+                                  servoStackSize); // stack size
 
     // Wait up to MAX_START_LATENCY_CYCLES for real-time thread to begin running
     for (int ii = 0; ii < MAX_START_LATENCY_CYCLES; ii++) 
@@ -75,19 +125,7 @@ void ServoClockDreamer::updateLoopImpl()
     
     if (rtThreadState != RT_THREAD_RUNNING) 
     {
-        std::stringstream ss;
-        ss << "Invalid real-time thread state: ";
-
-        switch (rtThreadState) 
-        {
-            case RT_THREAD_UNDEF:   ss << "RT_THREAD_UNDEF";   break;
-            case RT_THREAD_INIT:    ss << "RT_THREAD_INIT";    break;
-            case RT_THREAD_RUNNING: ss << "RT_THREAD_RUNNING"; break;
-            case RT_THREAD_CLEANUP: ss << "RT_THREAD_CLEANUP"; break;
-            case RT_THREAD_ERROR:   ss << "RT_THREAD_ERROR";   break;
-            case RT_THREAD_DONE:    ss << "RT_THREAD_DONE";    break;
-            default:                ss << "Invalid state: " << rtThreadState;
-        }
+        CONTROLIT_ERROR_RT << "Invalid real-time thread state: " << rtThreadStateToString(rtThreadState);
 
         usleep(15 * rtPeriod_us);
         rt_task_delete(normalTask);
@@ -97,7 +135,24 @@ void ServoClockDreamer::updateLoopImpl()
     
     CONTROLIT_INFO_RT << "OK - real-time thread started.";
 
+    // Periodically publish the statistics collected by the real-time thread.
+    while (rtThreadState == RT_THREAD_RUNNING)
+    {
+        usleep(STATS_PUBLISH_PERIOD_US);
+        publishStats();
+        rtChecker.report();
+    }
+
     rt_thread_join(rtThreadID);  // blocks until the real-time thread exits.
+
+    publishStats();
+    CONTROLIT_INFO << ServoClockStats::toString(statsSnapshot);
+
+    if (rtCheckerEnabled)
+    {
+        rtChecker.report();
+        CONTROLIT_INFO << rtChecker.toString();
+    }
     rt_task_delete(normalTask);
     
     PRINT_INFO_STATEMENT_RT("Method exiting.")
@@ -111,7 +166,7 @@ void * ServoClockDreamer::rtMethod(void *)
     rtThreadState = RT_THREAD_INIT;
        
     // Switch to use RTAI real-time scheduler
-    RT_TASK * task = rt_task_init_schmod(nam2num("TSHMP"), 0, 0, 0, SCHED_FIFO, 0xF);
+    RT_TASK * task = rt_task_init_schmod(nam2num("TSHMP"), servoPriority, 0, 0, SCHED_FIFO, servoCPUMask);
     rt_allow_nonroot_hrt();
     if (task == nullptr) 
     {
@@ -133,7 +188,8 @@ void * ServoClockDreamer::rtMethod(void *)
     // Start the real time engine...
     
     RTIME tickPeriod = nano2count(rtPeriod_ns);
-    rt_task_make_periodic(task, rt_get_time() + tickPeriod, tickPeriod); 
+    RTIME nextWakeTime = rt_get_time() + tickPeriod;
+    rt_task_make_periodic(task, nextWakeTime, tickPeriod); 
     mlockall(MCL_CURRENT | MCL_FUTURE);
     rt_make_hard_real_time();
     rtThreadState = RT_THREAD_RUNNING;
@@ -153,21 +209,44 @@ void * ServoClockDreamer::rtMethod(void *)
     while (continueRunning) 
     {
         rt_task_wait_period();
+        RTIME const wakeTime = rt_get_time();
+
+        // RTAI does not skip periods.  A late cycle is followed by cycles
+        // that start immediately until the schedule is caught up, unless
+        // the overrun policy holds them.
+        RTIME const lateness = wakeTime - nextWakeTime;
+        unsigned int flags = overrunPolicy.beginCycle(count2nano(lateness) / 1e9);
+
         long long const start_time(nano2count(rt_get_cpu_time_ns()));
         
-        servoableClass->servoUpdate();
+        if (!(flags & SERVO_CYCLE_HELD))
+        {
+            rtChecker.arm();
+            servoableClass->servoUpdate();
+            rtChecker.disarm();
+        }
         
         long long const end_time(nano2count(rt_get_cpu_time_ns()));
         long long const dt(end_time - start_time);
-        if (dt > tickPeriod) 
-        {
-            // The following code will reduce the servo frequency based on the actual period.
-            //
-            // CONTROLIT_WARN_RT << "Slowing period of RT task from " << count2nano(tickPeriod) << " to " << count2nano(dt);
-            // tickPeriod = dt;
-            // rtPeriod_ns = count2nano(dt);
-            // rt_task_make_periodic(task, rt_get_time() + tickPeriod, tickPeriod); 
 
+        nextWakeTime += tickPeriod;
+        double const slack = count2nano(nextWakeTime - rt_get_time()) / 1e9;
+
+        flags |= overrunPolicy.endCycle(count2nano(dt) / 1e9, slack, flags & SERVO_CYCLE_HELD);
+        stats.update(count2nano(lateness) / 1e9, count2nano(dt) / 1e9, slack, flags);
+
+        if (flags & SERVO_CYCLE_RATE_FALLBACK)
+        {
+            CONTROLIT_WARN_RT << "Slowing period of RT task from " << rtPeriod_ns << "ns to "
+                              << static_cast<long long>(overrunPolicy.getPeriod() * 1e9) << "ns";
+            rtPeriod_ns = static_cast<long long>(overrunPolicy.getPeriod() * 1e9);
+            tickPeriod = nano2count(rtPeriod_ns);
+            nextWakeTime = rt_get_time() + tickPeriod;
+            rt_task_make_periodic(task, nextWakeTime, tickPeriod); 
+            stats.setPeriod(overrunPolicy.getPeriod());
+        }
+        else if (dt > tickPeriod) 
+        {
             // The following just issues a warning without changing the desired servo frequency.
             //
             CONTROLIT_WARN_RT << "Desired RT Frequency violated! Desired " << count2nano(tickPeriod) << "ns, got " << count2nano(dt) << "ns";
@@ -185,5 +264,17 @@ void * ServoClockDreamer::rtMethod(void *)
     return nullptr;
 }
 
+void ServoClockDreamer::publishStats()
+{
+    if (!stats.getSnapshot(statsSnapshot))
+        return;
+
+    if (statsPublisher.trylock())
+    {
+        ServoClockStats::toArray(statsSnapshot, statsPublisher.msg_.data);
+        statsPublisher.unlockAndPublish();
+    }
+}
+
 } // namespace dreamer
 } // namespace controlit
@@ -0,0 +1,50 @@
+#include <controlit/dreamer/ServoClockDreamerFreeRun.hpp>
+#include <controlit/logging/RealTimeLogging.hpp>
+
+#include <chrono>
+
+namespace controlit {
+namespace dreamer {
+
+// Uncomment one of the following lines to enable/disable detailed debug statements.
+#define PRINT_INFO_STATEMENT(ss)
+// #define PRINT_INFO_STATEMENT(ss) CONTROLIT_INFO_RT << ss;
+
+ServoClockDreamerFreeRun::ServoClockDreamerFreeRun() :
+    ServoClock() // Call super-class' constructor
+{
+    PRINT_INFO_STATEMENT("ServoClockDreamerFreeRun Created");
+}
+
+ServoClockDreamerFreeRun::~ServoClockDreamerFreeRun()
+{
+}
+
+void ServoClockDreamerFreeRun::updateLoopImpl()
+{
+    CONTROLIT_INFO_RT << "Running the servo loop as fast as possible, ignoring the servo frequency of "
+                      << frequency << " Hz.";
+
+    if (callServoInit)
+    {
+        servoableClass->servoInit();
+        callServoInit = false;
+    }
+
+    std::chrono::steady_clock::time_point const startTime = std::chrono::steady_clock::now();
+    unsigned long long numCycles = 0;
+
+    while (continueRunning)
+    {
+        servoableClass->servoUpdate();
+        numCycles++;
+    }
+
+    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    CONTROLIT_INFO_RT << "Ran " << numCycles << " servo cycles in " << elapsed << " seconds ("
+                      << (elapsed > 0 ? numCycles / elapsed : 0) << " Hz).";
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -0,0 +1,408 @@
+#include <controlit/dreamer/ServoClockDreamerPosix.hpp>
+#include <controlit/logging/RealTimeLogging.hpp>
+
+#include <algorithm>
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace controlit {
+namespace dreamer {
+
+// Uncomment one of the following lines to enable/disable detailed debug statements.
+// #define PRINT_INFO_STATEMENT(ss)
+#define PRINT_INFO_STATEMENT(ss) CONTROLIT_INFO_RT << ss;
+
+#define MAX_START_LATENCY_CYCLES 30
+#define MIN_START_TIMEOUT_US 1000000LL
+#define STATS_PUBLISH_PERIOD_US 1000000
+#define NANOSECONDS_PER_SECOND 1000000000LL
+#define STACK_PREFAULT_SIZE (64 * 1024)
+
+#define DEFAULT_CPU -1
+#define DEFAULT_SCHEDULER "fifo"
+#define DEFAULT_PRIORITY 80
+#define DEFAULT_DEADLINE_RUNTIME 0.8
+#define DEFAULT_STACK_SIZE (512 * 1024)
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+/*!
+ * The argument of the sched_setattr system call, which glibc does not wrap.
+ * See sched_setattr(2).
+ */
+struct SchedAttr
+{
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+/*!
+ * Returns a time in nanoseconds.
+ */
+static inline long long toNanoseconds(const struct timespec & time)
+{
+    return time.tv_sec * NANOSECONDS_PER_SECOND + time.tv_nsec;
+}
+
+/*!
+ * Advances a time by a number of nanoseconds.
+ */
+static inline void addNanoseconds(struct timespec & time, long long ns)
+{
+    long long const sum = time.tv_nsec + ns;
+    time.tv_sec += sum / NANOSECONDS_PER_SECOND;
+    time.tv_nsec = sum % NANOSECONDS_PER_SECOND;
+}
+
+/*!
+ * Touches the top of the calling thread's stack so that it is resident
+ * before the servo loop starts.
+ */
+static void prefaultStack()
+{
+    volatile unsigned char stack[STACK_PREFAULT_SIZE];
+    memset(const_cast<unsigned char *>(stack), 0, STACK_PREFAULT_SIZE);
+}
+
+/*!
+ * This global method takes as input a pointer to a ServoClockDreamerPosix
+ * object and calls rtMethod() on it. It is necessary to be compatible with
+ * pthread_create().
+ *
+ * \param[in] scd A pointer to the ServoClockDreamerPosix class.
+ * \return the return value of the call to ServoClockDreamerPosix->rtMethod().
+ */
+static void * call_posixRTMethod(void * scd)
+{
+    ServoClockDreamerPosix * servoClock = static_cast<ServoClockDreamerPosix*>(scd);
+    return servoClock->rtMethod(nullptr);
+}
+
+ServoClockDreamerPosix::ServoClockDreamerPosix() :
+    ServoClock(), // Call super-class' constructor
+    rtThreadState(RT_THREAD_UNDEF),
+    rtPeriod_ns(0),
+    cpu(DEFAULT_CPU),
+    scheduler(DEFAULT_SCHEDULER),
+    priority(DEFAULT_PRIORITY),
+    deadlineRuntime(DEFAULT_DEADLINE_RUNTIME),
+    stackSize(DEFAULT_STACK_SIZE),
+    rtCheckerEnabled(false)
+{
+    memset(&statsSnapshot, 0, sizeof(statsSnapshot));
+    PRINT_INFO_STATEMENT("ServoClockDreamerPosix Created");
+}
+
+ServoClockDreamerPosix::~ServoClockDreamerPosix()
+{
+}
+
+void ServoClockDreamerPosix::loadParameters()
+{
+    ros::NodeHandle nh("controlit");
+    nh.param("rt_checker_enabled", rtCheckerEnabled, false);
+    nh.param("posix_servo_cpu", cpu, DEFAULT_CPU);
+    nh.param("posix_servo_scheduler", scheduler, std::string(DEFAULT_SCHEDULER));
+    nh.param("posix_servo_priority", priority, DEFAULT_PRIORITY);
+    nh.param("posix_servo_deadline_runtime", deadlineRuntime, DEFAULT_DEADLINE_RUNTIME);
+    nh.param("posix_servo_stack_size", stackSize, DEFAULT_STACK_SIZE);
+}
+
+void ServoClockDreamerPosix::updateLoopImpl()
+{
+    // Compute the period of the real-time servo loop.
+    rtPeriod_ns = NANOSECONDS_PER_SECOND / frequency;
+    long long const rtPeriod_us(rtPeriod_ns / 1000);
+
+    loadParameters();
+
+    rtChecker.init(rtCheckerEnabled);
+
+    ros::NodeHandle paramNH("controlit");
+    overrunPolicy.init(paramNH, rtPeriod_ns / 1e9);
+
+    // Allocate the statistics before the real-time thread starts.
+    if (!stats.init(rtPeriod_ns / 1e9))
+        throw std::runtime_error("Unable to initialize the servo clock statistics");
+
+    ros::NodeHandle nh;
+    statsPublisher.init(nh, "controlit/dreamer/servo_clock_stats", 1);
+    if (statsPublisher.trylock())
+    {
+        statsPublisher.msg_.data.resize(ServoClockStats::NUM_FIELDS, 0);
+        statsPublisher.unlockAndPublish();
+    }
+
+    // Spawn the real-time thread. The real-time thread executes call_posixRTMethod(),
+    // which then calls ServoClockDreamerPosix::rtMethod() that's defined below.
+    PRINT_INFO_STATEMENT("Spawning RT thread, scheduler = " << scheduler << ", CPU = " << cpu << "...");
+    rtThreadState = RT_THREAD_UNDEF;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stackSize);
+
+    pthread_t rtThread;
+    int const result = pthread_create(&rtThread, &attr, call_posixRTMethod, this);
+    pthread_attr_destroy(&attr);
+
+    if (result != 0)
+        throw std::runtime_error(std::string("pthread_create failed for RT thread: ") + strerror(result));
+
+    // Wait up to MAX_START_LATENCY_CYCLES, but no less than MIN_START_TIMEOUT_US
+    // since locking the memory can take a while, for real-time thread to begin running
+    long long const startTimeout_us = std::max(MAX_START_LATENCY_CYCLES * rtPeriod_us, MIN_START_TIMEOUT_US);
+    for (long long waited_us = 0; waited_us < startTimeout_us; waited_us += rtPeriod_us)
+    {
+        if (rtThreadState == RT_THREAD_RUNNING || rtThreadState == RT_THREAD_ERROR)
+        {
+            break;
+        }
+        usleep(rtPeriod_us);
+    }
+
+    if (rtThreadState != RT_THREAD_RUNNING)
+    {
+        CONTROLIT_ERROR_RT << "Invalid real-time thread state: " << rtThreadStateToString(rtThreadState);
+
+        continueRunning = false;
+        pthread_join(rtThread, nullptr);  // blocks until the real-time thread exits.
+        throw std::runtime_error("RT thread failed to start");
+    }
+
+    CONTROLIT_INFO_RT << "OK - real-time thread started.";
+
+    // Periodically publish the statistics collected by the real-time thread.
+    while (rtThreadState == RT_THREAD_RUNNING)
+    {
+        usleep(STATS_PUBLISH_PERIOD_US);
+        publishStats();
+        rtChecker.report();
+    }
+
+    pthread_join(rtThread, nullptr);  // blocks until the real-time thread exits.
+    rtThreadState = RT_THREAD_DONE;
+
+    publishStats();
+    CONTROLIT_INFO << ServoClockStats::toString(statsSnapshot);
+
+    if (rtCheckerEnabled)
+    {
+        rtChecker.report();
+        CONTROLIT_INFO << rtChecker.toString();
+    }
+}
+
+bool ServoClockDreamerPosix::configureRTThread()
+{
+    if (cpu >= 0 && scheduler == "deadline")
+    {
+        // The kernel rejects SCHED_DEADLINE for threads whose affinity is
+        // narrower than their root domain.
+        CONTROLIT_WARN_RT << "Not pinning RT thread to CPU " << cpu << " because SCHED_DEADLINE "
+                          << "requires an exclusive cpuset for that.";
+    }
+    else if (cpu >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+
+        int const result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (result != 0)
+        {
+            CONTROLIT_ERROR_RT << "Unable to pin RT thread to CPU " << cpu << ": " << strerror(result);
+            return false;
+        }
+    }
+
+    if (scheduler == "fifo")
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+
+        int const result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (result != 0)
+        {
+            CONTROLIT_ERROR_RT << "Unable to set RT thread to SCHED_FIFO priority " << priority
+                               << ": " << strerror(result);
+            return false;
+        }
+    }
+    else if (scheduler == "deadline")
+    {
+        if (deadlineRuntime <= 0 || deadlineRuntime > 1)
+        {
+            CONTROLIT_ERROR_RT << "Invalid SCHED_DEADLINE runtime " << deadlineRuntime
+                               << ", must be a fraction of the period in (0, 1].";
+            return false;
+        }
+
+        if (!setDeadlineScheduler())
+            return false;
+    }
+    else if (scheduler != "other")
+    {
+        CONTROLIT_ERROR_RT << "Unknown scheduler \"" << scheduler << "\", must be \"fifo\", \"deadline\", or \"other\".";
+        return false;
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        // Not fatal.  Page faults only add jitter.
+        CONTROLIT_WARN_RT << "Unable to lock memory: " << strerror(errno);
+    }
+
+    prefaultStack();
+    return true;
+}
+
+bool ServoClockDreamerPosix::setDeadlineScheduler()
+{
+    SchedAttr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.sched_policy = SCHED_DEADLINE;
+    attr.sched_runtime = static_cast<uint64_t>(deadlineRuntime * rtPeriod_ns);
+    attr.sched_deadline = rtPeriod_ns;
+    attr.sched_period = rtPeriod_ns;
+
+    if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0)
+    {
+        CONTROLIT_ERROR_RT << "Unable to set RT thread to SCHED_DEADLINE with runtime "
+                           << attr.sched_runtime << " ns and period " << rtPeriod_ns << " ns: "
+                           << strerror(errno);
+        return false;
+    }
+
+    return true;
+}
+
+void * ServoClockDreamerPosix::rtMethod(void *)
+{
+    rtThreadState = RT_THREAD_INIT;
+
+    // Verify the servo frequency is valid
+    if (rtPeriod_ns <= 0)
+    {
+        CONTROLIT_ERROR_RT << "Invalid real-time period " << rtPeriod_ns << " ns";
+        rtThreadState = RT_THREAD_ERROR;
+        return nullptr;
+    }
+
+    if (!configureRTThread())
+    {
+        rtThreadState = RT_THREAD_ERROR;
+        return nullptr;
+    }
+
+    //////////////////////////////////////////////////
+    // Start the real time engine...
+
+    struct timespec nextWakeTime;
+    clock_gettime(CLOCK_MONOTONIC, &nextWakeTime);
+    addNanoseconds(nextWakeTime, rtPeriod_ns);
+    rtThreadState = RT_THREAD_RUNNING;
+
+    //////////////////////////////////////////////////
+    // The servo init method if necessary.
+
+    if (callServoInit)
+    {
+        servoableClass->servoInit();
+        callServoInit = false;
+    }
+
+    //////////////////////////////////////////////////
+    // The servo loop.
+
+    while (continueRunning)
+    {
+        // clock_nanosleep returns the error number instead of setting errno.
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextWakeTime, nullptr) == EINTR) {}
+
+        struct timespec wakeTime, endTime;
+        clock_gettime(CLOCK_MONOTONIC, &wakeTime);
+
+        // Like RTAI, do not skip periods.  A late cycle is followed by cycles
+        // that start immediately until the schedule is caught up, unless
+        // the overrun policy holds them.
+        long long const lateness = toNanoseconds(wakeTime) - toNanoseconds(nextWakeTime);
+        unsigned int flags = overrunPolicy.beginCycle(lateness / 1e9);
+
+        if (!(flags & SERVO_CYCLE_HELD))
+        {
+            rtChecker.arm();
+            servoableClass->servoUpdate();
+            rtChecker.disarm();
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &endTime);
+        long long const dt = toNanoseconds(endTime) - toNanoseconds(wakeTime);
+
+        addNanoseconds(nextWakeTime, rtPeriod_ns);
+        double const slack = (toNanoseconds(nextWakeTime) - toNanoseconds(endTime)) / 1e9;
+
+        flags |= overrunPolicy.endCycle(dt / 1e9, slack, flags & SERVO_CYCLE_HELD);
+        stats.update(lateness / 1e9, dt / 1e9, slack, flags);
+
+        if (flags & SERVO_CYCLE_RATE_FALLBACK)
+        {
+            CONTROLIT_WARN_RT << "Slowing period of RT thread from " << rtPeriod_ns << "ns to "
+                              << static_cast<long long>(overrunPolicy.getPeriod() * 1e9) << "ns";
+            rtPeriod_ns = static_cast<long long>(overrunPolicy.getPeriod() * 1e9);
+
+            // The kernel throttles a SCHED_DEADLINE thread to its reservation,
+            // so the reservation must follow the period.  If it cannot be
+            // changed, the old one remains in effect.
+            if (scheduler == "deadline")
+                setDeadlineScheduler();
+
+            nextWakeTime = endTime;
+            addNanoseconds(nextWakeTime, rtPeriod_ns);
+            stats.setPeriod(overrunPolicy.getPeriod());
+        }
+        else if (dt > rtPeriod_ns)
+        {
+            CONTROLIT_WARN_RT << "Desired RT Frequency violated! Desired " << rtPeriod_ns << "ns, got " << dt << "ns";
+        }
+    }
+
+    //////////////////////////////////////////////////
+    // Clean up after ourselves.
+
+    CONTROLIT_INFO_RT << "Exiting RT thread";
+
+    rtThreadState = RT_THREAD_CLEANUP;
+    return nullptr;
+}
+
+void ServoClockDreamerPosix::publishStats()
+{
+    if (!stats.getSnapshot(statsSnapshot))
+        return;
+
+    if (statsPublisher.trylock())
+    {
+        ServoClockStats::toArray(statsSnapshot, statsPublisher.msg_.data);
+        statsPublisher.unlockAndPublish();
+    }
+}
+
+} // namespace dreamer
+} // namespace controlit
@@ -9,7 +9,8 @@ namespace dreamer {
 #define DEFAULT_SERVO_FREQUENCY 1000  // In Hz
 
 ServoClockDreamerTester::ServoClockDreamerTester() :
-  initialized(false)
+  initialized(false),
+  usePosix(false)
 {
 }
 
@@ -17,9 +18,16 @@ ServoClockDreamerTester::~ServoClockDreamerTester()
 {
 }
 
-bool ServoClockDreamerTester::init()
+bool ServoClockDreamerTester::init(bool usePosix)
 {
-    servoClock.init(this);
+    this->usePosix = usePosix;
+
+    if (usePosix)
+        servoClock.reset(new ServoClockDreamerPosix());
+    else
+        servoClock.reset(new ServoClockDreamer());
+
+    servoClock->init(this);
 
     ros::NodeHandle nh;
 
@@ -41,14 +49,18 @@ bool ServoClockDreamerTester::init()
 
 bool ServoClockDreamerTester::start(double freq)
 {
-    timer.start();
-    servoClock.start(freq);
+    if (usePosix)
+        lastUpdateTime = std::chrono::steady_clock::now();
+    else
+        timer.start();
+
+    servoClock->start(freq);
     return true;
 }
 
 bool ServoClockDreamerTester::stop()
 {
-    servoClock.stop();
+    servoClock->stop();
     return true;
 }
 
@@ -59,8 +71,18 @@ void ServoClockDreamerTester::servoInit()
 
 void ServoClockDreamerTester::servoUpdate()
 {
-    double elapsedTime = timer.getTime();
-    timer.start();
+    double elapsedTime;
+    if (usePosix)
+    {
+        std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+        elapsedTime = std::chrono::duration<double>(now - lastUpdateTime).count();
+        lastUpdateTime = now;
+    }
+    else
+    {
+        elapsedTime = timer.getTime();
+        timer.start();
+    }
     // std::cerr << "Method called, elapsed time = " << elapsedTimeMS << " ms, jitter = " << (elapsedTimeMS - 1) * 1000 << " us" << std::endl;
     if (publisher.trylock())
     {
@@ -75,7 +97,8 @@ std::string ServoClockDreamerTester::toString(std::string const& prefix) const
 
     std::stringstream ss;
     ss << prefix << "ServoClockDreamerTester details:\n";
-    ss << prefix << "  - initialized: " << (initialized ? "true" : "false");
+    ss << prefix << "  - initialized: " << (initialized ? "true" : "false") << "\n";
+    ss << prefix << "  - servo clock: " << (usePosix ? "ServoClockDreamerPosix" : "ServoClockDreamer");
 
     return ss.str();
 }
@@ -92,17 +115,19 @@ int main(int argc, char **argv)
     ss << "Usage: rosrun controlit_dreamer_integration ServoClockDreamerTester [options]\n"
        << "Valid options include:\n"
        << "  -h: display this usage string\n"
-       << "  -f [frequency]: the desired servo frequency (default: " << DEFAULT_SERVO_FREQUENCY << "Hz)";
+       << "  -f [frequency]: the desired servo frequency (default: " << DEFAULT_SERVO_FREQUENCY << "Hz)\n"
+       << "  -c [clock]: the servo clock to test, either \"rtai\" or \"posix\" (default: rtai)";
 
     ros::init(argc, argv, "ServoClockDreamerTester");
 
     double freq = DEFAULT_SERVO_FREQUENCY;
+    std::string clockType = "rtai";
 
     if (argc != 1)
     {
         // Parse the command line arguments
         int option_char;
-        while ((option_char = getopt (argc, argv, "hf:")) != -1)
+        while ((option_char = getopt (argc, argv, "hf:c:")) != -1)
         {
             switch (option_char)
             {
@@ -113,6 +138,9 @@ int main(int argc, char **argv)
                 case 'f':
                     freq = std::stod(optarg);
                     break;
+                case 'c':
+                    clockType = optarg;
+                    break;
                 default:
                     std::cerr << "ERROR: Unknown option " << option_char << ".  " << ss.str() << std::endl;
                     return -1;
@@ -120,13 +148,20 @@ int main(int argc, char **argv)
         }
     }
 
+    if (clockType != "rtai" && clockType != "posix")
+    {
+        std::cerr << "ERROR: Unknown servo clock \"" << clockType << "\".  " << ss.str() << std::endl;
+        return -1;
+    }
+
     ros::NodeHandle nh;
 
-    std::cout << "ServoClockDreamerTester: Starting test, servo frequency = " << freq << "..." << std::endl;
+    std::cout << "ServoClockDreamerTester: Starting test, servo clock = " << clockType
+              << ", servo frequency = " << freq << "..." << std::endl;
 
     // Create and start a ServoClockDreamerTester
     controlit::dreamer::ServoClockDreamerTester servoClockDreamerTester;
-    if (!servoClockDreamerTester.init()) return -1;
+    if (!servoClockDreamerTester.init(clockType == "posix")) return -1;
     if (!servoClockDreamerTester.start(freq)) return -1;
 
     // Loop at 1Hz until someone hits ctrl+c
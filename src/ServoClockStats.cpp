@@ -0,0 +1,177 @@
+#include <controlit/dreamer/ServoClockStats.hpp>
+
+#include <sstream>
+#include <string.h>
+
+namespace controlit {
+namespace dreamer {
+
+#define SERVO_CLOCK_STATS_SNAPSHOT_PERIOD 1000 // in servo cycles
+#define HISTOGRAM_BUCKET_WIDTH 1e-6            // in seconds
+#define HISTOGRAM_RANGE_PERIODS 4              // the histograms cover this many servo periods
+
+ServoClockStats::ServoClockStats() :
+    recordingIndex(0),
+    handedOverIndex(-1)
+{
+    memset(&current, 0, sizeof(current));
+}
+
+bool ServoClockStats::init(double period)
+{
+    if (period <= 0)
+        return false;
+
+    size_t const numBuckets = static_cast<size_t>(HISTOGRAM_RANGE_PERIODS * period / HISTOGRAM_BUCKET_WIDTH) + 1;
+
+    if (!wakeupJitter.init(HISTOGRAM_BUCKET_WIDTH, numBuckets)
+        || !computeTime.init(HISTOGRAM_BUCKET_WIDTH, numBuckets)
+        || !slack.init(HISTOGRAM_BUCKET_WIDTH, numBuckets))
+        return false;
+
+    for (int ii = 0; ii < 2; ii++)
+    {
+        if (!intervals[ii].wakeupJitter.init(HISTOGRAM_BUCKET_WIDTH, numBuckets)
+            || !intervals[ii].computeTime.init(HISTOGRAM_BUCKET_WIDTH, numBuckets)
+            || !intervals[ii].slack.init(HISTOGRAM_BUCKET_WIDTH, numBuckets))
+            return false;
+    }
+
+    memset(&current, 0, sizeof(current));
+    current.period = period;
+    recordingIndex = 0;
+    handedOverIndex.store(-1, std::memory_order_release);
+    return true;
+}
+
+void ServoClockStats::update(double wakeupLatency, double computeTimeValue, double slackValue,
+    unsigned int flags)
+{
+    Interval & interval = intervals[recordingIndex];
+
+    current.numCycles++;
+    if (flags & SERVO_CYCLE_MISSED_PERIOD) current.numMissedPeriods++;
+    if (flags & SERVO_CYCLE_LOW_SLACK) current.numLowSlackCycles++;
+    if (flags & SERVO_CYCLE_HELD) current.numHeldCycles++;
+    if (flags & SERVO_CYCLE_RATE_FALLBACK) current.numRateFallbacks++;
+
+    interval.wakeupJitter.record(wakeupLatency);
+    interval.computeTime.record(computeTimeValue);
+
+    if (slackValue < 0)
+    {
+        current.numOverruns++;
+        current.consecutiveOverruns++;
+        if (current.consecutiveOverruns > current.maxConsecutiveOverruns)
+            current.maxConsecutiveOverruns = current.consecutiveOverruns;
+        interval.slack.record(0);
+    }
+    else
+    {
+        current.consecutiveOverruns = 0;
+        interval.slack.record(slackValue);
+    }
+
+    if (current.numCycles % SERVO_CLOCK_STATS_SNAPSHOT_PERIOD != 0)
+        return;
+
+    // If the previous interval was not consumed yet, keep recording into
+    // this one and hand it over at the end of the next snapshot period.
+    if (handedOverIndex.load(std::memory_order_acquire) >= 0)
+        return;
+
+    interval.counters = current;
+    handedOverIndex.store(recordingIndex, std::memory_order_release);
+    recordingIndex ^= 1;
+}
+
+void ServoClockStats::setPeriod(double period)
+{
+    current.period = period;
+}
+
+bool ServoClockStats::getSnapshot(ServoClockStatsSnapshot & snapshot)
+{
+    int const index = handedOverIndex.load(std::memory_order_acquire);
+    if (index < 0)
+        return false;
+
+    Interval & interval = intervals[index];
+
+    wakeupJitter.add(interval.wakeupJitter);
+    computeTime.add(interval.computeTime);
+    slack.add(interval.slack);
+    snapshot = interval.counters;
+
+    interval.wakeupJitter.reset();
+    interval.computeTime.reset();
+    interval.slack.reset();
+    handedOverIndex.store(-1, std::memory_order_release);
+
+    snapshot.wakeupJitterP50 = wakeupJitter.getPercentile(0.5);
+    snapshot.wakeupJitterP99 = wakeupJitter.getPercentile(0.99);
+    snapshot.wakeupJitterP999 = wakeupJitter.getPercentile(0.999);
+    snapshot.wakeupJitterMax = wakeupJitter.getMax();
+
+    snapshot.computeTimeP50 = computeTime.getPercentile(0.5);
+    snapshot.computeTimeP99 = computeTime.getPercentile(0.99);
+    snapshot.computeTimeP999 = computeTime.getPercentile(0.999);
+    snapshot.computeTimeMax = computeTime.getMax();
+
+    snapshot.slackP50 = slack.getPercentile(0.5);
+    snapshot.slackP1 = slack.getPercentile(0.01);
+    snapshot.slackP01 = slack.getPercentile(0.001);
+    snapshot.slackMin = slack.getMin();
+
+    return true;
+}
+
+void ServoClockStats::toArray(const ServoClockStatsSnapshot & snapshot, std::vector<double> & data)
+{
+    data[0] = snapshot.numCycles;
+    data[1] = snapshot.numOverruns;
+    data[2] = snapshot.numMissedPeriods;
+    data[3] = snapshot.consecutiveOverruns;
+    data[4] = snapshot.maxConsecutiveOverruns;
+    data[5] = snapshot.wakeupJitterP50;
+    data[6] = snapshot.wakeupJitterP99;
+    data[7] = snapshot.wakeupJitterP999;
+    data[8] = snapshot.wakeupJitterMax;
+    data[9] = snapshot.computeTimeP50;
+    data[10] = snapshot.computeTimeP99;
+    data[11] = snapshot.computeTimeP999;
+    data[12] = snapshot.computeTimeMax;
+    data[13] = snapshot.slackP50;
+    data[14] = snapshot.slackP1;
+    data[15] = snapshot.slackP01;
+    data[16] = snapshot.slackMin;
+    data[17] = snapshot.numLowSlackCycles;
+    data[18] = snapshot.numHeldCycles;
+    data[19] = snapshot.numRateFallbacks;
+    data[20] = snapshot.period;
+}
+
+std::string ServoClockStats::toString(const ServoClockStatsSnapshot & snapshot, std::string const & prefix)
+{
+    std::stringstream ss;
+    ss << prefix << "Servo clock statistics after " << snapshot.numCycles << " cycles:\n"
+       << prefix << "  - overruns: " << snapshot.numOverruns << " (max consecutive: "
+       << snapshot.maxConsecutiveOverruns << ")\n"
+       << prefix << "  - missed periods: " << snapshot.numMissedPeriods << "\n"
+       << prefix << "  - wakeup jitter (us): p50 = " << snapshot.wakeupJitterP50 * 1e6
+       << ", p99 = " << snapshot.wakeupJitterP99 * 1e6 << ", p99.9 = " << snapshot.wakeupJitterP999 * 1e6
+       << ", max = " << snapshot.wakeupJitterMax * 1e6 << "\n"
+       << prefix << "  - compute time (us): p50 = " << snapshot.computeTimeP50 * 1e6
+       << ", p99 = " << snapshot.computeTimeP99 * 1e6 << ", p99.9 = " << snapshot.computeTimeP999 * 1e6
+       << ", max = " << snapshot.computeTimeMax * 1e6 << "\n"
+       << prefix << "  - slack (us): p50 = " << snapshot.slackP50 * 1e6
+       << ", p1 = " << snapshot.slackP1 * 1e6 << ", p0.1 = " << snapshot.slackP01 * 1e6
+       << ", min = " << snapshot.slackMin * 1e6 << "\n"
+       << prefix << "  - overrun policy: " << snapshot.numLowSlackCycles << " low slack cycles, "
+       << snapshot.numHeldCycles << " held cycles, " << snapshot.numRateFallbacks << " rate fallbacks, "
+       << "period = " << snapshot.period * 1e6 << "us";
+    return ss.str();
+}
+
+} // namespace dreamer
+} // namespace controlit